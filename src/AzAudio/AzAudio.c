@@ -7,6 +7,7 @@
 
 #include "error.h"
 #include "helpers.h"
+#include "simd.h"
 #include "backend/interface.h"
 
 #include <assert.h>
@@ -17,6 +18,7 @@
 fp_azaLogCallback azaPrint = azaDefaultLogFunc;
 
 int azaInit() {
+	azaSIMDInit();
 	return azaBackendInit();
 }
 
@@ -5,6 +5,8 @@
 
 #include "../backend.h"
 #include "../interface.h"
+#include "../streamsrc.h"
+#include "../streamblock.h"
 #include "../../error.h"
 #include "../../AzAudio.h"
 #include "../../helpers.h"
@@ -161,6 +163,8 @@ static const struct pw_port_events port_events = {
 */
 
 #define AZA_MAX_NODES 256
+// Pipewire's default clock.max-quantum, the most frames a callback can ask for unless the user configured it higher
+#define AZA_PIPEWIRE_MAX_QUANTUM 8192
 
 static struct pw_node *node[AZA_MAX_NODES];
 static struct spa_hook node_listener[AZA_MAX_NODES];
@@ -372,8 +376,63 @@ static void azaMakeSpaPodFormat(azaSpaPod *dst, enum spa_audio_format format, in
 typedef struct azaStreamData {
 	struct pw_stream *stream;
 	struct pw_stream_events stream_events;
+	// Used for planar streams, pointing directly into the pw_buffer
+	float *planes[SPA_AUDIO_MAX_CHANNELS];
+	azaStreamSRC src;
+	azaStreamBlock block;
+	// Reserved by azaStreamInit for the callback thread to adopt before its first mix, and then whichever arena it gave back
+	azaScratchBlock *scratch;
+	int scratchAdopted;
 } azaStreamData;
 
+// Hands the device buffer to the mixCallback, converting samplerates and splitting it into blocks on the way if needed
+static void azaStreamMix(azaStream *stream, azaStreamData *data, azaBuffer buffer) {
+	if AZA_UNLIKELY(!data->scratchAdopted) {
+		// Just swaps pointers, the arena was allocated by azaStreamInit
+		data->scratch = azaScratchAdopt(data->scratch);
+		data->scratchAdopted = 1;
+	}
+	// The callback thread belongs to pipewire, so we put its mode back when we're done
+	uint32_t denormals = azaFlushDenormalsBegin();
+	if (!azaStreamSRCActive(&data->src)) {
+		azaStreamBlockMix(&data->block, stream, buffer);
+	} else if (stream->deviceInterface == AZA_OUTPUT) {
+		azaStreamSRCOutput(&data->src, &data->block, stream, buffer);
+	} else {
+		azaStreamSRCInput(&data->src, &data->block, stream, buffer);
+	}
+	azaFlushDenormalsEnd(denormals);
+}
+
+static void azaStreamProcessPlanar(azaStream *stream, azaStreamData *data, struct pw_buffer *pw_buffer) {
+	struct spa_buffer *buffer = pw_buffer->buffer;
+	if (buffer->n_datas < stream->channels) return;
+	uint32_t maxFrames = UINT32_MAX;
+	for (size_t c = 0; c < stream->channels; c++) {
+		data->planes[c] = buffer->datas[c].data;
+		if (data->planes[c] == NULL) return;
+		maxFrames = SPA_MIN(maxFrames, buffer->datas[c].maxsize / sizeof(float));
+	}
+	int numFrames = buffer->datas[0].chunk->size / sizeof(float);
+	if (pw_buffer->requested) numFrames = SPA_MAX(pw_buffer->requested, numFrames);
+	numFrames = SPA_MIN(numFrames, maxFrames);
+
+	azaStreamMix(stream, data, (azaBuffer){
+		.samples = data->planes[0],
+		.frames = numFrames,
+		.stride = 1,
+		.channels = stream->channels,
+		.samplerate = stream->samplerate,
+		.planes = data->planes,
+	});
+
+	for (size_t c = 0; c < stream->channels; c++) {
+		buffer->datas[c].chunk->offset = 0;
+		buffer->datas[c].chunk->stride = sizeof(float);
+		buffer->datas[c].chunk->size = numFrames * sizeof(float);
+	}
+}
+
 static void azaStreamProcess(void *userdata) {
 	azaStream *stream = userdata;
 	azaStreamData *data = stream->data;
@@ -383,6 +442,12 @@ static void azaStreamProcess(void *userdata) {
 	pw_buffer = fp_pw_stream_dequeue_buffer(data->stream);
 	if (pw_buffer == NULL) return;
 
+	if (stream->planar) {
+		azaStreamProcessPlanar(stream, data, pw_buffer);
+		fp_pw_stream_queue_buffer(data->stream, pw_buffer);
+		return;
+	}
+
 	buffer = pw_buffer->buffer;
 	assert(buffer->n_datas == 1);
 	float *pcm = buffer->datas[0].data;
@@ -391,13 +456,14 @@ static void azaStreamProcess(void *userdata) {
 	int numFrames = buffer->datas[0].chunk->size / stride;
 	if (pw_buffer->requested) numFrames = SPA_MAX(pw_buffer->requested, numFrames);
 
-	stream->mixCallback((azaBuffer){
+	azaStreamMix(stream, data, (azaBuffer){
 		.samples = pcm,
 		.frames = numFrames,
 		.stride = stream->channels,
 		.channels = stream->channels,
 		.samplerate = stream->samplerate,
-	}, stream->userdata);
+		.planes = NULL,
+	});
 
 	buffer->datas[0].chunk->offset = 0;
 	buffer->datas[0].chunk->stride = stride;
@@ -452,7 +518,8 @@ static int azaStreamInitPipewire(azaStream *stream, const char *device) {
 	size_t deviceNodeCount = 0;
 
 	azaSpaPod formatPod;
-	azaMakeSpaPodFormat(&formatPod, SPA_AUDIO_FORMAT_F32, stream->channels, stream->samplerate);
+	// F32P lets us hand the device buffers straight to the mixCallback without any interleaving
+	azaMakeSpaPodFormat(&formatPod, stream->planar ? SPA_AUDIO_FORMAT_F32P : SPA_AUDIO_FORMAT_F32, stream->channels, stream->samplerate);
 
 	azaStreamData *data = calloc(sizeof(azaStreamData), 1);
 	data->stream_events.version = PW_VERSION_STREAM_EVENTS;
@@ -538,6 +605,44 @@ static int azaStreamInitPipewire(azaStream *stream, const char *device) {
 		stream->channels = channelsDefault;
 	if (stream->samplerate == 0)
 		stream->samplerate = samplerateDefault;
+	if (stream->mixSamplerate == 0)
+		stream->mixSamplerate = stream->samplerate;
+	
+	int err = azaStreamSRCInit(&data->src, stream);
+	if (err) {
+		fp_pw_thread_loop_unlock(loop);
+		free(data);
+		return err;
+	}
+	err = azaStreamBlockInit(&data->block, stream);
+	if (err) {
+		fp_pw_thread_loop_unlock(loop);
+		azaStreamSRCDeinit(&data->src);
+		free(data);
+		return err;
+	}
+	err = azaCommandQueueInit(&stream->commands, stream->commandCapacity);
+	if (err) {
+		fp_pw_thread_loop_unlock(loop);
+		azaStreamBlockDeinit(&data->block);
+		azaStreamSRCDeinit(&data->src);
+		free(data);
+		return err;
+	}
+	// The most frames the mixCallback can see at once
+	size_t mixFrames = azaStreamSRCActive(&data->src) ? data->src.mixBuffer.frames : AZA_PIPEWIRE_MAX_QUANTUM;
+	if (azaStreamBlockActive(&data->block)) {
+		mixFrames = data->block.buffer.frames;
+	}
+	data->scratch = azaScratchBlockReserve(mixFrames, AZA_MAX(stream->channels, AZAUDIO_REVERB_LINES), AZAUDIO_SCRATCH_DEFAULT_DEPTH);
+	if (!data->scratch) {
+		fp_pw_thread_loop_unlock(loop);
+		azaCommandQueueDeinit(&stream->commands);
+		azaStreamBlockDeinit(&data->block);
+		azaStreamSRCDeinit(&data->src);
+		free(data);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
 	
 	data->stream = fp_pw_stream_new_simple(
 		fp_pw_thread_loop_get_loop(loop),
@@ -567,6 +672,10 @@ static void azaStreamDeinitPipewire(azaStream *stream) {
 	fp_pw_stream_disconnect(data->stream);
 	fp_pw_stream_destroy(data->stream);
 	fp_pw_thread_loop_unlock(loop);
+	azaStreamSRCDeinit(&data->src);
+	azaStreamBlockDeinit(&data->block);
+	azaCommandQueueDeinit(&stream->commands);
+	azaScratchBlockFree(data->scratch);
 	free(data);
 }
 
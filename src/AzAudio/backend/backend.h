@@ -7,6 +7,8 @@
 #ifndef AZAUDIO_BACKEND_H
 #define AZAUDIO_BACKEND_H
 
+#include "interface.h"
+
 #ifdef __unix
 
 // TODO: Some of these will be stubs that return 0 until their backends get implemented.
@@ -31,4 +33,14 @@ void azaBackendWintendoDeinit();
 
 #endif
 
+// Available everywhere, implemented in offline.c
+
+int azaBackendNullInit();
+void azaBackendNullDeinit();
+
+int azaBackendFileInit();
+void azaBackendFileDeinit();
+
+int azaStreamRenderOffline(azaStream *stream, size_t frames);
+
 #endif // AZAUDIO_BACKEND_H
\ No newline at end of file
@@ -9,43 +9,92 @@
 #include "backend.h"
 #include "../error.h"
 
-typedef enum azaBackend {
-	AZA_BACKEND_NONE=0,
+// What azaSetBackend asked for, which outlives azaBackendDeinit
+static azaBackend requested = AZA_BACKEND_NONE;
+// What azaBackendInit ended up with
+static azaBackend backend = AZA_BACKEND_NONE;
+
+void azaSetBackend(azaBackend value) {
+	requested = value;
+}
+
+azaBackend azaGetBackend() {
+	return backend != AZA_BACKEND_NONE ? backend : requested;
+}
+
+// Inits one backend by its enum, returning AZA_ERROR_BACKEND_UNAVAILABLE if it isn't one this platform has
+static int azaBackendInitKind(azaBackend kind) {
+	switch (kind) {
 #ifdef __unix
-	AZA_BACKEND_PIPEWIRE,
-	AZA_BACKEND_PULSEAUDIO,
-	AZA_BACKEND_JACK,
-	AZA_BACKEND_ALSA,
+		case AZA_BACKEND_PIPEWIRE:
+			return azaBackendPipewireInit();
+		case AZA_BACKEND_PULSEAUDIO:
+			return azaBackendPulseAudioInit();
+		case AZA_BACKEND_JACK:
+			return azaBackendJackInit();
+		case AZA_BACKEND_ALSA:
+			return azaBackendALSAInit();
 #elif defined(_WIN32)
-	AZA_BACKEND_WINTENDO,
+		case AZA_BACKEND_WINTENDO:
+			return azaBackendWintendoInit();
 #endif
-} azaBackend;
-static azaBackend backend = AZA_BACKEND_NONE;
+		case AZA_BACKEND_NULL:
+			return azaBackendNullInit();
+		case AZA_BACKEND_FILE:
+			return azaBackendFileInit();
+		default:
+			return AZA_ERROR_BACKEND_UNAVAILABLE;
+	}
+}
 
-int azaBackendInit() {
-	if (0) {
+static const char* azaBackendName(azaBackend kind) {
+	switch (kind) {
 #ifdef __unix
-	} else if (AZA_SUCCESS == azaBackendPipewireInit()) {
-		backend = AZA_BACKEND_PIPEWIRE;
-		AZA_PRINT_INFO("AzAudio will use backend \"Pipewire\"\n");
-	} else if (AZA_SUCCESS == azaBackendPulseAudioInit()) {
-		backend = AZA_BACKEND_PULSEAUDIO;
-		AZA_PRINT_INFO("AzAudio will use backend \"PulseAudio\"\n");
-	} else if (AZA_SUCCESS == azaBackendJackInit()) {
-		backend = AZA_BACKEND_JACK;
-		AZA_PRINT_INFO("AzAudio will use backend \"Jack\"\n");
-	} else if (AZA_SUCCESS == azaBackendALSAInit()) {
-		backend = AZA_BACKEND_ALSA;
-		AZA_PRINT_INFO("AzAudio will use backend \"ALSA\"\n");
+		case AZA_BACKEND_PIPEWIRE: return "Pipewire";
+		case AZA_BACKEND_PULSEAUDIO: return "PulseAudio";
+		case AZA_BACKEND_JACK: return "Jack";
+		case AZA_BACKEND_ALSA: return "ALSA";
 #elif defined(_WIN32)
-	} else if (AZA_SUCCESS == azaBackendWintendoInit()) {
-		backend = AZA_BACKEND_WINTENDO;
-		AZA_PRINT_INFO("AzAudio will use backend \"Wintendo >.>\"\n");
+		case AZA_BACKEND_WINTENDO: return "Wintendo >.>";
 #endif
-	} else {
-		return AZA_ERROR_BACKEND_UNAVAILABLE;
+		case AZA_BACKEND_NULL: return "Null";
+		case AZA_BACKEND_FILE: return "File";
+		default: return "None";
 	}
-	return AZA_SUCCESS;
+}
+
+int azaBackendInit() {
+	backend = requested;
+	if (backend == AZA_BACKEND_NONE) {
+		const char *env = getenv("AZAUDIO_BACKEND");
+		if (env && strcmp(env, "null") == 0) {
+			backend = AZA_BACKEND_NULL;
+		} else if (env && strcmp(env, "file") == 0) {
+			backend = AZA_BACKEND_FILE;
+		}
+	}
+	if (backend != AZA_BACKEND_NONE) {
+		int err = azaBackendInitKind(backend);
+		if (err) {
+			AZA_PRINT_ERR("azaBackendInit error: backend \"%s\" failed to init (%d)\n", azaBackendName(backend), err);
+			backend = AZA_BACKEND_NONE;
+			return err;
+		}
+		AZA_PRINT_INFO("AzAudio will use backend \"%s\"\n", azaBackendName(backend));
+		return AZA_SUCCESS;
+	}
+	// The device backends in order of preference, then one that always works
+	for (int kind = AZA_BACKEND_NONE+1; kind <= AZA_BACKEND_NULL; kind++) {
+		if (AZA_SUCCESS == azaBackendInitKind((azaBackend)kind)) {
+			backend = (azaBackend)kind;
+			if (kind == AZA_BACKEND_NULL) {
+				AZA_PRINT_INFO("AzAudio found no audio devices, so streams will run without one\n");
+			}
+			AZA_PRINT_INFO("AzAudio will use backend \"%s\"\n", azaBackendName(backend));
+			return AZA_SUCCESS;
+		}
+	}
+	return AZA_ERROR_BACKEND_UNAVAILABLE;
 }
 
 void azaBackendDeinit() {
@@ -68,8 +117,23 @@ void azaBackendDeinit() {
 			azaBackendWintendoDeinit();
 			break;
 #endif
+		case AZA_BACKEND_NULL:
+			azaBackendNullDeinit();
+			break;
+		case AZA_BACKEND_FILE:
+			azaBackendFileDeinit();
+			break;
 		default: break;
 	}
+	backend = AZA_BACKEND_NONE;
+}
+
+int azaStreamRender(azaStream *stream, size_t frames) {
+	if (backend != AZA_BACKEND_NULL && backend != AZA_BACKEND_FILE) {
+		AZA_PRINT_ERR("azaStreamRender error: only streams on the null and file backends can be rendered\n");
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	return azaStreamRenderOffline(stream, frames);
 }
 
 fp_azaStreamInit azaStreamInit;
@@ -8,11 +8,37 @@
 #define AZAUDIO_INTERFACE_H
 
 #include "../dsp.h"
+#include "../commands.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef enum azaBackend {
+	// Let azaBackendInit choose
+	AZA_BACKEND_NONE=0,
+#ifdef __unix
+	AZA_BACKEND_PIPEWIRE,
+	AZA_BACKEND_PULSEAUDIO,
+	AZA_BACKEND_JACK,
+	AZA_BACKEND_ALSA,
+#elif defined(_WIN32)
+	AZA_BACKEND_WINTENDO,
+#endif
+	// No device at all. Output goes nowhere and input is silent, with the stream keeping its own time.
+	AZA_BACKEND_NULL,
+	// Like AZA_BACKEND_NULL, but the device name passed to azaStreamInit is a file to write output to or read input from.
+	// Files ending in .wav are 32-bit float WAV (or 16, 24 or 32-bit PCM for input), anything else is raw 32-bit float interleaved.
+	AZA_BACKEND_FILE,
+} azaBackend;
+
+// Picks the backend for azaInit to use, which must be called before it.
+// Left as AZA_BACKEND_NONE, the environment variable AZAUDIO_BACKEND can be "null" or "file" to choose one of those,
+// otherwise the first device backend that works gets used, falling back to AZA_BACKEND_NULL if none do.
+void azaSetBackend(azaBackend backend);
+// The backend in use after azaInit, otherwise whatever azaSetBackend asked for
+azaBackend azaGetBackend();
+
 // Find out what backends are available, picks one, and set up function pointers.
 int azaBackendInit();
 void azaBackendDeinit();
@@ -24,19 +50,47 @@ typedef enum azaDeviceInterface {
 
 typedef int (*fp_azaMixCallback)(azaBuffer buffer, void *userData);
 
+// How streams on AZA_BACKEND_NULL and AZA_BACKEND_FILE keep time, since there's no device doing it for them
+typedef enum azaStreamClock {
+	// On a thread of the stream's own, in step with the wall clock like a device would be
+	AZA_STREAM_CLOCK_REALTIME=0,
+	// On a thread of the stream's own, as fast as it can
+	AZA_STREAM_CLOCK_FAST,
+	// Only on the thread calling azaStreamRender, which runs as fast as it can
+	AZA_STREAM_CLOCK_MANUAL,
+} azaStreamClock;
+
 typedef struct {
 	// backend-specific data
 	void *data;
+	// Parameter changes for the mixCallback, which any thread can post to once the stream is initialized.
+	// Each one is applied right before the mixCallback gets to its frame, which counts frames at mixSamplerate.
+	azaCommandQueue commands;
 	
 	// User configuration
 	
 	azaDeviceInterface deviceInterface;
 	// Leave at 0 for device default
 	size_t samplerate;
+	// Samplerate the mixCallback runs at, so all the DSP can be set up for one rate no matter the device.
+	// Leave at 0 to match samplerate. Otherwise the stream converts between the two with a polyphase resampler.
+	size_t mixSamplerate;
+	// Quality of that conversion, where 0 means AZA_RESAMPLE_QUALITY_32
+	azaResampleQuality resampleQuality;
 	// Leave at 0 for device default
 	size_t channels;
+	// Set to AZA_TRUE to have mixCallback receive planar buffers (one plane per channel)
+	int planar;
+	// Leave at 0 to have mixCallback take however many frames the device asks for each time.
+	// Otherwise it always gets exactly this many (such as 64), which keeps the mix's working set the same size every call,
+	// and commands apply on block boundaries. A FIFO of up to one block makes up the difference with the device.
+	size_t blockFrames;
 	fp_azaMixCallback mixCallback;
 	void *userdata;
+	// How many commands can be waiting at once, leave at 0 for AZAUDIO_COMMAND_DEFAULT_CAPACITY
+	uint32_t commandCapacity;
+	// Only used by AZA_BACKEND_NULL and AZA_BACKEND_FILE
+	azaStreamClock clock;
 } azaStream;
 
 typedef int (*fp_azaStreamInit)(azaStream *stream, const char *device);
@@ -45,6 +99,10 @@ extern fp_azaStreamInit azaStreamInit;
 typedef void (*fp_azaStreamDeinit)(azaStream *stream);
 extern fp_azaStreamDeinit azaStreamDeinit;
 
+// Runs a stream with clock AZA_STREAM_CLOCK_MANUAL for frames frames at stream->samplerate, for rendering faster than realtime.
+// Returns AZA_ERROR_INVALID_CONFIGURATION for any other stream.
+int azaStreamRender(azaStream *stream, size_t frames);
+
 typedef size_t (*fp_azaGetDeviceCount)(azaDeviceInterface interface);
 extern fp_azaGetDeviceCount azaGetDeviceCount;
 
@@ -0,0 +1,485 @@
+/*
+	File: offline.c
+	Author: Philip Haynes
+	Backends that don't need a sound server. Null throws output away and feeds silence in, file writes output to and reads input from files.
+	Streams keep their own time, so they can run in realtime, as fast as they can, or only when azaStreamRender says so.
+*/
+
+#include "backend.h"
+#include "interface.h"
+#include "streamsrc.h"
+#include "streamblock.h"
+#include "../error.h"
+#include "../AzAudio.h"
+#include "../helpers.h"
+
+#include <threads.h>
+
+// Frames per callback, like a sound server's quantum
+#define AZAUDIO_OFFLINE_FRAMES 512
+
+#define AZA_WAV_FORMAT_PCM 1
+#define AZA_WAV_FORMAT_FLOAT 3
+#define AZA_WAV_FORMAT_EXTENSIBLE 0xFFFE
+// Where the sizes that are only known once the stream ends go in the header we write
+#define AZA_WAV_RIFF_SIZE_OFFSET 4
+#define AZA_WAV_FACT_FRAMES_OFFSET 46
+#define AZA_WAV_DATA_SIZE_OFFSET 54
+
+// Set by whichever of the two backends was initialized
+static int offlineFiles = 0;
+
+typedef struct azaStreamOffline {
+	azaStreamSRC src;
+	azaStreamBlock block;
+	// What a device would hand us, planar only if the stream is
+	azaBuffer buffer;
+	// Interleaved samples on their way to or from the file, which are buffer's own unless the stream is planar
+	float *interleaved;
+	// The file's bytes for one callback
+	unsigned char *bytes;
+	FILE *file;
+	// Set for WAV output, whose header gets its sizes filled in when the stream ends
+	int wav;
+	// How samples are stored in the file
+	uint16_t format;
+	uint16_t bitsPerSample;
+	// Bytes of samples left to read for input, or written so far for output
+	uint64_t dataBytes;
+	// Reserved by azaStreamInit for the thread that mixes to adopt before its first mix, and then whichever arena it gave back
+	azaScratchBlock *scratch;
+	int scratchAdopted;
+	thrd_t thread;
+	int threadStarted;
+	int stop;
+} azaStreamOffline;
+
+static void azaWriteU16(unsigned char *dst, uint16_t value) {
+	dst[0] = (unsigned char)value;
+	dst[1] = (unsigned char)(value >> 8);
+}
+
+static void azaWriteU32(unsigned char *dst, uint32_t value) {
+	for (int i = 0; i < 4; i++) {
+		dst[i] = (unsigned char)(value >> (i * 8));
+	}
+}
+
+static uint16_t azaReadU16(const unsigned char *src) {
+	return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static uint32_t azaReadU32(const unsigned char *src) {
+	return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+// 32-bit float with a fact chunk, as the spec wants for anything that isn't PCM. The sizes are filled in by azaWavFinish.
+static int azaWavWriteHeader(FILE *file, size_t channels, size_t samplerate) {
+	unsigned char header[58];
+	memcpy(header, "RIFF", 4);
+	azaWriteU32(header + AZA_WAV_RIFF_SIZE_OFFSET, 0);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	azaWriteU32(header + 16, 18);
+	azaWriteU16(header + 20, AZA_WAV_FORMAT_FLOAT);
+	azaWriteU16(header + 22, (uint16_t)channels);
+	azaWriteU32(header + 24, (uint32_t)samplerate);
+	azaWriteU32(header + 28, (uint32_t)(samplerate * channels * sizeof(float)));
+	azaWriteU16(header + 32, (uint16_t)(channels * sizeof(float)));
+	azaWriteU16(header + 34, 32);
+	azaWriteU16(header + 36, 0);
+	memcpy(header + 38, "fact", 4);
+	azaWriteU32(header + 42, 4);
+	azaWriteU32(header + AZA_WAV_FACT_FRAMES_OFFSET, 0);
+	memcpy(header + 50, "data", 4);
+	azaWriteU32(header + AZA_WAV_DATA_SIZE_OFFSET, 0);
+	return fwrite(header, sizeof(header), 1, file) == 1 ? AZA_SUCCESS : AZA_ERROR_BACKEND_ERROR;
+}
+
+static void azaWavFinish(FILE *file, uint64_t dataBytes, size_t channels) {
+	// Sizes past 4GiB don't fit, so those files get the biggest size there is and readers can hope for the best
+	uint32_t data = dataBytes > UINT32_MAX - 58 ? UINT32_MAX - 58 : (uint32_t)dataBytes;
+	unsigned char value[4];
+	azaWriteU32(value, data + 50);
+	fseek(file, AZA_WAV_RIFF_SIZE_OFFSET, SEEK_SET);
+	fwrite(value, 4, 1, file);
+	azaWriteU32(value, (uint32_t)(data / (channels * sizeof(float))));
+	fseek(file, AZA_WAV_FACT_FRAMES_OFFSET, SEEK_SET);
+	fwrite(value, 4, 1, file);
+	azaWriteU32(value, data);
+	fseek(file, AZA_WAV_DATA_SIZE_OFFSET, SEEK_SET);
+	fwrite(value, 4, 1, file);
+}
+
+// Finds the format and data chunks, leaving the file at the first sample
+static int azaWavReadHeader(azaStreamOffline *data, FILE *file, size_t *channels, size_t *samplerate) {
+	unsigned char riff[12];
+	if (fread(riff, sizeof(riff), 1, file) != 1 || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) {
+		AZA_PRINT_ERR("azaWavReadHeader error: not a WAV file\n");
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	int haveFormat = 0;
+	unsigned char chunk[8];
+	while (fread(chunk, sizeof(chunk), 1, file) == 1) {
+		uint32_t size = azaReadU32(chunk + 4);
+		// Chunks are padded to an even size, which has to come from the size before any of it is read
+		uint32_t pad = size & 1;
+		if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+			unsigned char format[40] = {0};
+			uint32_t read = AZA_MIN(size, (uint32_t)sizeof(format));
+			if (fread(format, read, 1, file) != 1) break;
+			data->format = azaReadU16(format);
+			*channels = azaReadU16(format + 2);
+			*samplerate = azaReadU32(format + 4);
+			data->bitsPerSample = azaReadU16(format + 14);
+			if (data->format == AZA_WAV_FORMAT_EXTENSIBLE && read >= 26) {
+				// The sub format GUID starts with the format it would have had
+				data->format = azaReadU16(format + 24);
+			}
+			haveFormat = 1;
+			size -= read;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			if (!haveFormat) break;
+			data->dataBytes = size;
+			int supported = (data->format == AZA_WAV_FORMAT_PCM && (data->bitsPerSample == 16 || data->bitsPerSample == 24 || data->bitsPerSample == 32))
+				|| (data->format == AZA_WAV_FORMAT_FLOAT && data->bitsPerSample == 32);
+			if (!supported || *channels == 0 || *samplerate == 0) {
+				AZA_PRINT_ERR("azaWavReadHeader error: unsupported format %u with %u bits per sample\n", data->format, data->bitsPerSample);
+				return AZA_ERROR_INVALID_CONFIGURATION;
+			}
+			return AZA_SUCCESS;
+		}
+		if (fseek(file, (long)size + pad, SEEK_CUR)) break;
+	}
+	AZA_PRINT_ERR("azaWavReadHeader error: no %s chunk\n", haveFormat ? "data" : "fmt");
+	return AZA_ERROR_INVALID_CONFIGURATION;
+}
+
+static int azaEndsWith(const char *string, const char *suffix) {
+	size_t length = strlen(string);
+	size_t suffixLength = strlen(suffix);
+	return length >= suffixLength && strcmp(string + length - suffixLength, suffix) == 0;
+}
+
+// Reads frames frames from the file into data->interleaved, with silence for whatever isn't there
+static void azaStreamOfflineRead(azaStream *stream, azaStreamOffline *data, size_t frames) {
+	size_t samples = frames * stream->channels;
+	size_t read = 0;
+	if (data->file) {
+		size_t sampleBytes = data->bitsPerSample / 8;
+		size_t bytes = (size_t)AZA_MIN((uint64_t)(samples * sampleBytes), data->dataBytes);
+		bytes = fread(data->bytes, 1, bytes, data->file);
+		data->dataBytes -= bytes;
+		read = bytes / sampleBytes;
+		const unsigned char *src = data->bytes;
+		for (size_t i = 0; i < read; i++, src += sampleBytes) {
+			float sample;
+			if (data->format == AZA_WAV_FORMAT_FLOAT) {
+				uint32_t bits = azaReadU32(src);
+				memcpy(&sample, &bits, sizeof(sample));
+			} else if (sampleBytes == 2) {
+				sample = (float)(int16_t)azaReadU16(src) / 32768.0f;
+			} else if (sampleBytes == 3) {
+				// Into the top of an int32 so the sign comes along
+				int32_t value = (int32_t)(((uint32_t)src[0] << 8) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 24));
+				sample = (float)value / 2147483648.0f;
+			} else {
+				sample = (float)(int32_t)azaReadU32(src) / 2147483648.0f;
+			}
+			data->interleaved[i] = sample;
+		}
+	}
+	memset(data->interleaved + read, 0, sizeof(float) * (samples - read));
+}
+
+static void azaStreamOfflineWrite(azaStream *stream, azaStreamOffline *data, size_t frames) {
+	size_t samples = frames * stream->channels;
+	unsigned char *dst = data->bytes;
+	for (size_t i = 0; i < samples; i++, dst += 4) {
+		uint32_t bits;
+		memcpy(&bits, &data->interleaved[i], sizeof(bits));
+		azaWriteU32(dst, bits);
+	}
+	data->dataBytes += fwrite(data->bytes, 1, samples * sizeof(float), data->file);
+}
+
+// One callback's worth of frames, which is what a device would do
+static int azaStreamOfflineProcess(azaStream *stream, azaStreamOffline *data, size_t frames) {
+	azaBuffer buffer = data->buffer;
+	buffer.frames = frames;
+	azaBuffer interleaved = {
+		.samples = data->interleaved,
+		.frames = frames,
+		.stride = stream->channels,
+		.channels = stream->channels,
+		.samplerate = stream->samplerate,
+	};
+	if AZA_UNLIKELY(!data->scratchAdopted) {
+		// Just swaps pointers, the arena was allocated by azaStreamInit
+		data->scratch = azaScratchAdopt(data->scratch);
+		data->scratchAdopted = 1;
+	}
+	int err;
+	if (stream->deviceInterface == AZA_OUTPUT) {
+		if (azaStreamSRCActive(&data->src)) {
+			err = azaStreamSRCOutput(&data->src, &data->block, stream, buffer);
+		} else {
+			err = azaStreamBlockMix(&data->block, stream, buffer);
+		}
+		if (data->file) {
+			if (buffer.planes) {
+				azaBufferCopy(interleaved, buffer);
+			}
+			azaStreamOfflineWrite(stream, data, frames);
+		}
+	} else {
+		azaStreamOfflineRead(stream, data, frames);
+		if (buffer.planes) {
+			azaBufferCopy(buffer, interleaved);
+		}
+		if (azaStreamSRCActive(&data->src)) {
+			err = azaStreamSRCInput(&data->src, &data->block, stream, buffer);
+		} else {
+			err = azaStreamBlockMix(&data->block, stream, buffer);
+		}
+	}
+	return err;
+}
+
+static int azaStreamOfflineThread(void *userData) {
+	azaStream *stream = userData;
+	azaStreamOffline *data = stream->data;
+	// This thread is all ours, so there's no mode to put back
+	azaFlushDenormalsBegin();
+	uint64_t start = aza_now_ns();
+	uint64_t frames = 0;
+	while (!__atomic_load_n(&data->stop, __ATOMIC_ACQUIRE)) {
+		azaStreamOfflineProcess(stream, data, AZAUDIO_OFFLINE_FRAMES);
+		frames += AZAUDIO_OFFLINE_FRAMES;
+		if (stream->clock == AZA_STREAM_CLOCK_REALTIME) {
+			// Against the start rather than the last callback so sleeping late doesn't drift
+			uint64_t due = start + frames * 1000000000ull / stream->samplerate;
+			uint64_t now = aza_now_ns();
+			if (due > now) {
+				uint64_t wait = due - now;
+				struct timespec timespec = {
+					.tv_sec = (time_t)(wait / 1000000000ull),
+					.tv_nsec = (long)(wait % 1000000000ull),
+				};
+				thrd_sleep(&timespec, NULL);
+			}
+		}
+	}
+	return 0;
+}
+
+// Safe on partially initialized streams, as long as data came from calloc
+static void azaStreamOfflineFree(azaStream *stream, azaStreamOffline *data) {
+	if (data->threadStarted) {
+		__atomic_store_n(&data->stop, 1, __ATOMIC_RELEASE);
+		thrd_join(data->thread, NULL);
+	}
+	if (data->file) {
+		if (data->wav && stream->deviceInterface == AZA_OUTPUT) {
+			azaWavFinish(data->file, data->dataBytes, stream->channels);
+		}
+		fclose(data->file);
+	}
+	azaStreamBlockDeinit(&data->block);
+	azaStreamSRCDeinit(&data->src);
+	if (data->buffer.samples) {
+		if (data->interleaved != data->buffer.samples) {
+			free(data->interleaved);
+		}
+		azaBufferDeinit(&data->buffer);
+	}
+	free(data->bytes);
+	azaScratchBlockFree(data->scratch);
+	azaCommandQueueDeinit(&stream->commands);
+	free(data);
+}
+
+// Opens the stream's file, working out its channels and samplerate for input
+static int azaStreamOfflineOpen(azaStream *stream, azaStreamOffline *data, const char *device) {
+	int isDefault = device == NULL || strcmp(device, "default") == 0;
+	const char *path = device;
+	if (isDefault) {
+		path = stream->deviceInterface == AZA_OUTPUT ? "AzAudioOutput.wav" : "AzAudioInput.wav";
+	}
+	data->wav = azaEndsWith(path, ".wav") || azaEndsWith(path, ".WAV");
+	if (stream->deviceInterface == AZA_OUTPUT) {
+		data->file = fopen(path, "wb");
+		if (!data->file) {
+			AZA_PRINT_ERR("azaStreamInitFile error: couldn't open \"%s\" for writing\n", path);
+			return AZA_ERROR_BACKEND_ERROR;
+		}
+		AZA_PRINT_INFO("Writing output to \"%s\"\n", path);
+		return AZA_SUCCESS;
+	}
+	data->file = fopen(path, "rb");
+	if (!data->file) {
+		if (isDefault) {
+			// Nothing was asked for, so we're as good as the null backend
+			AZA_PRINT_INFO("No \"%s\" to read input from, so it'll be silent\n", path);
+			return AZA_SUCCESS;
+		}
+		AZA_PRINT_ERR("azaStreamInitFile error: couldn't open \"%s\" for reading\n", path);
+		return AZA_ERROR_BACKEND_ERROR;
+	}
+	AZA_PRINT_INFO("Reading input from \"%s\"\n", path);
+	if (!data->wav) {
+		data->format = AZA_WAV_FORMAT_FLOAT;
+		data->bitsPerSample = 32;
+		data->dataBytes = UINT64_MAX;
+		return AZA_SUCCESS;
+	}
+	size_t channels = 0, samplerate = 0;
+	int err = azaWavReadHeader(data, data->file, &channels, &samplerate);
+	if (err) return err;
+	if (stream->channels && stream->channels != channels) {
+		AZA_PRINT_ERR("azaStreamInitFile error: \"%s\" has %zu channels, but the stream wants %zu\n", path, channels, stream->channels);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	stream->channels = channels;
+	// The file is the device, so a different rate asked for becomes the mix rate
+	if (stream->samplerate && stream->samplerate != samplerate && stream->mixSamplerate == 0) {
+		stream->mixSamplerate = stream->samplerate;
+	}
+	stream->samplerate = samplerate;
+	return AZA_SUCCESS;
+}
+
+static int azaStreamInitOffline(azaStream *stream, const char *device) {
+	if (stream->mixCallback == NULL) {
+		AZA_PRINT_ERR("azaStreamInitOffline error: no mix callback provided.\n");
+		return AZA_ERROR_NULL_POINTER;
+	}
+	if (stream->deviceInterface != AZA_OUTPUT && stream->deviceInterface != AZA_INPUT) {
+		AZA_PRINT_ERR("azaStreamInitOffline error: stream->deviceInterface (%d) is invalid.\n", stream->deviceInterface);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	int err = azaCommandQueueInit(&stream->commands, stream->commandCapacity);
+	if (err) return err;
+	azaStreamOffline *data = calloc(sizeof(azaStreamOffline), 1);
+	if (!data) {
+		azaCommandQueueDeinit(&stream->commands);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	if (offlineFiles) {
+		err = azaStreamOfflineOpen(stream, data, device);
+		if (err) goto fail;
+	}
+	if (stream->channels == 0)
+		stream->channels = AZA_CHANNELS_DEFAULT;
+	if (stream->samplerate == 0)
+		stream->samplerate = AZA_SAMPLERATE_DEFAULT;
+	if (stream->mixSamplerate == 0)
+		stream->mixSamplerate = stream->samplerate;
+
+	data->buffer.frames = AZAUDIO_OFFLINE_FRAMES;
+	data->buffer.channels = stream->channels;
+	data->buffer.samplerate = stream->samplerate;
+	err = stream->planar ? azaBufferInitPlanar(&data->buffer) : azaBufferInit(&data->buffer);
+	if (err) {
+		data->buffer.samples = NULL;
+		goto fail;
+	}
+	data->interleaved = stream->planar ? malloc(sizeof(float) * AZAUDIO_OFFLINE_FRAMES * stream->channels) : data->buffer.samples;
+	data->bytes = malloc(sizeof(float) * AZAUDIO_OFFLINE_FRAMES * stream->channels);
+	if (!data->interleaved || !data->bytes) {
+		err = AZA_ERROR_OUT_OF_MEMORY;
+		goto fail;
+	}
+	err = azaStreamSRCInit(&data->src, stream);
+	if (err) goto fail;
+	err = azaStreamBlockInit(&data->block, stream);
+	if (err) goto fail;
+	// The most frames the mixCallback can see at once
+	size_t mixFrames = azaStreamSRCActive(&data->src) ? data->src.mixBuffer.frames : AZAUDIO_OFFLINE_FRAMES;
+	if (azaStreamBlockActive(&data->block)) {
+		mixFrames = data->block.buffer.frames;
+	}
+	data->scratch = azaScratchBlockReserve(mixFrames, AZA_MAX(stream->channels, AZAUDIO_REVERB_LINES), AZAUDIO_SCRATCH_DEFAULT_DEPTH);
+	if (!data->scratch) {
+		err = AZA_ERROR_OUT_OF_MEMORY;
+		goto fail;
+	}
+	if (data->file && data->wav && stream->deviceInterface == AZA_OUTPUT) {
+		err = azaWavWriteHeader(data->file, stream->channels, stream->samplerate);
+		if (err) goto fail;
+	}
+	stream->data = data;
+	if (stream->clock != AZA_STREAM_CLOCK_MANUAL) {
+		if (thrd_create(&data->thread, azaStreamOfflineThread, stream) != thrd_success) {
+			AZA_PRINT_ERR("azaStreamInitOffline error: failed to start the stream's thread\n");
+			err = AZA_ERROR_BACKEND_ERROR;
+			goto fail;
+		}
+		data->threadStarted = 1;
+	}
+	return AZA_SUCCESS;
+fail:
+	azaStreamOfflineFree(stream, data);
+	stream->data = NULL;
+	return err;
+}
+
+static void azaStreamDeinitOffline(azaStream *stream) {
+	azaStreamOfflineFree(stream, stream->data);
+	stream->data = NULL;
+}
+
+int azaStreamRenderOffline(azaStream *stream, size_t frames) {
+	azaStreamOffline *data = stream->data;
+	if (data == NULL || stream->clock != AZA_STREAM_CLOCK_MANUAL) {
+		AZA_PRINT_ERR("azaStreamRender error: the stream needs to be initialized with AZA_STREAM_CLOCK_MANUAL\n");
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	uint32_t denormals = azaFlushDenormalsBegin();
+	int err = AZA_SUCCESS;
+	for (size_t done = 0; done < frames && !err;) {
+		size_t chunk = AZA_MIN(frames - done, AZAUDIO_OFFLINE_FRAMES);
+		err = azaStreamOfflineProcess(stream, data, chunk);
+		done += chunk;
+	}
+	azaFlushDenormalsEnd(denormals);
+	return err;
+}
+
+static size_t azaGetDeviceCountOffline(azaDeviceInterface interface) {
+	return 1;
+}
+
+static const char* azaGetDeviceNameOffline(azaDeviceInterface interface, size_t index) {
+	if (!offlineFiles) return "Null";
+	return interface == AZA_OUTPUT ? "AzAudioOutput.wav" : "AzAudioInput.wav";
+}
+
+static size_t azaGetDeviceChannelsOffline(azaDeviceInterface interface, size_t index) {
+	return AZA_CHANNELS_DEFAULT;
+}
+
+static void azaBackendOfflineBind() {
+	azaStreamInit = azaStreamInitOffline;
+	azaStreamDeinit = azaStreamDeinitOffline;
+	azaGetDeviceCount = azaGetDeviceCountOffline;
+	azaGetDeviceName = azaGetDeviceNameOffline;
+	azaGetDeviceChannels = azaGetDeviceChannelsOffline;
+}
+
+int azaBackendNullInit() {
+	offlineFiles = 0;
+	azaBackendOfflineBind();
+	return AZA_SUCCESS;
+}
+
+void azaBackendNullDeinit() {
+}
+
+int azaBackendFileInit() {
+	offlineFiles = 1;
+	azaBackendOfflineBind();
+	return AZA_SUCCESS;
+}
+
+void azaBackendFileDeinit() {
+}
@@ -0,0 +1,115 @@
+/*
+	File: streamblock.c
+	Author: Philip Haynes
+*/
+
+#include "streamblock.h"
+
+#include "../error.h"
+#include "../helpers.h"
+
+int azaStreamBlockInit(azaStreamBlock *data, azaStream *stream) {
+	data->buffer.samples = NULL;
+	data->buffer.planes = NULL;
+	data->start = 0;
+	data->count = 0;
+	if (stream->blockFrames == 0) return AZA_SUCCESS;
+	if (stream->planar && stream->channels > AZAUDIO_STREAMBLOCK_MAX_CHANNELS) {
+		AZA_PRINT_ERR("azaStreamBlockInit error: planar streams with blocks can't have more than %d channels (had %zu).\n", AZAUDIO_STREAMBLOCK_MAX_CHANNELS, stream->channels);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	data->buffer.frames = stream->blockFrames;
+	data->buffer.channels = stream->channels;
+	data->buffer.samplerate = stream->mixSamplerate;
+	int err = stream->planar ? azaBufferInitPlanar(&data->buffer) : azaBufferInit(&data->buffer);
+	if (err) {
+		data->buffer.samples = NULL;
+		data->buffer.planes = NULL;
+	}
+	return err;
+}
+
+void azaStreamBlockDeinit(azaStreamBlock *data) {
+	if (!azaStreamBlockActive(data)) return;
+	azaBufferDeinit(&data->buffer);
+	data->buffer.samples = NULL;
+	data->buffer.planes = NULL;
+}
+
+// One whole block, with the commands due by its first frame applied first
+static int azaStreamBlockRun(azaStream *stream, azaBuffer block) {
+	if (stream->commands.slots) {
+		azaCommandQueueApply(&stream->commands);
+	}
+	int err = stream->mixCallback(block, stream->userdata);
+	if (stream->commands.slots) {
+		azaCommandQueueAdvance(&stream->commands, block.frames);
+	}
+	return err;
+}
+
+static int azaStreamBlockOutput(azaStreamBlock *data, azaStream *stream, azaBuffer buffer) {
+	float *planes[AZAUDIO_STREAMBLOCK_MAX_CHANNELS];
+	float *planesBlock[AZAUDIO_STREAMBLOCK_MAX_CHANNELS];
+	size_t blockFrames = data->buffer.frames;
+	size_t done = 0;
+	if (data->count) {
+		done = AZA_MIN(data->count, buffer.frames);
+		azaBufferCopy(azaBufferSlice(buffer, 0, done, planes), azaBufferSlice(data->buffer, data->start, done, planesBlock));
+		data->start += done;
+		data->count -= done;
+	}
+	// Whole blocks go straight into the device buffer
+	while (buffer.frames - done >= blockFrames) {
+		int err = azaStreamBlockRun(stream, azaBufferSlice(buffer, done, blockFrames, planes));
+		if (err) return err;
+		done += blockFrames;
+	}
+	if (done < buffer.frames) {
+		int err = azaStreamBlockRun(stream, data->buffer);
+		if (err) return err;
+		size_t frames = buffer.frames - done;
+		azaBufferCopy(azaBufferSlice(buffer, done, frames, planes), azaBufferSlice(data->buffer, 0, frames, planesBlock));
+		data->start = frames;
+		data->count = blockFrames - frames;
+	}
+	return AZA_SUCCESS;
+}
+
+static int azaStreamBlockInput(azaStreamBlock *data, azaStream *stream, azaBuffer buffer) {
+	float *planes[AZAUDIO_STREAMBLOCK_MAX_CHANNELS];
+	float *planesBlock[AZAUDIO_STREAMBLOCK_MAX_CHANNELS];
+	size_t blockFrames = data->buffer.frames;
+	size_t done = 0;
+	if (data->count) {
+		done = AZA_MIN(blockFrames - data->count, buffer.frames);
+		azaBufferCopy(azaBufferSlice(data->buffer, data->count, done, planesBlock), azaBufferSlice(buffer, 0, done, planes));
+		data->count += done;
+		if (data->count < blockFrames) return AZA_SUCCESS;
+		data->count = 0;
+		int err = azaStreamBlockRun(stream, data->buffer);
+		if (err) return err;
+	}
+	// Whole blocks get processed right where the device put them
+	while (buffer.frames - done >= blockFrames) {
+		int err = azaStreamBlockRun(stream, azaBufferSlice(buffer, done, blockFrames, planes));
+		if (err) return err;
+		done += blockFrames;
+	}
+	if (done < buffer.frames) {
+		data->count = buffer.frames - done;
+		azaBufferCopy(azaBufferSlice(data->buffer, 0, data->count, planesBlock), azaBufferSlice(buffer, done, data->count, planes));
+	}
+	return AZA_SUCCESS;
+}
+
+int azaStreamBlockMix(azaStreamBlock *data, azaStream *stream, azaBuffer buffer) {
+	if (!azaStreamBlockActive(data)) {
+		return azaCommandQueueMix(&stream->commands, buffer, stream->mixCallback, stream->userdata);
+	}
+	if (stream->deviceInterface == AZA_OUTPUT) {
+		return azaStreamBlockOutput(data, stream, buffer);
+	} else {
+		return azaStreamBlockInput(data, stream, buffer);
+	}
+}
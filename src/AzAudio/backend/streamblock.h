@@ -0,0 +1,43 @@
+/*
+	File: streamblock.h
+	Author: Philip Haynes
+	Running the mixCallback in fixed-size blocks no matter how many frames the device asks for, shared by all the backends.
+*/
+
+#ifndef AZAUDIO_STREAMBLOCK_H
+#define AZAUDIO_STREAMBLOCK_H
+
+#include "interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The most channels a planar stream can have with blocks active
+#define AZAUDIO_STREAMBLOCK_MAX_CHANNELS 64
+
+typedef struct azaStreamBlock {
+	// One block at stream->mixSamplerate, planar only if the stream is.
+	// For output it holds what's left of the last block mixed, and for input what's come in towards the next one.
+	azaBuffer buffer;
+	// Where the frames waiting in buffer start, and how many there are
+	size_t start;
+	size_t count;
+} azaStreamBlock;
+
+// Returns AZA_SUCCESS without doing anything if stream->blockFrames is 0
+int azaStreamBlockInit(azaStreamBlock *data, azaStream *stream);
+void azaStreamBlockDeinit(azaStreamBlock *data);
+// Nonzero if the mixCallback runs in fixed blocks
+static inline int azaStreamBlockActive(azaStreamBlock *data) {
+	return data->buffer.samples != NULL;
+}
+// Runs stream->mixCallback for buffer at stream->mixSamplerate, applying the stream's commands on the way.
+// If blocks are active, the mixCallback only ever sees stream->blockFrames frames, and commands apply on block boundaries.
+int azaStreamBlockMix(azaStreamBlock *data, azaStream *stream, azaBuffer buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_STREAMBLOCK_H
@@ -0,0 +1,81 @@
+/*
+	File: streamsrc.c
+	Author: Philip Haynes
+*/
+
+#include "streamsrc.h"
+
+#include "../error.h"
+#include "../helpers.h"
+
+int azaStreamSRCInit(azaStreamSRC *data, azaStream *stream) {
+	data->mixBuffer.samples = NULL;
+	data->mixBuffer.planes = NULL;
+	if (stream->mixSamplerate == stream->samplerate) return AZA_SUCCESS;
+	// Once per channel for the whole mix is cheap, so default to the best we have
+	azaResampleQuality quality = stream->resampleQuality ? stream->resampleQuality : AZA_RESAMPLE_QUALITY_32;
+	size_t srcSamplerate, dstSamplerate;
+	if (stream->deviceInterface == AZA_OUTPUT) {
+		srcSamplerate = stream->mixSamplerate;
+		dstSamplerate = stream->samplerate;
+	} else {
+		srcSamplerate = stream->samplerate;
+		dstSamplerate = stream->mixSamplerate;
+	}
+	int err = azaResamplerInit(&data->resampler, stream->channels, srcSamplerate, dstSamplerate, AZAUDIO_STREAMSRC_MAX_FRAMES, quality);
+	if (err) return err;
+	data->mixBuffer.frames = data->resampler.history.frames;
+	data->mixBuffer.channels = stream->channels;
+	data->mixBuffer.samplerate = stream->mixSamplerate;
+	err = stream->planar ? azaBufferInitPlanar(&data->mixBuffer) : azaBufferInit(&data->mixBuffer);
+	if (err) {
+		azaResamplerDeinit(&data->resampler);
+		data->mixBuffer.samples = NULL;
+		data->mixBuffer.planes = NULL;
+	}
+	return err;
+}
+
+void azaStreamSRCDeinit(azaStreamSRC *data) {
+	if (!azaStreamSRCActive(data)) return;
+	azaBufferDeinit(&data->mixBuffer);
+	azaResamplerDeinit(&data->resampler);
+	data->mixBuffer.samples = NULL;
+	data->mixBuffer.planes = NULL;
+}
+
+int azaStreamSRCOutput(azaStreamSRC *data, azaStreamBlock *block, azaStream *stream, azaBuffer buffer) {
+	float *planes[AZAUDIO_RESAMPLER_MAX_CHANNELS];
+	for (size_t done = 0; done < buffer.frames;) {
+		size_t frames = AZA_MIN(buffer.frames - done, AZAUDIO_STREAMSRC_MAX_FRAMES);
+		size_t needed = azaResamplerNeeded(&data->resampler, frames);
+		if (needed) {
+			azaBuffer mix = azaBufferSlice(data->mixBuffer, 0, needed, planes);
+			int err = azaStreamBlockMix(block, stream, mix);
+			if (err) return err;
+			azaBufferCopy(azaResamplerInput(&data->resampler, needed), mix);
+			azaResamplerCommit(&data->resampler, needed);
+		}
+		azaResamplerProcess(&data->resampler, azaBufferSlice(buffer, done, frames, planes));
+		done += frames;
+	}
+	return AZA_SUCCESS;
+}
+
+int azaStreamSRCInput(azaStreamSRC *data, azaStreamBlock *block, azaStream *stream, azaBuffer buffer) {
+	float *planes[AZAUDIO_RESAMPLER_MAX_CHANNELS];
+	for (size_t done = 0; done < buffer.frames;) {
+		size_t frames = AZA_MIN(buffer.frames - done, AZAUDIO_STREAMSRC_MAX_FRAMES);
+		azaBufferCopy(azaResamplerInput(&data->resampler, frames), azaBufferSlice(buffer, done, frames, planes));
+		azaResamplerCommit(&data->resampler, frames);
+		size_t available;
+		while ((available = azaResamplerAvailable(&data->resampler))) {
+			azaBuffer mix = azaBufferSlice(data->mixBuffer, 0, AZA_MIN(available, AZAUDIO_STREAMSRC_MAX_FRAMES), planes);
+			azaResamplerProcess(&data->resampler, mix);
+			int err = azaStreamBlockMix(block, stream, mix);
+			if (err) return err;
+		}
+		done += frames;
+	}
+	return AZA_SUCCESS;
+}
@@ -0,0 +1,43 @@
+/*
+	File: streamsrc.h
+	Author: Philip Haynes
+	Samplerate conversion between the device and the mixCallback, shared by all the backends.
+*/
+
+#ifndef AZAUDIO_STREAMSRC_H
+#define AZAUDIO_STREAMSRC_H
+
+#include "interface.h"
+#include "streamblock.h"
+#include "../resample.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The most device frames converted at once, bigger requests get split up
+#define AZAUDIO_STREAMSRC_MAX_FRAMES 4096
+
+typedef struct azaStreamSRC {
+	azaResampler resampler;
+	// What the mixCallback sees, at stream->mixSamplerate and planar only if the stream is
+	azaBuffer mixBuffer;
+} azaStreamSRC;
+
+// Returns AZA_SUCCESS without doing anything if stream->mixSamplerate is the same as stream->samplerate
+int azaStreamSRCInit(azaStreamSRC *data, azaStream *stream);
+void azaStreamSRCDeinit(azaStreamSRC *data);
+// Nonzero if the stream needs to be converted
+static inline int azaStreamSRCActive(azaStreamSRC *data) {
+	return data->mixBuffer.samples != NULL;
+}
+// Mixes at stream->mixSamplerate through block as many times as needed to fill buffer at stream->samplerate
+int azaStreamSRCOutput(azaStreamSRC *data, azaStreamBlock *block, azaStream *stream, azaBuffer buffer);
+// Converts buffer from stream->samplerate, mixing at stream->mixSamplerate through block for as many frames as that makes
+int azaStreamSRCInput(azaStreamSRC *data, azaStreamBlock *block, azaStream *stream, azaBuffer buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_STREAMSRC_H
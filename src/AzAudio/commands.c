@@ -0,0 +1,189 @@
+/*
+	File: commands.c
+	Author: Philip Haynes
+*/
+
+#include "commands.h"
+
+#include "error.h"
+#include "helpers.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int azaCommandQueueInit(azaCommandQueue *queue, uint32_t capacity) {
+	memset(queue, 0, sizeof(*queue));
+	if (capacity == 0) capacity = AZAUDIO_COMMAND_DEFAULT_CAPACITY;
+	if (capacity > (UINT32_MAX >> 1) + 1) {
+		AZA_PRINT_ERR("azaCommandQueueInit error: capacity (%u) is too big.\n", capacity);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	// The ring's indices wrap with a mask
+	uint32_t size = 1;
+	while (size < capacity) size <<= 1;
+	queue->slots = malloc(sizeof(azaCommandSlot) * size);
+	queue->pending = malloc(sizeof(azaCommand) * size);
+	if (!queue->slots || !queue->pending) {
+		free(queue->slots);
+		free(queue->pending);
+		queue->slots = NULL;
+		queue->pending = NULL;
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	// Slot i is ready for whoever claims index i
+	for (uint32_t i = 0; i < size; i++) {
+		queue->slots[i].sequence = i;
+	}
+	queue->capacity = size;
+	return AZA_SUCCESS;
+}
+
+void azaCommandQueueDeinit(azaCommandQueue *queue) {
+	free(queue->slots);
+	free(queue->pending);
+	queue->slots = NULL;
+	queue->pending = NULL;
+	queue->capacity = 0;
+}
+
+int azaCommandPost(azaCommandQueue *queue, const azaCommand *command) {
+	uint64_t mask = queue->capacity - 1;
+	uint64_t index = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+	azaCommandSlot *slot;
+	while (1) {
+		slot = &queue->slots[index & mask];
+		uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+		int64_t lap = (int64_t)(sequence - index);
+		if (lap == 0) {
+			// The slot is free, so try to claim it. Losing only means another producer got it first.
+			if (__atomic_compare_exchange_n(&queue->tail, &index, index + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+		} else if (lap < 0) {
+			// The audio thread hasn't taken what was posted here a lap ago, so we're full
+			__atomic_add_fetch(&queue->dropped, 1, __ATOMIC_RELAXED);
+			return AZA_ERROR_QUEUE_FULL;
+		} else {
+			index = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+		}
+	}
+	slot->command = *command;
+	__atomic_store_n(&slot->sequence, index + 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&queue->posted, 1, __ATOMIC_RELAXED);
+	return AZA_SUCCESS;
+}
+
+int azaCommandSetFloat(azaCommandQueue *queue, float *target, float value, uint64_t frame) {
+	azaCommand command;
+	memset(&command, 0, sizeof(command));
+	command.kind = AZA_COMMAND_SET_FLOAT;
+	command.target = target;
+	command.value.f = value;
+	command.frame = frame;
+	return azaCommandPost(queue, &command);
+}
+
+int azaCommandSetInt(azaCommandQueue *queue, int *target, int value, uint64_t frame) {
+	azaCommand command;
+	memset(&command, 0, sizeof(command));
+	command.kind = AZA_COMMAND_SET_INT;
+	command.target = target;
+	command.value.i = value;
+	command.frame = frame;
+	return azaCommandPost(queue, &command);
+}
+
+uint64_t azaCommandQueueNow(azaCommandQueue *queue) {
+	return __atomic_load_n(&queue->frame, __ATOMIC_ACQUIRE);
+}
+
+azaCommandQueueStats azaCommandQueueGetStats(azaCommandQueue *queue) {
+	azaCommandQueueStats stats;
+	stats.posted = __atomic_load_n(&queue->posted, __ATOMIC_RELAXED);
+	stats.dropped = __atomic_load_n(&queue->dropped, __ATOMIC_RELAXED);
+	stats.highWater = __atomic_load_n(&queue->highWater, __ATOMIC_RELAXED);
+	stats.capacity = queue->capacity;
+	return stats;
+}
+
+static void azaCommandRun(const azaCommand *command) {
+	switch (command->kind) {
+		case AZA_COMMAND_SET_FLOAT:
+			*(float*)command->target = command->value.f;
+			break;
+		case AZA_COMMAND_SET_INT:
+			*(int*)command->target = command->value.i;
+			break;
+		case AZA_COMMAND_SET_POINTER:
+			*(void**)command->target = command->value.p;
+			break;
+		case AZA_COMMAND_CALL:
+			command->value.callback(command->target, command->userData);
+			break;
+	}
+}
+
+size_t azaCommandQueueApply(azaCommandQueue *queue) {
+	uint64_t now = queue->frame;
+	// What was waiting on a future frame comes first, since it was all posted before anything still on the ring
+	uint32_t due = 0;
+	while (due < queue->pendingCount && queue->pending[due].frame <= now) {
+		azaCommandRun(&queue->pending[due]);
+		due++;
+	}
+	if (due) {
+		queue->pendingCount -= due;
+		memmove(queue->pending, queue->pending + due, sizeof(azaCommand) * queue->pendingCount);
+	}
+	uint64_t mask = queue->capacity - 1;
+	uint32_t waiting = queue->pendingCount;
+	// If pending fills up, the rest stay on the ring until there's room, and if that fills up too, posting fails
+	while (queue->pendingCount < queue->capacity) {
+		azaCommandSlot *slot = &queue->slots[queue->head & mask];
+		if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != queue->head + 1) break;
+		azaCommand command = slot->command;
+		// Hand the slot back to producers for the next lap
+		__atomic_store_n(&slot->sequence, queue->head + queue->capacity, __ATOMIC_RELEASE);
+		queue->head++;
+		waiting++;
+		if (command.frame <= now) {
+			azaCommandRun(&command);
+			continue;
+		}
+		// Sorted by frame, and in the order they were posted for the same frame
+		uint32_t i = queue->pendingCount;
+		while (i > 0 && queue->pending[i-1].frame > command.frame) {
+			queue->pending[i] = queue->pending[i-1];
+			i--;
+		}
+		queue->pending[i] = command;
+		queue->pendingCount++;
+	}
+	if (waiting > queue->highWater) {
+		__atomic_store_n(&queue->highWater, waiting, __ATOMIC_RELAXED);
+	}
+	if (queue->pendingCount == 0) return SIZE_MAX;
+	uint64_t until = queue->pending[0].frame - now;
+	return until > SIZE_MAX ? SIZE_MAX : (size_t)until;
+}
+
+void azaCommandQueueAdvance(azaCommandQueue *queue, size_t frames) {
+	__atomic_store_n(&queue->frame, queue->frame + frames, __ATOMIC_RELEASE);
+}
+
+int azaCommandQueueMix(azaCommandQueue *queue, azaBuffer buffer, fp_azaCommandMixCallback callback, void *userData) {
+	if (!queue->slots) {
+		return callback(buffer, userData);
+	}
+	float *planes[AZAUDIO_COMMAND_MAX_CHANNELS];
+	// Too many planes to slice means changes only land on block boundaries
+	int split = !buffer.planes || buffer.channels <= AZAUDIO_COMMAND_MAX_CHANNELS;
+	for (size_t done = 0; done < buffer.frames;) {
+		size_t frames = buffer.frames - done;
+		size_t until = azaCommandQueueApply(queue);
+		if (split) frames = AZA_MIN(frames, until);
+		int err = callback(frames == buffer.frames ? buffer : azaBufferSlice(buffer, done, frames, planes), userData);
+		azaCommandQueueAdvance(queue, frames);
+		if (err) return err;
+		done += frames;
+	}
+	return AZA_SUCCESS;
+}
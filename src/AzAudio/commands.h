@@ -0,0 +1,120 @@
+/*
+	File: commands.h
+	Author: Philip Haynes
+	A fixed-capacity queue that carries parameter changes from any number of threads into the mix, each at the frame it's meant for.
+*/
+
+#ifndef AZAUDIO_COMMANDS_H
+#define AZAUDIO_COMMANDS_H
+
+#include "dsp.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AZAUDIO_COMMAND_DEFAULT_CAPACITY 256
+// The most channels a planar buffer can have when it's split around commands
+#define AZAUDIO_COMMAND_MAX_CHANNELS 64
+
+typedef enum azaCommandKind {
+	// *(float*)target = value.f
+	AZA_COMMAND_SET_FLOAT=0,
+	// *(int*)target = value.i
+	AZA_COMMAND_SET_INT,
+	// *(void**)target = value.p, such as for swapping out a pNext
+	AZA_COMMAND_SET_POINTER,
+	// value.callback(target, userData), for anything that takes more than one write
+	AZA_COMMAND_CALL,
+} azaCommandKind;
+
+typedef void (*fp_azaCommandCallback)(void *target, void *userData);
+
+typedef struct azaCommand {
+	azaCommandKind kind;
+	void *target;
+	union {
+		float f;
+		int i;
+		void *p;
+		fp_azaCommandCallback callback;
+	} value;
+	void *userData;
+	// The frame of the mix this applies at, counted from when the queue was initialized (see azaCommandQueueNow).
+	// Commands for frames that have already been mixed apply before the next one, so 0 means as soon as possible.
+	uint64_t frame;
+} azaCommand;
+
+typedef struct azaCommandSlot {
+	// Which lap of the ring the slot is ready for, which tells producers and the consumer whose turn it is
+	uint64_t sequence;
+	azaCommand command;
+} azaCommandSlot;
+
+// Everything in here is managed by the queue
+typedef struct azaCommandQueue {
+	azaCommandSlot *slots;
+	uint32_t capacity;
+	// Producers claim slots here
+	uint64_t tail;
+	// Commands that made it onto the ring
+	uint64_t posted;
+	// Commands that didn't because the ring was full
+	uint64_t dropped;
+	// Keeps what producers write and what the audio thread writes on separate cache lines
+	char pad[64];
+	// Everything from here on is only written by the audio thread
+	uint64_t head;
+	// Commands taken off the ring that aren't due yet, sorted by frame and then by when they were posted
+	azaCommand *pending;
+	uint32_t pendingCount;
+	// The most commands that were ever waiting at once, to help size capacity
+	uint32_t highWater;
+	// The next frame to be mixed
+	uint64_t frame;
+} azaCommandQueue;
+
+// Allocates every slot up front, so posting never allocates. capacity is rounded up to a power of 2, where 0 means AZAUDIO_COMMAND_DEFAULT_CAPACITY.
+int azaCommandQueueInit(azaCommandQueue *queue, uint32_t capacity);
+void azaCommandQueueDeinit(azaCommandQueue *queue);
+
+// Safe to call from any number of threads at once. Never blocks or allocates.
+// Returns AZA_ERROR_QUEUE_FULL if there was no room, in which case the command is dropped and counted.
+int azaCommandPost(azaCommandQueue *queue, const azaCommand *command);
+
+// Shorthands for posting the most common commands
+int azaCommandSetFloat(azaCommandQueue *queue, float *target, float value, uint64_t frame);
+int azaCommandSetInt(azaCommandQueue *queue, int *target, int value, uint64_t frame);
+
+// The next frame the audio thread will mix, which is as soon as a command could possibly apply.
+// Add however much latency you'd like between posting and hearing to schedule changes sample-accurately.
+uint64_t azaCommandQueueNow(azaCommandQueue *queue);
+
+typedef struct azaCommandQueueStats {
+	uint64_t posted;
+	uint64_t dropped;
+	uint32_t highWater;
+	uint32_t capacity;
+} azaCommandQueueStats;
+
+// Safe to call from any thread.
+azaCommandQueueStats azaCommandQueueGetStats(azaCommandQueue *queue);
+
+// Audio thread only. Applies every command due by the queue's current frame and returns how many frames
+// can be mixed before the next one is due, or SIZE_MAX if nothing's waiting.
+size_t azaCommandQueueApply(azaCommandQueue *queue);
+// Audio thread only. Advances the queue's frame after frames have been mixed.
+void azaCommandQueueAdvance(azaCommandQueue *queue, size_t frames);
+
+typedef int (*fp_azaCommandMixCallback)(azaBuffer buffer, void *userData);
+
+// Audio thread only. Calls callback on buffer, splitting it wherever a command is due so every change lands on its frame.
+int azaCommandQueueMix(azaCommandQueue *queue, azaBuffer buffer, fp_azaCommandMixCallback callback, void *userData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_COMMANDS_H
@@ -7,49 +7,196 @@
 
 #include "error.h"
 #include "helpers.h"
+#include "simd.h"
+#include "fastmath.h"
+#include "resample.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <threads.h>
 #include <assert.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 
 #define AZA_MAX_SIDE_BUFFERS 64
-thread_local azaBuffer sideBufferPool[AZA_MAX_SIDE_BUFFERS] = {{}};
-thread_local size_t sideBufferCapacity[AZA_MAX_SIDE_BUFFERS] = {0};
-thread_local size_t sideBuffersInUse = 0;
+// Side buffers start on 64 byte boundaries
+#define AZA_SCRATCH_ALIGN 16
+
+// Side buffers are bump allocated from a scratch arena owned by each thread.
+// If azaScratchReserve didn't make it big enough, a bigger block is allocated and the older ones are freed once nothing uses them.
+struct azaScratchBlock {
+	struct azaScratchBlock *prev;
+	float *samples;
+	size_t capacity;
+	size_t used;
+};
+
+// Where the arena was before a side buffer was pushed, so popping it puts things back
+typedef struct azaScratchMark {
+	azaScratchBlock *block;
+	size_t used;
+	size_t inUse;
+} azaScratchMark;
+
+static thread_local azaScratchBlock *scratch = NULL;
+static thread_local azaScratchMark scratchMarks[AZA_MAX_SIDE_BUFFERS];
+static thread_local size_t sideBuffersInUse = 0;
+// Samples in use across every block
+static thread_local size_t scratchInUse = 0;
+
+static size_t scratchHighWater = 0;
+static size_t scratchGrowths = 0;
+
+static azaScratchBlock* azaScratchBlockAlloc(size_t capacity, azaScratchBlock *prev) {
+	azaScratchBlock *block = malloc(sizeof(azaScratchBlock));
+	if (!block) return NULL;
+	// capacity is a multiple of AZA_SCRATCH_ALIGN, as aligned_alloc wants
+	block->samples = aligned_alloc(AZA_SCRATCH_ALIGN * sizeof(float), sizeof(float) * capacity);
+	if (!block->samples) {
+		free(block);
+		return NULL;
+	}
+	block->prev = prev;
+	block->capacity = capacity;
+	block->used = 0;
+	return block;
+}
+
+void azaScratchBlockFree(azaScratchBlock *block) {
+	while (block) {
+		azaScratchBlock *prev = block->prev;
+		free(block->samples);
+		free(block);
+		block = prev;
+	}
+}
+
+static size_t azaScratchRound(size_t samples) {
+	return (samples + AZA_SCRATCH_ALIGN - 1) & ~(size_t)(AZA_SCRATCH_ALIGN - 1);
+}
+
+int azaScratchReserve(size_t frames, size_t channels, size_t depth) {
+	assert(sideBuffersInUse == 0);
+	size_t capacity = azaScratchRound(frames * channels) * depth;
+	if (capacity == 0) {
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	if (scratch && scratch->capacity >= capacity) return AZA_SUCCESS;
+	azaScratchBlock *block = azaScratchBlockAlloc(capacity, NULL);
+	if (!block) return AZA_ERROR_OUT_OF_MEMORY;
+	azaScratchBlockFree(scratch);
+	scratch = block;
+	return AZA_SUCCESS;
+}
+
+azaScratchBlock* azaScratchBlockReserve(size_t frames, size_t channels, size_t depth) {
+	size_t capacity = azaScratchRound(frames * channels) * depth;
+	if (capacity == 0) return NULL;
+	return azaScratchBlockAlloc(capacity, NULL);
+}
+
+azaScratchBlock* azaScratchAdopt(azaScratchBlock *block) {
+	assert(sideBuffersInUse == 0);
+	if (!block || (scratch && scratch->capacity >= block->capacity)) return block;
+	azaScratchBlock *previous = scratch;
+	scratch = block;
+	return previous;
+}
+
+void azaScratchFree() {
+	assert(sideBuffersInUse == 0);
+	azaScratchBlockFree(scratch);
+	scratch = NULL;
+}
+
+azaScratchStats azaScratchGetStats() {
+	return (azaScratchStats) {
+		.capacity = scratch ? scratch->capacity : 0,
+		.highWater = __atomic_load_n(&scratchHighWater, __ATOMIC_RELAXED),
+		.growths = __atomic_load_n(&scratchGrowths, __ATOMIC_RELAXED),
+	};
+}
 
+void azaScratchResetStats() {
+	__atomic_store_n(&scratchHighWater, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&scratchGrowths, 0, __ATOMIC_RELAXED);
+}
+
+// If the arena needed to grow and couldn't, the buffer's samples are NULL and the caller should return AZA_ERROR_OUT_OF_MEMORY.
+// It still has to be popped, which the DSP dispatch does for anything that returns early.
 static azaBuffer azaPushSideBuffer(size_t frames, size_t channels, size_t samplerate) {
 	assert(sideBuffersInUse < AZA_MAX_SIDE_BUFFERS);
-	azaBuffer *buffer = &sideBufferPool[sideBuffersInUse];
-	size_t *capacity = &sideBufferCapacity[sideBuffersInUse];
-	size_t capacityNeeded = frames * channels;
-	if (*capacity < capacityNeeded) {
-		if (*capacity) {
-			azaBufferDeinit(buffer);
-		}
-	}
-	buffer->frames = frames;
-	buffer->stride = channels;
-	buffer->channels = channels;
-	buffer->samplerate = samplerate;
-	if (*capacity < capacityNeeded) {
-		azaBufferInit(buffer);
-		*capacity = capacityNeeded;
-	}
+	size_t samples = azaScratchRound(frames * channels);
+	scratchMarks[sideBuffersInUse] = (azaScratchMark) {
+		.block = scratch,
+		.used = scratch ? scratch->used : 0,
+		.inUse = scratchInUse,
+	};
 	sideBuffersInUse++;
-	return *buffer;
+	if AZA_UNLIKELY(!scratch || scratch->used + samples > scratch->capacity) {
+		// Big enough for everything in use now, so once the older blocks are freed the same work fits in this one.
+		// The older blocks stay put until everything in them is popped.
+		size_t capacity = AZA_MAX(scratchInUse + samples, scratch ? scratch->capacity * 2 : samples * AZAUDIO_SCRATCH_DEFAULT_DEPTH);
+		azaScratchBlock *block = azaScratchBlockAlloc(capacity, scratch);
+		if (!block) {
+			return (azaBuffer) {
+				.samples = NULL,
+				.frames = 0,
+				.stride = channels,
+				.channels = channels,
+				.samplerate = samplerate,
+				.planes = NULL,
+			};
+		}
+#ifndef NDEBUG
+		AZA_PRINT_ERR("azaPushSideBuffer: the scratch arena of %zu samples was too small, so %zu were allocated on the audio thread. Reserve more up front.\n", scratch ? scratch->capacity : 0, capacity);
+#endif
+		scratch = block;
+		__atomic_add_fetch(&scratchGrowths, 1, __ATOMIC_RELAXED);
+		// Pushed on the new block, so popping it goes back to the start of it
+		scratchMarks[sideBuffersInUse-1].block = scratch;
+		scratchMarks[sideBuffersInUse-1].used = 0;
+	}
+	azaBuffer buffer = {
+		.samples = scratch->samples + scratch->used,
+		.frames = frames,
+		.stride = channels,
+		.channels = channels,
+		.samplerate = samplerate,
+		.planes = NULL,
+	};
+	scratch->used += samples;
+	scratchInUse += samples;
+	size_t highWater = __atomic_load_n(&scratchHighWater, __ATOMIC_RELAXED);
+	while (scratchInUse > highWater && !__atomic_compare_exchange_n(&scratchHighWater, &highWater, scratchInUse, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return buffer;
 }
 
 static void azaPopSideBuffer() {
 	assert(sideBuffersInUse > 0);
 	sideBuffersInUse--;
+	azaScratchMark *mark = &scratchMarks[sideBuffersInUse];
+	// No block if the arena was empty and failed to grow
+	if (mark->block) mark->block->used = mark->used;
+	scratchInUse = mark->inUse;
+	if (sideBuffersInUse == 0 && scratch && scratch->prev) {
+		azaScratchBlockFree(scratch->prev);
+		scratch->prev = NULL;
+	}
+}
+
+// Pops side buffers until there are only depth of them, for anything that returned without popping its own
+static void azaPopSideBuffersTo(size_t depth) {
+	while (sideBuffersInUse > depth) {
+		azaPopSideBuffer();
+	}
 }
 
 
 
 static int azaCheckBuffer(azaBuffer buffer) {
-	if (buffer.samples == NULL) {
+	if (buffer.samples == NULL && buffer.planes == NULL) {
 		return AZA_ERROR_NULL_POINTER;
 	}
 	if (buffer.channels < 1) {
@@ -64,6 +211,7 @@ static int azaCheckBuffer(azaBuffer buffer) {
 
 
 int azaBufferInit(azaBuffer *data) {
+	data->planes = NULL;
 	if (data->frames < 1) {
 		data->samples = NULL;
 		return AZA_ERROR_INVALID_FRAME_COUNT;
@@ -73,7 +221,35 @@ int azaBufferInit(azaBuffer *data) {
 	return AZA_SUCCESS;
 }
 
+int azaBufferInitPlanar(azaBuffer *data) {
+	if (data->frames < 1) {
+		data->samples = NULL;
+		data->planes = NULL;
+		return AZA_ERROR_INVALID_FRAME_COUNT;
+	}
+	if (data->channels < 1) {
+		data->samples = NULL;
+		data->planes = NULL;
+		return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	}
+	// One allocation holds both the plane pointers and the samples
+	size_t planesSize = aza_align(sizeof(float*) * data->channels, 64);
+	size_t planeFrames = aza_align(data->frames, 16);
+	char *block = malloc(planesSize + sizeof(float) * planeFrames * data->channels);
+	data->planes = (float**)block;
+	data->samples = (float*)(block + planesSize);
+	for (size_t c = 0; c < data->channels; c++) {
+		data->planes[c] = data->samples + c * planeFrames;
+	}
+	data->stride = 1;
+	return AZA_SUCCESS;
+}
+
 int azaBufferDeinit(azaBuffer *data) {
+	if (data->planes != NULL) {
+		free(data->planes);
+		return AZA_SUCCESS;
+	}
 	if (data->samples != NULL) {
 		free(data->samples);
 		return AZA_SUCCESS;
@@ -85,27 +261,31 @@ int azaBufferDeinit(azaBuffer *data) {
 
 void azaBufferMix(azaBuffer dst, float volumeDst, azaBuffer src, float volumeSrc) {
 	assert(dst.frames == src.frames);
-	assert(dst.stride == src.stride);
 	assert(dst.channels == src.channels);
-	if AZA_UNLIKELY(volumeDst == 0.0f && volumeSrc == 0.0f) {
-		for (size_t i = 0; i < dst.frames*dst.channels; i++) {
-			dst.samples[i] = 0.0f;
-		}
-	} else if (volumeDst == 1.0f && volumeSrc == 1.0f) {
-		for (size_t i = 0; i < dst.frames*dst.channels; i++) {
-			dst.samples[i] = dst.samples[i] + src.samples[i];
-		}
-	} else if AZA_LIKELY(volumeDst == 1.0f) {
-		for (size_t i = 0; i < dst.frames*dst.channels; i++) {
-			dst.samples[i] = dst.samples[i] + src.samples[i] * volumeSrc;
+	int zero = volumeDst == 0.0f && volumeSrc == 0.0f;
+	if (!dst.planes && !src.planes && dst.stride == dst.channels && src.stride == src.channels) {
+		if AZA_UNLIKELY(zero) {
+			memset(dst.samples, 0, sizeof(float) * dst.frames * dst.channels);
+		} else {
+			azaKernel.mix(dst.samples, volumeDst, src.samples, volumeSrc, dst.frames * dst.channels);
 		}
-	} else if (volumeSrc == 1.0f) {
-		for (size_t i = 0; i < dst.frames*dst.channels; i++) {
-			dst.samples[i] = dst.samples[i] * volumeDst + src.samples[i];
+	} else if (dst.stride == 1 && src.stride == 1) {
+		// Planar
+		for (size_t c = 0; c < dst.channels; c++) {
+			float *dstSamples = azaBufferChannelSamples(dst, c);
+			if AZA_UNLIKELY(zero) {
+				memset(dstSamples, 0, sizeof(float) * dst.frames);
+			} else {
+				azaKernel.mix(dstSamples, volumeDst, azaBufferChannelSamples(src, c), volumeSrc, dst.frames);
+			}
 		}
 	} else {
-		for (size_t i = 0; i < dst.frames*dst.channels; i++) {
-			dst.samples[i] = dst.samples[i] * volumeDst + src.samples[i] * volumeSrc;
+		for (size_t c = 0; c < dst.channels; c++) {
+			float *dstSamples = azaBufferChannelSamples(dst, c);
+			float *srcSamples = azaBufferChannelSamples(src, c);
+			for (size_t i = 0; i < dst.frames; i++) {
+				dstSamples[i * dst.stride] = dstSamples[i * dst.stride] * volumeDst + srcSamples[i * src.stride] * volumeSrc;
+			}
 		}
 	}
 }
@@ -114,109 +294,241 @@ void azaBufferCopyChannel(azaBuffer dst, size_t channelDst, azaBuffer src, size_
 	assert(dst.frames == src.frames);
 	assert(channelDst < dst.channels);
 	assert(channelSrc < src.channels);
-	if (dst.stride == 1 && src.stride == 1) {
-		memcpy(dst.samples, src.samples, sizeof(float) * dst.frames);
-	} else if (dst.stride == 1) {
-		for (size_t i = 0; i < dst.frames; i++) {
-			dst.samples[i] = src.samples[i * src.stride + channelSrc];
-		}
-	} else if (src.stride == 1) {
-		for (size_t i = 0; i < dst.frames; i++) {
-			dst.samples[i * dst.stride + channelDst] = src.samples[i];
-		}
-	} else {
-		for (size_t i = 0; i < dst.frames; i++) {
-			dst.samples[i * dst.stride + channelDst] = src.samples[i * src.stride + channelSrc];
-		}
+	azaKernel.copyStrided(azaBufferChannelSamples(dst, channelDst), dst.stride, azaBufferChannelSamples(src, channelSrc), src.stride, dst.frames);
+}
+
+void azaBufferCopy(azaBuffer dst, azaBuffer src) {
+	assert(dst.frames == src.frames);
+	assert(dst.channels == src.channels);
+	if (!dst.planes && !src.planes && dst.stride == dst.channels && src.stride == src.channels) {
+		memcpy(dst.samples, src.samples, sizeof(float) * dst.frames * dst.channels);
+		return;
+	}
+	// Stereo gets a dedicated kernel since it's so common
+	if (dst.channels == 2 && dst.planes && dst.stride == 1 && !src.planes && src.stride == 2) {
+		azaKernel.deinterleave2(dst.planes[0], dst.planes[1], src.samples, dst.frames);
+		return;
+	}
+	if (dst.channels == 2 && src.planes && src.stride == 1 && !dst.planes && dst.stride == 2) {
+		azaKernel.interleave2(dst.samples, src.planes[0], src.planes[1], dst.frames);
+		return;
+	}
+	for (size_t c = 0; c < dst.channels; c++) {
+		azaBufferCopyChannel(dst, c, src, c);
 	}
 }
 
 
 
-int azaDSP(azaBuffer buffer, azaDSPData *data) {
-	switch (data->kind) {
-		case AZA_DSP_RMS: return azaRms(buffer, (azaRmsData*)data);
-		case AZA_DSP_FILTER: return azaFilter(buffer, (azaFilterData*)data);
-		case AZA_DSP_LOOKAHEAD_LIMITER: return azaLookaheadLimiter(buffer, (azaLookaheadLimiterData*)data);
-		case AZA_DSP_COMPRESSOR: return azaCompressor(buffer, (azaCompressorData*)data);
-		case AZA_DSP_DELAY: return azaDelay(buffer, (azaDelayData*)data);
-		case AZA_DSP_REVERB: return azaReverb(buffer, (azaReverbData*)data);
-		case AZA_DSP_SAMPLER: return azaSampler(buffer, (azaSamplerData*)data);
-		case AZA_DSP_GATE: return azaGate(buffer, (azaGateData*)data);
-		default: return AZA_ERROR_INVALID_DSP_STRUCT;
+// Copies count samples out of a power of 2 ring starting at index, in at most 2 segments
+static void azaRingRead(float *dst, const float *ring, size_t capacity, size_t index, size_t count) {
+	index &= capacity - 1;
+	size_t first = AZA_MIN(count, capacity - index);
+	memcpy(dst, ring + index, sizeof(float) * first);
+	memcpy(dst + first, ring, sizeof(float) * (count - first));
+}
+
+// Copies count samples into a power of 2 ring starting at index, in at most 2 segments
+static void azaRingWrite(float *ring, size_t capacity, size_t index, const float *src, size_t count) {
+	index &= capacity - 1;
+	size_t first = AZA_MIN(count, capacity - index);
+	memcpy(ring + index, src, sizeof(float) * first);
+	memcpy(ring, src + first, sizeof(float) * (count - first));
+}
+
+// Returns the sum of the squares of count samples of a power of 2 ring starting at index
+static float azaRingSquareSum(const float *ring, size_t capacity, size_t index, size_t count) {
+	index &= capacity - 1;
+	size_t first = AZA_MIN(count, capacity - index);
+	return azaKernel.dot(ring + index, ring + index, first) + azaKernel.dot(ring, ring, count - first);
+}
+
+#define AZA_TAIL_INFINITE SIZE_MAX
+
+static size_t azaTailAdd(size_t a, size_t b) {
+	return a > AZA_TAIL_INFINITE - b ? AZA_TAIL_INFINITE : a + b;
+}
+
+// How many steps of stepFrames it takes something shrinking by factor every step to fall AZAUDIO_TAIL_DB
+static size_t azaTailDecay(float factor, size_t stepFrames) {
+	if (factor >= 1.0f) return AZA_TAIL_INFINITE;
+	if (factor <= 0.0f) return stepFrames;
+	// ln(10^(AZAUDIO_TAIL_DB/20))
+	float decays = AZAUDIO_TAIL_DB * 0.115129255f;
+	float steps = ceilf(decays / -logf(factor));
+	if (steps >= (float)(AZA_TAIL_INFINITE / AZA_MAX(stepFrames, 1))) return AZA_TAIL_INFINITE;
+	return (size_t)steps * stepFrames;
+}
+
+// The longest tail in a chain is as long as all of them one after the other
+static size_t azaDSPChainTail(azaDSPData *data, azaBuffer buffer) {
+	size_t tail = 0;
+	for (; data; data = data->pNext) {
+		tail = azaTailAdd(tail, azaDSPTail(data, buffer));
 	}
+	return tail;
 }
 
 
 
+static int azaRmsHandleResizes(azaRmsData *data, uint32_t windowSamples) {
+	if (data->windowSamples == windowSamples && data->buffer) return AZA_SUCCESS;
+	if (data->capacity < windowSamples || !data->buffer) {
+		uint32_t capacity = (uint32_t)aza_next_pow2(windowSamples);
+		float *buffer = malloc(sizeof(float) * capacity);
+		if (!buffer) return AZA_ERROR_OUT_OF_MEMORY;
+		free(data->buffer);
+		data->buffer = buffer;
+		data->capacity = capacity;
+	}
+	memset(data->buffer, 0, sizeof(float) * data->capacity);
+	data->windowSamples = windowSamples;
+	data->index = 0;
+	data->squared = 0.0;
+	data->sinceResum = 0;
+	data->phase = 0;
+	data->from = 0.0f;
+	data->to = 0.0f;
+	return AZA_SUCCESS;
+}
+
+// Applies any change to the window, must be called before pushing side buffers since it might allocate
+static int azaRmsPrepare(azaRmsData *data, size_t samplerate) {
+	uint32_t windowSamples = data->window > 0.0f ? (uint32_t)aza_ms_to_samples(data->window, (float)samplerate) : AZAUDIO_RMS_SAMPLES;
+	if (windowSamples < 1) windowSamples = 1;
+	return azaRmsHandleResizes(data, windowSamples);
+}
+
 void azaRmsDataInit(azaRmsData *data) {
 	data->header.kind = AZA_DSP_RMS;
 	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
 
-	data->squared = 0.0f;
-	for (int i = 0; i < AZAUDIO_RMS_SAMPLES; i++) {
-		data->buffer[i] = 0.0f;
-	}
-	data->index = 0;
+	data->buffer = NULL;
+	data->capacity = 0;
+	data->windowSamples = 0;
 }
 
-int azaRms(azaBuffer buffer, azaRmsData *data) {
-	if (data == NULL) {
-		return AZA_ERROR_NULL_POINTER;
+void azaRmsDataDeinit(azaRmsData *data) {
+	free(data->buffer);
+	data->buffer = NULL;
+	data->capacity = 0;
+}
+
+// Replaces samples with the RMS over the window ending at each one
+static void azaRmsProcessSamples(azaRmsData *data, float *samples, size_t frames) {
+	uint32_t window = data->windowSamples;
+	uint32_t mask = data->capacity - 1;
+	float windowInv = 1.0f / (float)window;
+	if (data->decimation <= 1) {
+		for (size_t i = 0; i < frames; i++) {
+			float old = data->buffer[(data->index - window) & mask];
+			float x = samples[i];
+			data->buffer[data->index & mask] = x;
+			data->index++;
+			data->squared += (double)x * (double)x - (double)old * (double)old;
+			// Rounding can leave the sum a hair below zero when the window goes silent
+			samples[i] = sqrtf(AZA_MAX((float)data->squared, 0.0f) * windowInv);
+		}
+		data->sinceResum += (uint32_t)frames;
 	} else {
-		int err = azaCheckBuffer(buffer);
-		if (err) return err;
+		uint32_t decimation = data->decimation;
+		float stepInv = 1.0f / (float)decimation;
+		for (size_t i = 0; i < frames;) {
+			// Chunks never run past the window, so what leaves is all from before this chunk
+			size_t count = AZA_MIN(AZA_MIN(frames - i, decimation - data->phase), window);
+			float added = azaKernel.dot(samples + i, samples + i, count);
+			float removed = azaRingSquareSum(data->buffer, data->capacity, data->index - window, count);
+			azaRingWrite(data->buffer, data->capacity, data->index, samples + i, count);
+			data->index += (uint32_t)count;
+			data->squared += (double)added - (double)removed;
+			data->sinceResum += (uint32_t)count;
+			// Ramps from the last value to the newest one over each period, so the output lags by one period
+			for (size_t j = 0; j < count; j++) {
+				data->phase++;
+				samples[i + j] = data->from + (data->to - data->from) * ((float)data->phase * stepInv);
+			}
+			i += count;
+			if (data->phase == decimation) {
+				data->phase = 0;
+				if (data->sinceResum >= window) {
+					data->squared = azaRingSquareSum(data->buffer, data->capacity, data->index - window, window);
+					data->sinceResum = 0;
+				}
+				data->from = data->to;
+				data->to = sqrtf(AZA_MAX((float)data->squared, 0.0f) * windowInv);
+			}
+		}
+		return;
 	}
-	for (size_t c = 0; c < buffer.channels; c++) {
-		azaRmsData *datum = &data[c];
+	// Summing the whole window again stops rounding errors from the running sum piling up
+	if (data->sinceResum >= window) {
+		data->squared = azaRingSquareSum(data->buffer, data->capacity, data->index - window, window);
+		data->sinceResum = 0;
+	}
+}
 
-		for (size_t i = 0; i < buffer.frames; i++) {
-			size_t s = i * buffer.stride + c;
-			datum->squared -= datum->buffer[datum->index];
-			datum->buffer[datum->index] = buffer.samples[s] * buffer.samples[s];
-			datum->squared += datum->buffer[datum->index];
-			// Deal with potential rounding errors making sqrtf emit NaNs
-			if (datum->squared < 0.0f) datum->squared = 0.0f;
+// The window has to empty out, and decimation lags behind that
+static size_t azaRmsTailFrames(azaRmsData *data, size_t samplerate) {
+	size_t windowSamples = data->window > 0.0f ? aza_ms_to_samples(data->window, (float)samplerate) : AZAUDIO_RMS_SAMPLES;
+	return windowSamples + AZA_MAX(data->decimation, 1);
+}
 
-			if (++datum->index >= AZAUDIO_RMS_SAMPLES)
-				datum->index = 0;
+static size_t azaRmsTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaRmsData *data = (azaRmsData*)dsp;
+	size_t tail = 0;
+	for (size_t c = 0; c < buffer.channels; c++) {
+		tail = AZA_MAX(tail, azaRmsTailFrames(&data[c], buffer.samplerate));
+	}
+	return tail;
+}
 
-			buffer.samples[s] = sqrtf(datum->squared/AZAUDIO_RMS_SAMPLES);
-		}
+static int azaRmsProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaRmsData *data = (azaRmsData*)dsp;
+	for (size_t c = 0; c < buffer.channels; c++) {
+		int err = azaRmsPrepare(&data[c], buffer.samplerate);
+		if (err) return err;
 	}
-	if (data->header.pNext) {
-		return azaDSP(buffer, data->header.pNext);
+	azaBuffer sideBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+	if (!sideBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
+	for (size_t c = 0; c < buffer.channels; c++) {
+		azaBufferCopyChannel(sideBuffer, 0, buffer, c);
+		azaRmsProcessSamples(&data[c], sideBuffer.samples, buffer.frames);
+		azaBufferCopyChannel(buffer, c, sideBuffer, 0);
 	}
+	azaPopSideBuffer();
 	return AZA_SUCCESS;
 }
 
+int azaRms(azaBuffer buffer, azaRmsData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
 
 
-static float azaCubicLimiterSample(float sample) {
-	if (sample > 1.0f)
-		sample = 1.0f;
-	else if (sample < -1.0f)
-		sample = -1.0f;
-	else
-		sample = sample;
-	sample = 1.5 * sample - 0.5f * sample * sample * sample;
-	return sample;
-}
 
 int azaCubicLimiter(azaBuffer buffer) {
 	{
 		int err = azaCheckBuffer(buffer);
 		if (err) return err;
 	}
-	if (buffer.stride == buffer.channels) {
-		for (size_t i = 0; i < buffer.frames*buffer.channels; i++) {
-			buffer.samples[i] = azaCubicLimiterSample(buffer.samples[i]);
+	if (!buffer.planes && buffer.stride == buffer.channels) {
+		azaKernel.cubicLimiter(buffer.samples, buffer.frames * buffer.channels);
+	} else if (!buffer.planes) {
+		for (size_t i = 0; i < buffer.frames; i++) {
+			azaKernel.cubicLimiter(buffer.samples + i * buffer.stride, buffer.channels);
+		}
+	} else if (buffer.stride == 1) {
+		for (size_t c = 0; c < buffer.channels; c++) {
+			azaKernel.cubicLimiter(buffer.planes[c], buffer.frames);
 		}
 	} else {
 		for (size_t c = 0; c < buffer.channels; c++) {
 			for (size_t i = 0; i < buffer.frames; i++) {
-				size_t s = i * buffer.stride + c;
-				buffer.samples[s] = azaCubicLimiterSample(buffer.samples[s]);
+				azaKernel.cubicLimiter(buffer.planes[c] + i * buffer.stride, 1);
 			}
 		}
 	}
@@ -225,502 +537,2053 @@ int azaCubicLimiter(azaBuffer buffer) {
 
 
 
+static void azaLookaheadLimiterReset(azaLookaheadLimiterData *data, uint32_t lookaheadSamples) {
+	data->lookaheadSamples = lookaheadSamples;
+	data->frame = 0;
+	data->dequeFront = 0;
+	data->dequeBack = 0;
+	data->sum = 0.0f;
+	if (data->valBuffer) {
+		memset(data->valBuffer, 0, sizeof(float) * data->capacity);
+		memset(data->maxBuffer, 0, sizeof(float) * data->capacity);
+	}
+}
+
+static int azaLookaheadLimiterHandleResizes(azaLookaheadLimiterData *data, uint32_t lookaheadSamples) {
+	if (data->lookaheadSamples == lookaheadSamples && data->valBuffer) return AZA_SUCCESS;
+	if (data->capacity < lookaheadSamples || !data->valBuffer) {
+		uint32_t capacity = (uint32_t)aza_next_pow2(lookaheadSamples);
+		// 3 float rings and 1 uint32_t ring
+		void *block = malloc(capacity * (3 * sizeof(float) + sizeof(uint32_t)));
+		if (!block) return AZA_ERROR_OUT_OF_MEMORY;
+		free(data->valBuffer);
+		data->valBuffer = (float*)block;
+		data->maxBuffer = data->valBuffer + capacity;
+		data->dequeValues = data->maxBuffer + capacity;
+		data->dequeFrames = (uint32_t*)(data->dequeValues + capacity);
+		data->capacity = capacity;
+	}
+	azaLookaheadLimiterReset(data, lookaheadSamples);
+	return AZA_SUCCESS;
+}
+
 void azaLookaheadLimiterDataInit(azaLookaheadLimiterData *data) {
 	data->header.kind = AZA_DSP_LOOKAHEAD_LIMITER;
 	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
 
-	memset(data->gainBuffer, 0, sizeof(float) * AZAUDIO_LOOKAHEAD_SAMPLES);
-	memset(data->valBuffer, 0, sizeof(float) * AZAUDIO_LOOKAHEAD_SAMPLES);
-	data->index = 0;
-	data->sum = 0.0f;
+	data->valBuffer = NULL;
+	data->maxBuffer = NULL;
+	data->dequeValues = NULL;
+	data->dequeFrames = NULL;
+	data->capacity = 0;
+	azaLookaheadLimiterReset(data, 0);
 }
 
-int azaLookaheadLimiter(azaBuffer buffer, azaLookaheadLimiterData *data) {
-	if (data == NULL) {
-		return AZA_ERROR_NULL_POINTER;
-	} else {
-		int err = azaCheckBuffer(buffer);
-		if (err) return err;
+void azaLookaheadLimiterDataDeinit(azaLookaheadLimiterData *data) {
+	free(data->valBuffer);
+	data->valBuffer = NULL;
+	data->capacity = 0;
+}
+
+// Turns the peaks (dB above the ceiling, at least 0) into gains in dB
+// The gain is the average of the sliding window maximum over the window, which ramps down ahead of every peak and never lets one through.
+static void azaLookaheadLimiterDetect(azaLookaheadLimiterData *data, float *peaks, size_t frames) {
+	uint32_t n = data->lookaheadSamples;
+	uint32_t mask = data->capacity - 1;
+	float nInv = 1.0f / (float)n;
+	for (size_t i = 0; i < frames; i++) {
+		float peak = peaks[i];
+		uint32_t frame = data->frame;
+		// Drop what slid out of the window first, so the deque never holds more than n and fits a ring of exactly n
+		if (data->dequeBack != data->dequeFront && frame - data->dequeFrames[data->dequeFront & mask] >= n) {
+			data->dequeFront++;
+		}
+		// Everything at most as big as the new peak will never be the maximum again
+		while (data->dequeBack != data->dequeFront && data->dequeValues[(data->dequeBack-1) & mask] <= peak) {
+			data->dequeBack--;
+		}
+		data->dequeValues[data->dequeBack & mask] = peak;
+		data->dequeFrames[data->dequeBack & mask] = frame;
+		data->dequeBack++;
+		float max = data->dequeValues[data->dequeFront & mask];
+		uint32_t index = frame & mask;
+		data->sum += max - data->maxBuffer[(frame - n) & mask];
+		data->maxBuffer[index] = max;
+		if (index == 0) {
+			// Keep rounding errors from building up in the running sum
+			data->sum = 0.0f;
+			for (uint32_t j = 0; j < n; j++) {
+				data->sum += data->maxBuffer[(frame - j) & mask];
+			}
+		}
+		data->frame = frame + 1;
+		peaks[i] = data->gainInput - data->sum * nInv;
 	}
+}
+
+// Writes the input delayed by lookaheadSamples-1 into the channel, scaled by gains
+static void azaLookaheadLimiterApply(azaLookaheadLimiterData *data, float *samples, size_t stride, const float *gains, size_t frames, uint32_t frameStart, uint32_t lookaheadSamples, float amountOutput) {
+	uint32_t mask = data->capacity - 1;
+	uint32_t delay = lookaheadSamples - 1;
+	for (size_t i = 0; i < frames; i++) {
+		uint32_t frame = frameStart + (uint32_t)i;
+		size_t s = i * stride;
+		data->valBuffer[frame & mask] = samples[s];
+		float out = clampf(data->valBuffer[(frame - delay) & mask] * gains[i], -1.0f, 1.0f);
+		samples[s] = out * amountOutput;
+	}
+}
+
+// The delayed signal comes out over one lookahead, and the gain ramp averages over another
+static size_t azaLookaheadLimiterTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaLookaheadLimiterData *data = (azaLookaheadLimiterData*)dsp;
+	size_t tail = 0;
 	for (size_t c = 0; c < buffer.channels; c++) {
-		azaLookaheadLimiterData *datum = &data[c];
-		float amountOutput = aza_db_to_ampf(datum->gainOutput);
+		azaLookaheadLimiterData *datum = data->linked ? data : &data[c];
+		size_t lookaheadSamples = datum->lookahead > 0.0f ? aza_ms_to_samples(datum->lookahead, buffer.samplerate) : AZAUDIO_LOOKAHEAD_SAMPLES;
+		tail = AZA_MAX(tail, 2 * AZA_MAX(lookaheadSamples, 1));
+	}
+	return tail;
+}
 
+static int azaLookaheadLimiterProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaLookaheadLimiterData *data = (azaLookaheadLimiterData*)dsp;
+	// Every channel keeps its own delayed signal, but when linked only data[0] keeps the detector state
+	for (size_t c = 0; c < buffer.channels; c++) {
+		azaLookaheadLimiterData *datum = data->linked ? data : &data[c];
+		uint32_t lookaheadSamples = datum->lookahead > 0.0f ? (uint32_t)aza_ms_to_samples(datum->lookahead, buffer.samplerate) : AZAUDIO_LOOKAHEAD_SAMPLES;
+		if (lookaheadSamples < 1) lookaheadSamples = 1;
+		int err = azaLookaheadLimiterHandleResizes(&data[c], lookaheadSamples);
+		if (err) return err;
+	}
+	azaBuffer gainBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+	if (!gainBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
+	if (data->linked) {
+		uint32_t lookaheadSamples = data->lookaheadSamples;
+		float amountOutput = aza_db_to_ampf(data->gainOutput);
+		uint32_t frameStart = data->frame;
 		for (size_t i = 0; i < buffer.frames; i++) {
-			size_t s = i * buffer.stride + c;
-			float peak = buffer.samples[s];
-			float gain = datum->gainInput;
-			if (peak < 0.0f)
-				peak = -peak;
-			peak = aza_amp_to_dbf(peak) + gain;
-			if (peak < 0.0f)
-				peak = 0.0f;
-			datum->sum += peak - datum->gainBuffer[datum->index];
-			float average = datum->sum / AZAUDIO_LOOKAHEAD_SAMPLES;
-			if (average > peak) {
-				datum->sum += average - peak;
-				peak = average;
+			gainBuffer.samples[i] = 0.0f;
+		}
+		for (size_t c = 0; c < buffer.channels; c++) {
+			float *samples = azaBufferChannelSamples(buffer, c);
+			for (size_t i = 0; i < buffer.frames; i++) {
+				float peak = fabsf(samples[i * buffer.stride]);
+				if (peak > gainBuffer.samples[i]) gainBuffer.samples[i] = peak;
 			}
-			datum->gainBuffer[datum->index] = peak;
-
-			datum->valBuffer[datum->index] = buffer.samples[s];
-
-			datum->index = (datum->index+1)%AZAUDIO_LOOKAHEAD_SAMPLES;
+		}
+		aza_amp_to_db_block(gainBuffer.samples, gainBuffer.samples, buffer.frames);
+		for (size_t i = 0; i < buffer.frames; i++) {
+			float peak = gainBuffer.samples[i] + data->gainInput;
+			gainBuffer.samples[i] = peak > 0.0f ? peak : 0.0f;
+		}
+		azaLookaheadLimiterDetect(data, gainBuffer.samples, buffer.frames);
+		aza_db_to_amp_block(gainBuffer.samples, gainBuffer.samples, buffer.frames);
+		for (size_t c = 0; c < buffer.channels; c++) {
+			float *samples = azaBufferChannelSamples(buffer, c);
+			azaLookaheadLimiterApply(&data[c], samples, buffer.stride, gainBuffer.samples, buffer.frames, frameStart, lookaheadSamples, amountOutput);
+		}
+	} else {
+		for (size_t c = 0; c < buffer.channels; c++) {
+			azaLookaheadLimiterData *datum = &data[c];
+			float *samples = azaBufferChannelSamples(buffer, c);
+			uint32_t lookaheadSamples = datum->lookaheadSamples;
+			float amountOutput = aza_db_to_ampf(datum->gainOutput);
+			uint32_t frameStart = datum->frame;
 
-			if (average > datum->gainBuffer[datum->index])
-				gain -= average;
-			else
-				gain -= datum->gainBuffer[datum->index];
-			float out = datum->valBuffer[datum->index] * aza_db_to_ampf(gain);
-			if (out < -1.0f)
-				out = -1.0f;
-			else if (out > 1.0f)
-				out = 1.0f;
-			buffer.samples[s] = out * amountOutput;
+			for (size_t i = 0; i < buffer.frames; i++) {
+				gainBuffer.samples[i] = fabsf(samples[i * buffer.stride]);
+			}
+			aza_amp_to_db_block(gainBuffer.samples, gainBuffer.samples, buffer.frames);
+			for (size_t i = 0; i < buffer.frames; i++) {
+				float peak = gainBuffer.samples[i] + datum->gainInput;
+				gainBuffer.samples[i] = peak > 0.0f ? peak : 0.0f;
+			}
+			azaLookaheadLimiterDetect(datum, gainBuffer.samples, buffer.frames);
+			aza_db_to_amp_block(gainBuffer.samples, gainBuffer.samples, buffer.frames);
+			azaLookaheadLimiterApply(datum, samples, buffer.stride, gainBuffer.samples, buffer.frames, frameStart, lookaheadSamples, amountOutput);
 		}
 	}
-	if (data->header.pNext) {
-		return azaDSP(buffer, data->header.pNext);
-	}
+	azaPopSideBuffer();
 	return AZA_SUCCESS;
 }
 
+int azaLookaheadLimiter(azaBuffer buffer, azaLookaheadLimiterData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
 
 
 void azaFilterDataInit(azaFilterData *data) {
 	data->header.kind = AZA_DSP_FILTER;
 	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
 
 	data->outputs[0] = 0.0f;
 	data->outputs[1] = 0.0f;
+	// Forces the coefficients to be computed on first use
+	data->samplerateCached = 0;
 }
 
-int azaFilter(azaBuffer buffer, azaFilterData *data) {
-	if (data == NULL) {
-		return AZA_ERROR_NULL_POINTER;
+static float azaFilterDecay(float frequency, size_t samplerate) {
+	return clampf(expf(-AZA_TAU * (frequency / (float)samplerate)), 0.0f, 1.0f);
+}
+
+static void azaFilterUpdateCoefficients(azaFilterData *data, size_t samplerate) {
+	if AZA_LIKELY(data->samplerateCached == samplerate && data->frequencyCached == data->frequency && data->kindCached == data->kind) {
+		return;
+	}
+	if (data->kind == AZA_FILTER_BAND_PASS) {
+		// Low pass above the center and high pass below it
+		data->decays[0] = azaFilterDecay(data->frequency * 2.0f, samplerate);
+		data->decays[1] = azaFilterDecay(data->frequency * 0.5f, samplerate);
 	} else {
-		int err = azaCheckBuffer(buffer);
-		if (err) return err;
+		data->decays[0] = azaFilterDecay(data->frequency, samplerate);
+		data->decays[1] = data->decays[0];
+	}
+	data->kindCached = data->kind;
+	data->frequencyCached = data->frequency;
+	data->samplerateCached = samplerate;
+}
+
+static size_t azaFilterTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaFilterData *data = (azaFilterData*)dsp;
+	size_t tail = 0;
+	for (size_t c = 0; c < buffer.channels; c++) {
+		azaFilterData *datum = &data[c];
+		azaFilterUpdateCoefficients(datum, buffer.samplerate);
+		float decay = datum->kind == AZA_FILTER_BAND_PASS ? AZA_MAX(datum->decays[0], datum->decays[1]) : datum->decays[0];
+		tail = AZA_MAX(tail, azaTailDecay(decay, 1));
 	}
+	return tail;
+}
+
+static int azaFilterProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaFilterData *data = (azaFilterData*)dsp;
 	for (size_t c = 0; c < buffer.channels; c++) {
 		azaFilterData *datum = &data[c];
+		float *samples = azaBufferChannelSamples(buffer, c);
 		float amount = clampf(1.0f - datum->dryMix, 0.0f, 1.0f);
 		float amountDry = clampf(datum->dryMix, 0.0f, 1.0f);
+		azaFilterUpdateCoefficients(datum, buffer.samplerate);
 		
 		switch (datum->kind) {
 			case AZA_FILTER_HIGH_PASS: {
-				float decay = clampf(expf(-AZA_TAU * (datum->frequency / (float)buffer.samplerate)), 0.0f, 1.0f);
+				float decay = datum->decays[0];
 				for (size_t i = 0; i < buffer.frames; i++) {
-					size_t s = i * buffer.stride + c;
-					datum->outputs[0] = buffer.samples[s] + decay * (datum->outputs[0] - buffer.samples[s]);
-					buffer.samples[s] = (buffer.samples[s] - datum->outputs[0]) * amount + buffer.samples[s] * amountDry;
+					size_t s = i * buffer.stride;
+					datum->outputs[0] = samples[s] + decay * (datum->outputs[0] - samples[s]);
+					samples[s] = (samples[s] - datum->outputs[0]) * amount + samples[s] * amountDry;
 				}
 			} break;
 			case AZA_FILTER_LOW_PASS: {
-				float decay = clampf(expf(-AZA_TAU * (datum->frequency / (float)buffer.samplerate)), 0.0f, 1.0f);
+				float decay = datum->decays[0];
 				for (size_t i = 0; i < buffer.frames; i++) {
-					size_t s = i * buffer.stride + c;
-					datum->outputs[0] = buffer.samples[s] + decay * (datum->outputs[0] - buffer.samples[s]);
-					buffer.samples[s] = datum->outputs[0] * amount + buffer.samples[s] * amountDry;
+					size_t s = i * buffer.stride;
+					datum->outputs[0] = samples[s] + decay * (datum->outputs[0] - samples[s]);
+					samples[s] = datum->outputs[0] * amount + samples[s] * amountDry;
 				}
 			} break;
 			case AZA_FILTER_BAND_PASS: {
-				float decayLow = clampf(expf(-AZA_TAU * (datum->frequency / (float)buffer.samplerate)), 0.0f, 1.0f);
-				float decayHigh = clampf(expf(-AZA_TAU * (datum->frequency / (float)buffer.samplerate)), 0.0f, 1.0f);
+				float decayLow = datum->decays[0];
+				float decayHigh = datum->decays[1];
+				// Makes up for the two slopes overlapping at the center frequency
+				amount *= 1.25f;
 				for (size_t i = 0; i < buffer.frames; i++) {
-					size_t s = i * buffer.stride + c;
-					datum->outputs[0] = buffer.samples[s] + decayLow * (datum->outputs[0] - buffer.samples[s]);
+					size_t s = i * buffer.stride;
+					datum->outputs[0] = samples[s] + decayLow * (datum->outputs[0] - samples[s]);
 					datum->outputs[1] = datum->outputs[0] + decayHigh * (datum->outputs[1] - datum->outputs[0]);
-					buffer.samples[s] = (datum->outputs[0] - datum->outputs[1]) * 2.0f * amount + buffer.samples[s] * amountDry;
+					samples[s] = (datum->outputs[0] - datum->outputs[1]) * amount + samples[s] * amountDry;
 				}
 			} break;
 		}
+		datum->outputs[0] = aza_flush_denormal(datum->outputs[0]);
+		datum->outputs[1] = aza_flush_denormal(datum->outputs[1]);
+	}
+	return AZA_SUCCESS;
+}
+
+int azaFilter(azaBuffer buffer, azaFilterData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
+
+
+void azaBiquadDataInit(azaBiquadData *data) {
+	data->header.kind = AZA_DSP_BIQUAD;
+	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
+
+	for (int c = 0; c < AZAUDIO_BIQUAD_MAX_CHANNELS; c++) {
+		data->z1[c] = 0.0f;
+		data->z2[c] = 0.0f;
+	}
+	// Forces the coefficients to be computed on first use
+	data->samplerateCached = 0;
+}
+
+// Coefficients from Robert Bristow-Johnson's Audio EQ Cookbook
+static void azaBiquadUpdateCoefficients(azaBiquadData *data, size_t samplerate) {
+	if AZA_LIKELY(data->samplerateCached == samplerate
+		&& data->frequencyCached == data->frequency
+		&& data->qCached == data->q
+		&& data->gainCached == data->gain
+		&& data->kindCached == data->kind) {
+		return;
 	}
-	if (data->header.pNext) {
-		return azaDSP(buffer, data->header.pNext);
+	float frequency = clampf(data->frequency, 1.0f, (float)samplerate * 0.49f);
+	float q = data->q > 0.0f ? data->q : 0.70710678f;
+	float w0 = AZA_TAU * frequency / (float)samplerate;
+	float cosw0 = cosf(w0);
+	float alpha = sinf(w0) / (2.0f * q);
+	float A = powf(10.0f, data->gain / 40.0f);
+	float sqrtA2alpha = 2.0f * sqrtf(A) * alpha;
+	float b0, b1, b2, a0, a1, a2;
+	switch (data->kind) {
+		default:
+		case AZA_BIQUAD_LOW_PASS:
+			b1 = 1.0f - cosw0;
+			b0 = b1 * 0.5f;
+			b2 = b0;
+			a0 = 1.0f + alpha;
+			a1 = -2.0f * cosw0;
+			a2 = 1.0f - alpha;
+			break;
+		case AZA_BIQUAD_HIGH_PASS:
+			b0 = (1.0f + cosw0) * 0.5f;
+			b1 = -(1.0f + cosw0);
+			b2 = b0;
+			a0 = 1.0f + alpha;
+			a1 = -2.0f * cosw0;
+			a2 = 1.0f - alpha;
+			break;
+		case AZA_BIQUAD_BAND_PASS:
+			b0 = alpha;
+			b1 = 0.0f;
+			b2 = -alpha;
+			a0 = 1.0f + alpha;
+			a1 = -2.0f * cosw0;
+			a2 = 1.0f - alpha;
+			break;
+		case AZA_BIQUAD_NOTCH:
+			b0 = 1.0f;
+			b1 = -2.0f * cosw0;
+			b2 = 1.0f;
+			a0 = 1.0f + alpha;
+			a1 = -2.0f * cosw0;
+			a2 = 1.0f - alpha;
+			break;
+		case AZA_BIQUAD_ALL_PASS:
+			b0 = 1.0f - alpha;
+			b1 = -2.0f * cosw0;
+			b2 = 1.0f + alpha;
+			a0 = 1.0f + alpha;
+			a1 = -2.0f * cosw0;
+			a2 = 1.0f - alpha;
+			break;
+		case AZA_BIQUAD_PEAKING:
+			b0 = 1.0f + alpha * A;
+			b1 = -2.0f * cosw0;
+			b2 = 1.0f - alpha * A;
+			a0 = 1.0f + alpha / A;
+			a1 = -2.0f * cosw0;
+			a2 = 1.0f - alpha / A;
+			break;
+		case AZA_BIQUAD_LOW_SHELF:
+			b0 = A * ((A + 1.0f) - (A - 1.0f) * cosw0 + sqrtA2alpha);
+			b1 = 2.0f * A * ((A - 1.0f) - (A + 1.0f) * cosw0);
+			b2 = A * ((A + 1.0f) - (A - 1.0f) * cosw0 - sqrtA2alpha);
+			a0 = (A + 1.0f) + (A - 1.0f) * cosw0 + sqrtA2alpha;
+			a1 = -2.0f * ((A - 1.0f) + (A + 1.0f) * cosw0);
+			a2 = (A + 1.0f) + (A - 1.0f) * cosw0 - sqrtA2alpha;
+			break;
+		case AZA_BIQUAD_HIGH_SHELF:
+			b0 = A * ((A + 1.0f) + (A - 1.0f) * cosw0 + sqrtA2alpha);
+			b1 = -2.0f * A * ((A - 1.0f) + (A + 1.0f) * cosw0);
+			b2 = A * ((A + 1.0f) + (A - 1.0f) * cosw0 - sqrtA2alpha);
+			a0 = (A + 1.0f) - (A - 1.0f) * cosw0 + sqrtA2alpha;
+			a1 = 2.0f * ((A - 1.0f) - (A + 1.0f) * cosw0);
+			a2 = (A + 1.0f) - (A - 1.0f) * cosw0 - sqrtA2alpha;
+			break;
+	}
+	data->coefficients[0] = b0 / a0;
+	data->coefficients[1] = b1 / a0;
+	data->coefficients[2] = b2 / a0;
+	data->coefficients[3] = a1 / a0;
+	data->coefficients[4] = a2 / a0;
+	data->kindCached = data->kind;
+	data->frequencyCached = data->frequency;
+	data->qCached = data->q;
+	data->gainCached = data->gain;
+	data->samplerateCached = samplerate;
+}
+
+// Rings for as long as its slowest pole takes to decay
+static size_t azaBiquadTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaBiquadData *data = (azaBiquadData*)dsp;
+	azaBiquadUpdateCoefficients(data, buffer.samplerate);
+	float a1 = data->coefficients[3];
+	float a2 = data->coefficients[4];
+	float discriminant = a1 * a1 - 4.0f * a2;
+	// Complex poles share a radius of sqrt(a2), real ones are the roots of z^2 + a1 z + a2
+	float radius = discriminant < 0.0f ? sqrtf(fabsf(a2)) : 0.5f * (fabsf(a1) + sqrtf(discriminant));
+	return azaTailDecay(radius, 1);
+}
+
+static int azaBiquadProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaBiquadData *data = (azaBiquadData*)dsp;
+	if (buffer.channels > AZAUDIO_BIQUAD_MAX_CHANNELS) {
+		return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	}
+	azaBiquadUpdateCoefficients(data, buffer.samplerate);
+	azaKernel.biquad(buffer, data->coefficients, data->z1, data->z2);
+	for (size_t c = 0; c < buffer.channels; c++) {
+		data->z1[c] = aza_flush_denormal(data->z1[c]);
+		data->z2[c] = aza_flush_denormal(data->z2[c]);
 	}
 	return AZA_SUCCESS;
 }
 
+int azaBiquad(azaBuffer buffer, azaBiquadData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
 
 
 void azaCompressorDataInit(azaCompressorData *data) {
 	data->header.kind = AZA_DSP_COMPRESSOR;
 	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
 
 	azaRmsDataInit(&data->rmsData);
 	data->attenuation = 0.0f;
 	data->gain = 0.0f;
 }
 
-int azaCompressor(azaBuffer buffer, azaCompressorData *data) {
-	if (data == NULL) {
-		return AZA_ERROR_NULL_POINTER;
-	} else {
-		int err = azaCheckBuffer(buffer);
-		if (err) return err;
+void azaCompressorDataDeinit(azaCompressorData *data) {
+	azaRmsDataDeinit(&data->rmsData);
+}
+
+// The signal the envelope follows for count channels of buffer starting at first, which is the loudest of them at each frame when there's more than one
+static void azaEnvelopeDetectorInput(float *dst, azaBuffer buffer, size_t first, size_t count) {
+	if (count == 1) {
+		azaKernel.copyStrided(dst, 1, azaBufferChannelSamples(buffer, first), buffer.stride, buffer.frames);
+		return;
 	}
-	azaBuffer sideBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
-	for (size_t c = 0; c < buffer.channels; c++) {
-		azaCompressorData *datum = &data[c];
-		float t = (float)buffer.samplerate / 1000.0f;
-		float attackFactor = expf(-1.0f / (datum->attack * t));
-		float decayFactor = expf(-1.0f / (datum->decay * t));
-		float overgainFactor;
-		if (datum->ratio > 1.0f) {
-			overgainFactor = (1.0f - 1.0f / datum->ratio);
-		} else if (datum->ratio < 0.0f) {
-			overgainFactor = -datum->ratio;
-		} else {
-			overgainFactor = 0.0f;
+	memset(dst, 0, sizeof(float) * buffer.frames);
+	for (size_t c = first; c < first + count; c++) {
+		float *samples = azaBufferChannelSamples(buffer, c);
+		for (size_t i = 0; i < buffer.frames; i++) {
+			float peak = fabsf(samples[i * buffer.stride]);
+			if (peak > dst[i]) dst[i] = peak;
 		}
+	}
+}
 
-		azaBufferCopyChannel(sideBuffer, 0, buffer, c);
-		azaRms(sideBuffer, &datum->rmsData);
+// Multiplies count channels of buffer starting at first by the gains in amps
+static void azaEnvelopeApply(azaBuffer buffer, size_t first, size_t count, const float *amps) {
+	for (size_t c = first; c < first + count; c++) {
+		float *samples = azaBufferChannelSamples(buffer, c);
 		for (size_t i = 0; i < buffer.frames; i++) {
-			size_t s = i * buffer.stride + c;
-			
-			float rms = aza_amp_to_dbf(sideBuffer.samples[i]);
-			if (rms < -120.0f) rms = -120.0f;
-			if (rms > datum->attenuation) {
-				datum->attenuation = rms + attackFactor * (datum->attenuation - rms);
-			} else {
-				datum->attenuation = rms + decayFactor * (datum->attenuation - rms);
-			}
-			float gain;
-			if (datum->attenuation > datum->threshold) {
-				gain = overgainFactor * (datum->threshold - datum->attenuation);
-			} else {
-				gain = 0.0f;
-			}
-			datum->gain = gain;
-			buffer.samples[s] = buffer.samples[s] * aza_db_to_ampf(gain);
+			samples[i * buffer.stride] *= amps[i];
 		}
 	}
-	azaPopSideBuffer();
-	if (data->header.pNext) {
-		return azaDSP(buffer, data->header.pNext);
+}
+
+// Follows the envelope of the RMS in detector and applies the resulting gain to count channels of buffer starting at first. detector gets overwritten.
+static void azaCompressorFollow(azaCompressorData *datum, float *detector, azaBuffer buffer, size_t first, size_t count) {
+	float t = (float)buffer.samplerate / 1000.0f;
+	float attackFactor = expf(-1.0f / (datum->attack * t));
+	float decayFactor = expf(-1.0f / (datum->decay * t));
+	float overgainFactor;
+	if (datum->ratio > 1.0f) {
+		overgainFactor = (1.0f - 1.0f / datum->ratio);
+	} else if (datum->ratio < 0.0f) {
+		overgainFactor = -datum->ratio;
+	} else {
+		overgainFactor = 0.0f;
 	}
-	return AZA_SUCCESS;
+	aza_amp_to_db_block(detector, detector, buffer.frames);
+	float attenuation = datum->attenuation;
+	int active = 0;
+	for (size_t i = 0; i < buffer.frames; i++) {
+		float rms = detector[i];
+		if (rms < -120.0f) rms = -120.0f;
+		if (rms > attenuation) {
+			attenuation = rms + attackFactor * (attenuation - rms);
+		} else {
+			attenuation = rms + decayFactor * (attenuation - rms);
+		}
+		float gain;
+		if (attenuation > datum->threshold) {
+			gain = overgainFactor * (datum->threshold - attenuation);
+			active = 1;
+		} else {
+			gain = 0.0f;
+		}
+		detector[i] = gain;
+	}
+	datum->attenuation = attenuation;
+	datum->gain = detector[buffer.frames-1];
+	// Nothing to do while we stay under the threshold
+	if (!active) return;
+	aza_db_to_amp_block(detector, detector, buffer.frames);
+	azaEnvelopeApply(buffer, first, count, detector);
 }
 
+// Silence in is silence out, but the envelope has to fall back to rest or the next sound would start out attenuated
+static size_t azaEnvelopeTail(azaRmsData *rms, float decay, size_t samplerate) {
+	float factor = expf(-1.0f / (AZA_MAX(decay, 0.001f) * (float)samplerate / 1000.0f));
+	return azaTailAdd(azaRmsTailFrames(rms, samplerate), azaTailDecay(factor, 1));
+}
 
+static size_t azaCompressorTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaCompressorData *data = (azaCompressorData*)dsp;
+	size_t channels = data->linked ? 1 : buffer.channels;
+	size_t tail = 0;
+	for (size_t c = 0; c < channels; c++) {
+		tail = AZA_MAX(tail, azaEnvelopeTail(&data[c].rmsData, data[c].decay, buffer.samplerate));
+	}
+	return tail;
+}
 
-static void azaDelayDataHandleBufferResizes(azaDelayData *data, size_t delaySamples) {
-	if (data->delaySamples >= delaySamples) {
-		if (data->index > delaySamples) {
-			data->index = 0;
+static int azaCompressorProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaCompressorData *data = (azaCompressorData*)dsp;
+	// When linked only data[0] has a detector
+	size_t detectors = data->linked ? 1 : buffer.channels;
+	for (size_t c = 0; c < detectors; c++) {
+		int err = azaRmsPrepare(&data[c].rmsData, buffer.samplerate);
+		if (err) return err;
+	}
+	azaBuffer sideBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+	if (!sideBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
+	if (data->linked) {
+		azaEnvelopeDetectorInput(sideBuffer.samples, buffer, 0, buffer.channels);
+		azaRmsProcessSamples(&data->rmsData, sideBuffer.samples, buffer.frames);
+		azaCompressorFollow(data, sideBuffer.samples, buffer, 0, buffer.channels);
+		for (size_t c = 1; c < buffer.channels; c++) {
+			data[c].gain = data->gain;
+		}
+	} else {
+		for (size_t c = 0; c < buffer.channels; c++) {
+			azaEnvelopeDetectorInput(sideBuffer.samples, buffer, c, 1);
+			azaRmsProcessSamples(&data[c].rmsData, sideBuffer.samples, buffer.frames);
+			azaCompressorFollow(&data[c], sideBuffer.samples, buffer, c, 1);
 		}
-		data->delaySamples = delaySamples;
-		return;
-	} else if (data->capacity >= delaySamples) {
-		data->delaySamples = delaySamples;
-		return;
 	}
-	// Have to realloc buffer
-	size_t newCapacity = aza_grow(data->capacity, delaySamples, 1024);
-	float *newBuffer = malloc(sizeof(float) * newCapacity);
-	if (data->buffer) {
-		memcpy(newBuffer, data->buffer, sizeof(float) * data->delaySamples);
-		free(data->buffer);
+	azaPopSideBuffer();
+	return AZA_SUCCESS;
+}
+
+int azaCompressor(azaBuffer buffer, azaCompressorData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
+
+
+// Delay buffers are preceded by this header so they can be handed between threads as a single pointer
+typedef struct azaDelayBufferHeader {
+	size_t capacity;
+	struct azaDelayBufferHeader *next;
+} azaDelayBufferHeader;
+#define AZA_DELAY_BUFFER_HEADER_SIZE aza_align(sizeof(azaDelayBufferHeader), 16)
+
+static azaDelayBufferHeader* azaDelayBufferGetHeader(float *buffer) {
+	return (azaDelayBufferHeader*)((char*)buffer - AZA_DELAY_BUFFER_HEADER_SIZE);
+}
+
+static float* azaDelayBufferAlloc(size_t capacity) {
+	char *block = malloc(AZA_DELAY_BUFFER_HEADER_SIZE + sizeof(float) * capacity);
+	if (!block) return NULL;
+	azaDelayBufferHeader *header = (azaDelayBufferHeader*)block;
+	header->capacity = capacity;
+	header->next = NULL;
+	float *buffer = (float*)(block + AZA_DELAY_BUFFER_HEADER_SIZE);
+	memset(buffer, 0, sizeof(float) * capacity);
+	return buffer;
+}
+
+static void azaDelayBufferFree(float *buffer) {
+	if (buffer) {
+		free(azaDelayBufferGetHeader(buffer));
 	}
-	data->buffer = newBuffer;
-	for (size_t i = data->delaySamples; i < delaySamples; i++) {
-		data->buffer[i] = 0.0f;
+}
+
+// Frees every buffer the audio thread has swapped out
+static void azaDelayBufferFreeRetired(void **retired) {
+	azaDelayBufferHeader *header = __atomic_exchange_n((azaDelayBufferHeader**)retired, NULL, __ATOMIC_ACQUIRE);
+	while (header) {
+		azaDelayBufferHeader *next = header->next;
+		free(header);
+		header = next;
 	}
+}
+
+// Called on the audio thread. Swaps in the pending buffer if there is one, without touching the heap.
+// The ring's history is kept where the write index expects it, and the old buffer goes on retired.
+static void azaDelayBufferSwap(float **buffer, size_t *capacity, size_t index, void **pending, void **retired) {
+	float *next = __atomic_exchange_n((float**)pending, NULL, __ATOMIC_ACQUIRE);
+	if (!next) return;
+	size_t newCapacity = azaDelayBufferGetHeader(next)->capacity;
+	if (*buffer) {
+		size_t count = AZA_MIN(*capacity, newCapacity);
+		size_t start = index - count;
+		for (size_t i = 0; i < count; i++) {
+			next[(start + i) & (newCapacity - 1)] = (*buffer)[(start + i) & (*capacity - 1)];
+		}
+		// Hand the old buffer back to be freed off the audio thread
+		azaDelayBufferHeader *header = azaDelayBufferGetHeader(*buffer);
+		header->next = __atomic_load_n((azaDelayBufferHeader**)retired, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n((azaDelayBufferHeader**)retired, &header->next, header, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+	*buffer = next;
+	*capacity = newCapacity;
+}
+
+// Makes a buffer of capacity floats pending, replacing any the audio thread never picked up. Not safe to call from multiple threads at once.
+static int azaDelayBufferResize(size_t capacity, void **pending, void **retired) {
+	azaDelayBufferFreeRetired(retired);
+	// A buffer the audio thread never picked up can go straight away
+	azaDelayBufferFree(__atomic_exchange_n((float**)pending, NULL, __ATOMIC_ACQUIRE));
+	float *buffer = azaDelayBufferAlloc(capacity);
+	if (!buffer) return AZA_ERROR_OUT_OF_MEMORY;
+	__atomic_store_n((float**)pending, buffer, __ATOMIC_RELEASE);
+	return AZA_SUCCESS;
+}
+
+// Called on the audio thread. Swaps in a buffer from azaDelayDataResize if there is one, without touching the heap.
+static void azaDelayDataHandleBufferResizes(azaDelayData *data, size_t delaySamples) {
+	azaDelayBufferSwap(&data->buffer, &data->capacity, data->index, &data->pending, &data->retired);
+	if (delaySamples < 1) delaySamples = 1;
+	// Without a reservation we can only go as long as the buffer we have
+	if (delaySamples > data->capacity) delaySamples = data->capacity;
 	data->delaySamples = delaySamples;
 }
 
+int azaDelayDataResize(azaDelayData *data, float delayMax, size_t samplerate) {
+	size_t capacity = aza_next_pow2(AZA_MAX(aza_ms_to_samples(delayMax, (float)samplerate), 1));
+	return azaDelayBufferResize(capacity, &data->pending, &data->retired);
+}
+
 void azaDelayDataInit(azaDelayData *data) {
 	data->header.kind = AZA_DSP_DELAY;
 	data->header.structSize = sizeof(*data);
-
-	data->buffer = NULL;
-	data->capacity = 0;
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
+
+	data->capacity = aza_next_pow2(AZA_MAX(aza_ms_to_samples(AZA_MAX(data->delay, data->delayMax), AZAUDIO_DELAY_RESERVE_SAMPLERATE), 1));
+	data->buffer = azaDelayBufferAlloc(data->capacity);
+	if (!data->buffer) data->capacity = 0;
+	data->pending = NULL;
+	data->retired = NULL;
 	data->delaySamples = 0;
 	data->index = 0;
-	azaDelayDataHandleBufferResizes(data, aza_ms_to_samples(data->delay, 48000));
 }
 
 void azaDelayDataDeinit(azaDelayData *data) {
-	free(data->buffer);
+	azaDelayBufferFreeRetired(&data->retired);
+	azaDelayBufferFree(data->pending);
+	azaDelayBufferFree(data->buffer);
+	data->pending = NULL;
+	data->buffer = NULL;
+	data->capacity = 0;
 }
 
-int azaDelay(azaBuffer buffer, azaDelayData *data) {
-	if (data == NULL) {
-		return AZA_ERROR_NULL_POINTER;
-	} else {
-		int err = azaCheckBuffer(buffer);
-		if (err) return err;
+// Every echo is feedback quieter than the last, and each one goes through the wet effects
+static size_t azaDelayTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaDelayData *data = (azaDelayData*)dsp;
+	size_t tail = 0;
+	for (size_t c = 0; c < buffer.channels; c++) {
+		azaDelayData *datum = &data[c];
+		size_t delaySamples = AZA_MAX(aza_ms_to_samples(datum->delay, buffer.samplerate), 1);
+		size_t echoes = azaTailAdd(azaTailDecay(fabsf(datum->feedback), delaySamples), delaySamples);
+		tail = AZA_MAX(tail, azaTailAdd(echoes, azaDSPChainTail(datum->wetEffects, buffer)));
 	}
+	return tail;
+}
+
+static int azaDelayProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaDelayData *data = (azaDelayData*)dsp;
 	azaBuffer sideBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+	if (!sideBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
 	for (size_t c = 0; c < buffer.channels; c++) {
 		azaDelayData *datum = &data[c];
+		float *samples = azaBufferChannelSamples(buffer, c);
 		size_t delaySamples = aza_ms_to_samples(datum->delay, buffer.samplerate);
 		azaDelayDataHandleBufferResizes(datum, delaySamples);
+		if (!datum->buffer) continue;
+		delaySamples = datum->delaySamples;
 		float amount = aza_db_to_ampf(datum->gain);
 		float amountDry = aza_db_to_ampf(datum->gainDry);
-		size_t index = datum->index;
-		for (size_t i = 0; i < buffer.frames; i++) {
-			size_t s = i * buffer.stride + c;
-			sideBuffer.samples[i] = buffer.samples[s] + datum->buffer[index] * datum->feedback;
-			index = (index+1) % delaySamples;
-		}
-		if (datum->wetEffects) {
-			int err = azaDSP(sideBuffer, datum->wetEffects);
-			if (err) return err;
-		}
-		index = datum->index;
-		for (size_t i = 0; i < buffer.frames; i++) {
-			size_t s = i * buffer.stride + c;
-			datum->buffer[index] = sideBuffer.samples[i];
-			index = (index+1) % delaySamples;
-			buffer.samples[s] = datum->buffer[index] * amount + buffer.samples[s] * amountDry;
+		// Chunks no longer than the delay only ever read what earlier chunks wrote
+		for (size_t start = 0; start < buffer.frames; start += delaySamples) {
+			size_t frames = AZA_MIN(buffer.frames - start, delaySamples);
+			float *chunk = samples + start * buffer.stride;
+			azaRingRead(sideBuffer.samples, datum->buffer, datum->capacity, datum->index - delaySamples, frames);
+			for (size_t i = 0; i < frames; i++) {
+				size_t s = i * buffer.stride;
+				float delayed = sideBuffer.samples[i];
+				sideBuffer.samples[i] = chunk[s] + delayed * datum->feedback + AZA_DENORMAL_OFFSET;
+				chunk[s] = delayed * amount + chunk[s] * amountDry;
+			}
+			if (datum->wetEffects) {
+				azaBuffer wetBuffer = sideBuffer;
+				wetBuffer.frames = frames;
+				int err = azaDSP(wetBuffer, datum->wetEffects);
+				if (err) {
+					azaPopSideBuffer();
+					return err;
+				}
+			}
+			azaRingWrite(datum->buffer, datum->capacity, datum->index, sideBuffer.samples, frames);
+			datum->index += frames;
 		}
-		datum->index = index;
 	}
 	azaPopSideBuffer();
-	if (data->header.pNext) {
-		return azaDSP(buffer, data->header.pNext);
-	}
 	return AZA_SUCCESS;
 }
 
+int azaDelay(azaBuffer buffer, azaDelayData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
+
+
+// Line lengths in samples at 48kHz, mutually prime so the echoes don't line up
+static const int32_t reverbLineDelays[AZAUDIO_REVERB_LINES] = {
+	1031, 1187, 1327, 1453, 1597, 1733, 1871, 2011,
+};
+static void azaReverbUpdateCoefficients(azaReverbData *data, size_t samplerate) {
+	if (data->roomsize == data->roomsizeCached && data->color == data->colorCached && samplerate == data->samplerateCached) return;
+	data->roomsizeCached = data->roomsize;
+	data->colorCached = data->color;
+	data->samplerateCached = samplerate;
+	// How much is left after every 2600 samples (at 48kHz) of travel
+	float feedback = 0.985f - (0.2f / data->roomsize);
+	float damping = expf(-AZA_TAU * data->color * 4000.0f / (float)samplerate);
+	for (int i = 0; i < AZAUDIO_REVERB_LINES; i++) {
+		int32_t delay = (int32_t)((int64_t)reverbLineDelays[i] * (int64_t)samplerate / 48000);
+		if (delay < 1) delay = 1;
+		if (delay > (int32_t)data->capacity - 1) delay = (int32_t)data->capacity - 1;
+		data->lineDelays[i] = delay;
+		// Scaled to normalize the Hadamard matrix
+		data->lineGains[i] = powf(feedback, (float)reverbLineDelays[i] / 2600.0f) / sqrtf((float)AZAUDIO_REVERB_LINES);
+		data->lineDamping[i] = damping;
+	}
+}
 
+// Room for the pre-delay plus some of the block
+static size_t azaReverbPreDelayCapacity(float delay, size_t samplerate) {
+	return aza_next_pow2(aza_ms_to_samples(delay, (float)samplerate) + 256);
+}
 
 void azaReverbDataInit(azaReverbData *data) {
 	data->header.kind = AZA_DSP_REVERB;
 	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
 
-	float delays[AZAUDIO_REVERB_DELAY_COUNT] = {
-		AZA_SAMPLES_TO_MS(1557, 48000),
-		AZA_SAMPLES_TO_MS(1617, 48000),
-		AZA_SAMPLES_TO_MS(1491, 48000),
-		AZA_SAMPLES_TO_MS(1422, 48000),
-		AZA_SAMPLES_TO_MS(1277, 48000),
-		AZA_SAMPLES_TO_MS(1356, 48000),
-		AZA_SAMPLES_TO_MS(1188, 48000),
-		AZA_SAMPLES_TO_MS(1116, 48000),
-		AZA_SAMPLES_TO_MS(2111, 48000),
-		AZA_SAMPLES_TO_MS(2133, 48000),
-		AZA_SAMPLES_TO_MS( 673, 48000),
-		AZA_SAMPLES_TO_MS( 556, 48000),
-		AZA_SAMPLES_TO_MS( 441, 48000),
-		AZA_SAMPLES_TO_MS( 341, 48000),
-		AZA_SAMPLES_TO_MS( 713, 48000),
-	};
-	for (int i = 0; i < AZAUDIO_REVERB_DELAY_COUNT; i++) {
-		data->delayDatas[i].delay = delays[i] + data->delay;
-		data->delayDatas[i].gain = 0.0f;
-		data->delayDatas[i].gainDry = 0.0f;
-		azaDelayDataInit(&data->delayDatas[i]);
-		data->filterDatas[i].kind = AZA_FILTER_LOW_PASS;
-		azaFilterDataInit(&data->filterDatas[i]);
-	}
+	int32_t longest = reverbLineDelays[AZAUDIO_REVERB_LINES-1] * (AZAUDIO_REVERB_RESERVE_SAMPLERATE / 48000);
+	data->capacity = aza_next_pow2(longest + 1);
+	data->lines = calloc(data->capacity * AZAUDIO_REVERB_LINES, sizeof(float));
+	data->index = 0;
+	data->preDelayCapacity = azaReverbPreDelayCapacity(AZA_MAX(data->delay, data->delayMax), AZAUDIO_REVERB_RESERVE_SAMPLERATE);
+	data->preDelayBuffer = azaDelayBufferAlloc(data->preDelayCapacity);
+	if (!data->preDelayBuffer) data->preDelayCapacity = 0;
+	data->preDelayIndex = 0;
+	data->preDelayPending = NULL;
+	data->preDelayRetired = NULL;
+	memset(data->lineLowpass, 0, sizeof(data->lineLowpass));
+	data->samplerateCached = 0;
 }
 
 void azaReverbDataDeinit(azaReverbData *data) {
-	for (int i = 0; i < AZAUDIO_REVERB_DELAY_COUNT; i++) {
-		azaDelayDataDeinit(&data->delayDatas[i]);
+	free(data->lines);
+	azaDelayBufferFreeRetired(&data->preDelayRetired);
+	azaDelayBufferFree(data->preDelayPending);
+	azaDelayBufferFree(data->preDelayBuffer);
+	data->lines = NULL;
+	data->preDelayPending = NULL;
+	data->preDelayBuffer = NULL;
+	data->preDelayCapacity = 0;
+}
+
+int azaReverbDataResize(azaReverbData *data, float delayMax, size_t samplerate) {
+	return azaDelayBufferResize(azaReverbPreDelayCapacity(delayMax, samplerate), &data->preDelayPending, &data->preDelayRetired);
+}
+
+static size_t azaReverbTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaReverbData *data = (azaReverbData*)dsp;
+	azaReverbUpdateCoefficients(data, buffer.samplerate);
+	// Same as in azaReverbUpdateCoefficients, left after every 2600 samples at 48kHz
+	float feedback = 0.985f - (0.2f / data->roomsize);
+	size_t travel = AZA_MAX(2600 * buffer.samplerate / 48000, 1);
+	size_t tail = azaTailDecay(feedback, travel);
+	int32_t longest = 0;
+	for (int i = 0; i < AZAUDIO_REVERB_LINES; i++) {
+		longest = AZA_MAX(longest, data->lineDelays[i]);
 	}
+	return azaTailAdd(tail, aza_ms_to_samples(data->delay, buffer.samplerate) + (size_t)longest);
 }
 
-int azaReverb(azaBuffer buffer, azaReverbData *data) {
-	if (data == NULL) {
-		return AZA_ERROR_NULL_POINTER;
-	} else {
-		int err = azaCheckBuffer(buffer);
-		if (err) return err;
+static int azaReverbProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaReverbData *data = (azaReverbData*)dsp;
+	azaDelayBufferSwap(&data->preDelayBuffer, &data->preDelayCapacity, data->preDelayIndex, &data->preDelayPending, &data->preDelayRetired);
+	if (!data->lines || !data->preDelayBuffer) return AZA_ERROR_OUT_OF_MEMORY;
+	azaReverbUpdateCoefficients(data, buffer.samplerate);
+	azaBuffer inputBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+	if (!inputBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
+	azaBuffer tapsBuffer = azaPushSideBuffer(buffer.frames, AZAUDIO_REVERB_LINES, buffer.samplerate);
+	if (!tapsBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
+	float amount = aza_db_to_ampf(data->gain);
+	float amountDry = aza_db_to_ampf(data->gainDry);
+
+	// The tank is fed the average of every channel, on top of an offset that keeps it out of denormals
+	for (size_t i = 0; i < buffer.frames; i++) {
+		inputBuffer.samples[i] = AZA_DENORMAL_OFFSET;
 	}
-	azaBuffer sideBufferCombined = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
-	azaBuffer sideBufferEarly = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
-	azaBuffer sideBufferDiffuse = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
 	for (size_t c = 0; c < buffer.channels; c++) {
-		azaReverbData *datum = &data[c];
-		float feedback = 0.985f - (0.2f / datum->roomsize);
-		float color = datum->color * 4000.0f;
-		float amount = aza_db_to_ampf(datum->gain);
-		float amountDry = aza_db_to_ampf(datum->gainDry);
+		azaBufferMix(inputBuffer, 1.0f, azaBufferChannel(buffer, c), 1.0f / (float)buffer.channels);
+	}
+	// Without a reservation we can only go as long as the buffer we have
+	size_t preDelay = AZA_MIN(aza_ms_to_samples(data->delay, buffer.samplerate), data->preDelayCapacity - 1);
+	// Chunks short enough that writing never overwrites what we still have to read
+	size_t chunkMax = data->preDelayCapacity - preDelay;
+	for (size_t start = 0; start < buffer.frames; start += chunkMax) {
+		size_t frames = AZA_MIN(buffer.frames - start, chunkMax);
+		float *chunk = inputBuffer.samples + start;
+		azaRingWrite(data->preDelayBuffer, data->preDelayCapacity, data->preDelayIndex, chunk, frames);
+		azaRingRead(chunk, data->preDelayBuffer, data->preDelayCapacity, data->preDelayIndex - preDelay, frames);
+		data->preDelayIndex += frames;
+	}
+	azaKernel.reverb(data, inputBuffer.samples, tapsBuffer.samples, buffer.frames);
+	for (int j = 0; j < AZAUDIO_REVERB_LINES; j++) {
+		data->lineLowpass[j] = aza_flush_denormal(data->lineLowpass[j]);
+	}
 
-		memset(sideBufferCombined.samples, 0, sizeof(float) * buffer.frames);
-		for (int tap = 0; tap < AZAUDIO_REVERB_DELAY_COUNT*2/3; tap++) {
-			datum->delayDatas[tap].feedback = feedback;
-			datum->filterDatas[tap].frequency = color;
-			azaBufferCopyChannel(sideBufferEarly, 0, buffer, c);
-			azaFilter(sideBufferEarly, &datum->filterDatas[tap]);
-			azaDelay(sideBufferEarly, &datum->delayDatas[tap]);
-			azaBufferMix(sideBufferCombined, 1.0f, sideBufferEarly, 1.0f / (float)AZAUDIO_REVERB_DELAY_COUNT);
-		}
-		for (int tap = AZAUDIO_REVERB_DELAY_COUNT*2/3; tap < AZAUDIO_REVERB_DELAY_COUNT; tap++) {
-			datum->delayDatas[tap].feedback = (float)(tap+8) / (AZAUDIO_REVERB_DELAY_COUNT + 8.0f);
-			datum->filterDatas[tap].frequency = color*4.0f;
-			azaBufferCopyChannel(sideBufferDiffuse, 0, sideBufferCombined, 0);
-			azaFilter(sideBufferDiffuse, &datum->filterDatas[tap]);
-			azaDelay(sideBufferDiffuse, &datum->delayDatas[tap]);
-			azaBufferMix(sideBufferCombined, 1.0f, sideBufferDiffuse, 1.0f / (float)AZAUDIO_REVERB_DELAY_COUNT);
+	for (size_t c = 0; c < buffer.channels; c++) {
+		float *samples = azaBufferChannelSamples(buffer, c);
+		// Rows of the Hadamard matrix are orthogonal, so each channel gets its own. Row 0 is all ones, so we skip it.
+		int row = (int)(c % (AZAUDIO_REVERB_LINES-1)) + 1;
+		float weights[AZAUDIO_REVERB_LINES];
+		for (int j = 0; j < AZAUDIO_REVERB_LINES; j++) {
+			weights[j] = (__builtin_popcount(row & j) & 1 ? -amount : amount) / sqrtf((float)AZAUDIO_REVERB_LINES);
 		}
 		for (size_t i = 0; i < buffer.frames; i++) {
-			size_t s = i * buffer.stride + c;
-			buffer.samples[s] = sideBufferCombined.samples[i] * amount + buffer.samples[s] * amountDry;
+			size_t s = i * buffer.stride;
+			const float *tap = tapsBuffer.samples + i * AZAUDIO_REVERB_LINES;
+			float wet = 0.0f;
+			for (int j = 0; j < AZAUDIO_REVERB_LINES; j++) {
+				wet += tap[j] * weights[j];
+			}
+			samples[s] = wet + samples[s] * amountDry;
 		}
 	}
 	azaPopSideBuffer();
 	azaPopSideBuffer();
-	azaPopSideBuffer();
-	if (data->header.pNext) {
-		return azaDSP(buffer, data->header.pNext);
-	}
 	return AZA_SUCCESS;
 }
 
+int azaReverb(azaBuffer buffer, azaReverbData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
 
 
 int azaSamplerDataInit(azaSamplerData *data) {
 	data->header.kind = AZA_DSP_SAMPLER;
 	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
 
 	if (data->buffer == NULL) {
 		AZA_PRINT_ERR("azaSamplerDataInit error: Sampler initialized without a buffer!");
 		return AZA_ERROR_NULL_POINTER;
 	}
-	data->frame = 0;
+	data->table = azaGetResampleTable(data->quality);
+	if (data->table == NULL) {
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	data->position = 0;
 	data->s = data->speed;
 	// Starting at zero ensures click-free playback no matter what
 	data->g = 0.0f;
 	return AZA_SUCCESS;
 }
 
-int azaSampler(azaBuffer buffer, azaSamplerData *data) {
-	if (data == NULL) {
-		return AZA_ERROR_NULL_POINTER;
-	} else {
-		int err = azaCheckBuffer(buffer);
-		if (err) return err;
-	}
+// Plays whether there's input or not
+static size_t azaSamplerTail(azaDSPData *dsp, azaBuffer buffer) {
+	return AZA_TAIL_INFINITE;
+}
+
+static int azaSamplerProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaSamplerData *data = (azaSamplerData*)dsp;
 	float transition = expf(-1.0f / (AZAUDIO_SAMPLER_TRANSITION_FRAMES));
+	azaBuffer gainBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+	if (!gainBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
 	for (size_t c = 0; c < buffer.channels; c++) {
 		azaSamplerData *datum = &data[c];
-		float samplerateFactor = (float)buffer.samplerate / (float)datum->buffer->samplerate;
+		float *samples = azaBufferChannelSamples(buffer, c);
+		const azaResampleTable *table = datum->table;
+		const float *source = datum->buffer->samples;
+		size_t sourceStride = datum->buffer->stride;
+		int64_t sourceFrames = (int64_t)datum->buffer->frames;
+		uint64_t end = (uint64_t)sourceFrames << 32;
+		int64_t taps = (int64_t)table->taps;
+		// Source frames per output frame at a speed of 1
+		float samplerateFactor = (float)datum->buffer->samplerate / (float)buffer.samplerate;
 
 		for (size_t i = 0; i < buffer.frames; i++) {
-			size_t s = i * buffer.stride + c;
+			size_t s = i * buffer.stride;
 
 			datum->s = datum->speed + transition * (datum->s - datum->speed);
 			datum->g = datum->gain + transition * (datum->g - datum->gain);
 
-			// Adjust for different samplerates
-			float speed = datum->s * samplerateFactor;
-			float volume = aza_db_to_ampf(datum->g);
-
-			float sample = 0.0f;
+			gainBuffer.samples[i] = datum->g;
 
-			/* Lanczos
-			int t = (int)datum->frame + (int)datum->s;
-			for (int i = (int)datum->frame-2; i <= t+2; i++) {
-				float x = datum->frame - (float)(i);
-				sample += datum->buffer->samples[i % datum->buffer->frames] * sinc(x) * sinc(x/3);
-			}
-			*/
-
-			float frameFraction = datum->frame - (float)((int)datum->frame);
-			if (speed <= 1.0f) {
-				// Cubic
-				float abcd[4];
-				int ii = (int)datum->frame + datum->buffer->frames - 2;
-				for (int i = 0; i < 4; i++) {
-					abcd[i] = datum->buffer->samples[ii++ % datum->buffer->frames];
-				}
-				sample = cubic(abcd[0], abcd[1], abcd[2], abcd[3], frameFraction);
+			float speed = AZA_MAX(datum->s * samplerateFactor, 0.0f);
+			int64_t start = (int64_t)(datum->position >> 32) - taps / 2 + 1;
+			const float *window;
+			float gathered[AZA_RESAMPLE_QUALITY_32];
+			if (sourceStride == 1 && start >= 0 && start + taps <= sourceFrames) {
+				window = source + start;
 			} else {
-				// Oversampling
-				float total = 0.0f;
-				total += datum->buffer->samples[(int)datum->frame % datum->buffer->frames] * (1.0f - frameFraction);
-				for (int i = 1; i < (int)datum->speed; i++) {
-					total += datum->buffer->samples[((int)datum->frame + i) % datum->buffer->frames];
+				// The kernel hangs off either end of the loop, so wrap around without a % per tap
+				int64_t index = start % sourceFrames;
+				if (index < 0) index += sourceFrames;
+				for (int64_t k = 0; k < taps; k++) {
+					gathered[k] = source[index * sourceStride];
+					if (++index == sourceFrames) index = 0;
 				}
-				total += datum->buffer->samples[((int)datum->frame + (int)datum->speed) % datum->buffer->frames] * frameFraction;
-				sample = total / (float)((int)datum->speed);
+				window = gathered;
 			}
+			samples[s] = azaResampleSample(table, azaResampleBand(speed), window, (uint32_t)datum->position);
 
-			/* Linear
-			int t = (int)datum->frame + (int)datum->s;
-			for (int i = (int)datum->frame; i <= t+1; i++) {
-				float x = datum->frame - (float)(i);
-				sample += datum->buffer->samples[i % datum->buffer->frames] * linc(x);
-			}
-			*/
-
-			buffer.samples[s] = sample * volume;
-			datum->frame = datum->frame + datum->s;
-			if ((int)datum->frame > datum->buffer->frames) {
-				datum->frame -= (float)datum->buffer->frames;
+			datum->position += (uint64_t)((double)speed * 4294967296.0);
+			if (datum->position >= end) {
+				datum->position %= end;
 			}
 		}
+		aza_db_to_amp_block(gainBuffer.samples, gainBuffer.samples, buffer.frames);
+		for (size_t i = 0; i < buffer.frames; i++) {
+			samples[i * buffer.stride] *= gainBuffer.samples[i];
+		}
 	}
-	if (data->header.pNext) {
-		return azaDSP(buffer, data->header.pNext);
-	}
+	azaPopSideBuffer();
 	return AZA_SUCCESS;
 }
 
+int azaSampler(azaBuffer buffer, azaSamplerData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
 
 
 void azaGateDataInit(azaGateData *data) {
 	data->header.kind = AZA_DSP_GATE;
 	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
 
 	azaRmsDataInit(&data->rms);
 	data->attenuation = 0.0f;
 	data->gain = 0.0f;
 }
 
+void azaGateDataDeinit(azaGateData *data) {
+	azaRmsDataDeinit(&data->rms);
+}
+
+// Like azaCompressorFollow, but for the gate
+static void azaGateFollow(azaGateData *datum, float *detector, azaBuffer buffer, size_t first, size_t count) {
+	float t = (float)buffer.samplerate / 1000.0f;
+	float attackFactor = expf(-1.0f / (datum->attack * t));
+	float decayFactor = expf(-1.0f / (datum->decay * t));
+	aza_amp_to_db_block(detector, detector, buffer.frames);
+	float attenuation = datum->attenuation;
+	int active = 0;
+	for (size_t i = 0; i < buffer.frames; i++) {
+		float rms = detector[i];
+		if (rms < -120.0f) rms = -120.0f;
+		if (rms > datum->threshold) {
+			attenuation = rms + attackFactor * (attenuation - rms);
+		} else {
+			attenuation = rms + decayFactor * (attenuation - rms);
+		}
+		float gain;
+		if (attenuation > datum->threshold) {
+			gain = 0.0f;
+		} else {
+			// Any lower and a closed gate turns what it lets through into denormals
+			gain = AZA_MAX(-10.0f * (datum->threshold - attenuation), -200.0f);
+			active = 1;
+		}
+		detector[i] = gain;
+	}
+	datum->attenuation = attenuation;
+	datum->gain = detector[buffer.frames-1];
+	// Nothing to do while the gate stays open
+	if (!active) return;
+	aza_db_to_amp_block(detector, detector, buffer.frames);
+	azaEnvelopeApply(buffer, first, count, detector);
+}
+
+static size_t azaGateTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaGateData *data = (azaGateData*)dsp;
+	size_t tail = 0;
+	for (size_t c = 0; c < buffer.channels; c++) {
+		// Every channel's activationEffects run even when linked
+		size_t activation = azaDSPChainTail(data[c].activationEffects, buffer);
+		if (c == 0 || !data->linked) {
+			activation = azaTailAdd(activation, azaEnvelopeTail(&data[c].rms, data[c].decay, buffer.samplerate));
+		}
+		tail = AZA_MAX(tail, activation);
+	}
+	return tail;
+}
+
+static int azaGateProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaGateData *data = (azaGateData*)dsp;
+	// When linked only data[0] has a detector
+	size_t detectors = data->linked ? 1 : buffer.channels;
+	for (size_t c = 0; c < detectors; c++) {
+		int err = azaRmsPrepare(&data[c].rms, buffer.samplerate);
+		if (err) return err;
+	}
+	int hasActivationEffects = 0;
+	for (size_t c = 0; c < buffer.channels; c++) {
+		if (data[c].activationEffects) hasActivationEffects = 1;
+	}
+	if (!hasActivationEffects) {
+		azaBuffer sideBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+		if (!sideBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
+		if (data->linked) {
+			azaEnvelopeDetectorInput(sideBuffer.samples, buffer, 0, buffer.channels);
+			azaRmsProcessSamples(&data->rms, sideBuffer.samples, buffer.frames);
+			azaGateFollow(data, sideBuffer.samples, buffer, 0, buffer.channels);
+		} else {
+			for (size_t c = 0; c < buffer.channels; c++) {
+				azaEnvelopeDetectorInput(sideBuffer.samples, buffer, c, 1);
+				azaRmsProcessSamples(&data[c].rms, sideBuffer.samples, buffer.frames);
+				azaGateFollow(&data[c], sideBuffer.samples, buffer, c, 1);
+			}
+		}
+		azaPopSideBuffer();
+	} else {
+		// Every channel's activation signal goes through its own effects before detection, so they all need a copy, followed by the detector
+		azaBuffer sideBuffer = azaPushSideBuffer(buffer.frames * (buffer.channels + 1), 1, buffer.samplerate);
+		if (!sideBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
+		float *detector = sideBuffer.samples + buffer.frames * buffer.channels;
+		if (data->linked) {
+			memset(detector, 0, sizeof(float) * buffer.frames);
+		}
+		for (size_t c = 0; c < buffer.channels; c++) {
+			azaBuffer activation = sideBuffer;
+			activation.samples = sideBuffer.samples + buffer.frames * c;
+			activation.frames = buffer.frames;
+			azaBufferCopyChannel(activation, 0, buffer, c);
+			if (data[c].activationEffects) {
+				int err = azaDSP(activation, data[c].activationEffects);
+				if (err) {
+					azaPopSideBuffer();
+					return err;
+				}
+			}
+			if (data->linked) {
+				for (size_t i = 0; i < buffer.frames; i++) {
+					float peak = fabsf(activation.samples[i]);
+					if (peak > detector[i]) detector[i] = peak;
+				}
+			} else {
+				azaRmsProcessSamples(&data[c].rms, activation.samples, buffer.frames);
+				azaGateFollow(&data[c], activation.samples, buffer, c, 1);
+			}
+		}
+		if (data->linked) {
+			azaRmsProcessSamples(&data->rms, detector, buffer.frames);
+			azaGateFollow(data, detector, buffer, 0, buffer.channels);
+		}
+		azaPopSideBuffer();
+	}
+	if (data->linked) {
+		for (size_t c = 1; c < buffer.channels; c++) {
+			data[c].gain = data->gain;
+		}
+	}
+	return AZA_SUCCESS;
+}
+
 int azaGate(azaBuffer buffer, azaGateData *data) {
-	azaBuffer sideBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
+
+
+int azaConvolutionIRInit(azaConvolutionIR *data, const float *samples, size_t frames, uint32_t partitionSize) {
+	if (partitionSize == 0) partitionSize = 64;
+	// The longest partitions are transformed at 128 times partitionSize
+	if (partitionSize < AZAUDIO_FFT_MIN_SIZE / 2 || partitionSize > AZAUDIO_FFT_MAX_SIZE / 128 || (partitionSize & (partitionSize - 1))) {
+		AZA_PRINT_ERR("azaConvolutionIRInit error: partitionSize (%u) must be a power of 2 from %u to %u\n", partitionSize, AZAUDIO_FFT_MIN_SIZE / 2, AZAUDIO_FFT_MAX_SIZE / 128);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	memset(data, 0, sizeof(*data));
+	data->partitionSize = partitionSize;
+	data->head = calloc(partitionSize, sizeof(float));
+	if (!data->head) return AZA_ERROR_OUT_OF_MEMORY;
+	for (uint32_t i = 0; i < partitionSize && i < frames; i++) {
+		data->head[partitionSize - 1 - i] = samples[i];
+	}
+	// Every level starts at least 2 of its partitions in, so it can be given a whole partition of time on another thread
+	size_t start = partitionSize;
+	for (uint32_t l = 0; l < AZAUDIO_CONVOLUTION_MAX_LEVELS && start < frames; l++) {
+		azaConvolutionIRLevel *level = &data->levels[l];
+		uint32_t size = partitionSize << (3 * l);
+		size_t end = frames;
+		if (l < AZAUDIO_CONVOLUTION_MAX_LEVELS - 1) {
+			end = AZA_MIN(end, (size_t)size * 16);
+		}
+		level->size = size;
+		level->start = (uint32_t)start;
+		level->count = (uint32_t)((end - start + size - 1) / size);
+		int err = azaFFTInit(&level->fft, size * 2);
+		if (err) {
+			azaConvolutionIRDeinit(data);
+			return err;
+		}
+		data->levelCount = l + 1;
+		level->spectra = malloc(sizeof(float) * (size + 1) * 2 * level->count);
+		float *time = calloc(size * 2, sizeof(float));
+		if (!level->spectra || !time) {
+			free(time);
+			azaConvolutionIRDeinit(data);
+			return AZA_ERROR_OUT_OF_MEMORY;
+		}
+		for (uint32_t m = 0; m < level->count; m++) {
+			size_t offset = start + (size_t)m * size;
+			size_t length = AZA_MIN((size_t)size, frames - offset);
+			memcpy(time, samples + offset, sizeof(float) * length);
+			memset(time + length, 0, sizeof(float) * (size * 2 - length));
+			azaFFTForward(&level->fft, level->spectra + (size + 1) * 2 * m, time);
+		}
+		free(time);
+		start = end;
+	}
+	return AZA_SUCCESS;
+}
+
+void azaConvolutionIRDeinit(azaConvolutionIR *data) {
+	for (uint32_t l = 0; l < data->levelCount; l++) {
+		free(data->levels[l].spectra);
+		azaFFTDeinit(&data->levels[l].fft);
+	}
+	free(data->head);
+	data->head = NULL;
+	data->levelCount = 0;
+}
+
+typedef struct azaConvolutionWorker {
+	pthread_t thread;
+	sem_t wake;
+	int quit;
+	azaConvolutionData *data;
+} azaConvolutionWorker;
+
+// Takes the two partitions of input in level->time and leaves a partition of output in its second half
+static void azaConvolutionLevelProcess(const azaConvolutionIRLevel *irLevel, azaConvolutionLevel *level) {
+	size_t bins = irLevel->size + 1;
+	float *newest = level->fdl + bins * 2 * level->fdlIndex;
+	azaFFTForward(&irLevel->fft, newest, level->time);
+	memset(level->accum, 0, sizeof(float) * bins * 2);
+	uint32_t slot = level->fdlIndex;
+	for (uint32_t m = 0; m < irLevel->count; m++) {
+		azaKernel.complexMulAdd(level->accum, level->fdl + bins * 2 * slot, irLevel->spectra + bins * 2 * m, bins);
+		slot = slot ? slot - 1 : irLevel->count - 1;
+	}
+	level->fdlIndex = (level->fdlIndex + 1) % irLevel->count;
+	azaFFTInverse(&irLevel->fft, level->time, level->accum);
+}
+
+static void* azaConvolutionWorkerProc(void *userData) {
+	azaConvolutionWorker *worker = userData;
+	azaConvolutionData *data = worker->data;
+	azaFlushDenormalsBegin();
+	while (1) {
+		sem_wait(&worker->wake);
+		if (__atomic_load_n(&worker->quit, __ATOMIC_ACQUIRE)) break;
+		for (uint32_t l = 1; l < data->ir->levelCount; l++) {
+			azaConvolutionLevel *level = &data->levels[l];
+			if (!__atomic_load_n(&level->queued, __ATOMIC_ACQUIRE)) continue;
+			azaConvolutionLevelProcess(&data->ir->levels[l], level);
+			__atomic_store_n(&level->queued, 0, __ATOMIC_RELEASE);
+		}
+	}
+	return NULL;
+}
+
+int azaConvolutionDataInit(azaConvolutionData *data) {
+	data->header.kind = AZA_DSP_CONVOLUTION;
+	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
+
+	const azaConvolutionIR *ir = data->ir;
+	if (!ir) return AZA_ERROR_NULL_POINTER;
+	data->input = NULL;
+	data->output = NULL;
+	data->headHistory = NULL;
+	data->worker = NULL;
+	data->frame = 0;
+	memset(data->levels, 0, sizeof(data->levels));
+	size_t longest = ir->partitionSize;
+	size_t reach = ir->partitionSize;
+	for (uint32_t l = 0; l < ir->levelCount; l++) {
+		const azaConvolutionIRLevel *irLevel = &ir->levels[l];
+		azaConvolutionLevel *level = &data->levels[l];
+		longest = AZA_MAX(longest, irLevel->size);
+		reach = AZA_MAX(reach, irLevel->start + irLevel->size);
+		level->fdl = calloc((size_t)(irLevel->size + 1) * 2 * irLevel->count, sizeof(float));
+		level->accum = malloc(sizeof(float) * (irLevel->size + 1) * 2);
+		level->time = malloc(sizeof(float) * irLevel->size * 2);
+		if (!level->fdl || !level->accum || !level->time) {
+			azaConvolutionDataDeinit(data);
+			return AZA_ERROR_OUT_OF_MEMORY;
+		}
+	}
+	data->inputCapacity = aza_next_pow2(longest * 2);
+	data->input = calloc(data->inputCapacity, sizeof(float));
+	data->outputCapacity = aza_next_pow2(reach + ir->partitionSize);
+	data->output = calloc(data->outputCapacity, sizeof(float));
+	data->headHistory = calloc(ir->partitionSize * 2, sizeof(float));
+	azaConvolutionWorker *worker = NULL;
+	if (data->threaded && ir->levelCount > 1) {
+		worker = malloc(sizeof(azaConvolutionWorker));
+	}
+	if (!data->input || !data->output || !data->headHistory || (data->threaded && ir->levelCount > 1 && !worker)) {
+		free(worker);
+		azaConvolutionDataDeinit(data);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	if (worker) {
+		worker->quit = 0;
+		worker->data = data;
+		sem_init(&worker->wake, 0, 0);
+		if (pthread_create(&worker->thread, NULL, azaConvolutionWorkerProc, worker)) {
+			sem_destroy(&worker->wake);
+			free(worker);
+			azaConvolutionDataDeinit(data);
+			return AZA_ERROR_INVALID_CONFIGURATION;
+		}
+		data->worker = worker;
+	}
+	return AZA_SUCCESS;
+}
+
+void azaConvolutionDataDeinit(azaConvolutionData *data) {
+	azaConvolutionWorker *worker = data->worker;
+	if (worker) {
+		__atomic_store_n(&worker->quit, 1, __ATOMIC_RELEASE);
+		sem_post(&worker->wake);
+		pthread_join(worker->thread, NULL);
+		sem_destroy(&worker->wake);
+		free(worker);
+		data->worker = NULL;
+	}
+	for (uint32_t l = 0; l < AZAUDIO_CONVOLUTION_MAX_LEVELS; l++) {
+		free(data->levels[l].fdl);
+		free(data->levels[l].accum);
+		free(data->levels[l].time);
+		data->levels[l].fdl = NULL;
+		data->levels[l].accum = NULL;
+		data->levels[l].time = NULL;
+	}
+	free(data->input);
+	free(data->output);
+	free(data->headHistory);
+	data->input = NULL;
+	data->output = NULL;
+	data->headHistory = NULL;
+}
+
+// Adds the output waiting in level->time, which starts at frame
+static void azaConvolutionLevelCollect(azaConvolutionData *data, azaConvolutionLevel *level, uint32_t size, size_t frame) {
+	size_t mask = data->outputCapacity - 1;
+	const float *result = level->time + size;
+	for (uint32_t i = 0; i < size; i++) {
+		data->output[(frame + i) & mask] += result[i];
+	}
+	level->pending = 0;
+}
+
+// Called at the end of every partition of level l
+static void azaConvolutionLevelBoundary(azaConvolutionData *data, uint32_t l) {
+	const azaConvolutionIRLevel *irLevel = &data->ir->levels[l];
+	azaConvolutionLevel *level = &data->levels[l];
+	uint32_t size = irLevel->size;
+	azaConvolutionWorker *worker = data->worker;
+	if (worker && l > 0) {
+		if (level->pending) {
+			// The worker had a whole partition to finish, so this should only spin if the machine is overloaded
+			while (__atomic_load_n(&level->queued, __ATOMIC_ACQUIRE));
+			// Queued a partition ago, so its output starts one partition later than the synchronous path
+			azaConvolutionLevelCollect(data, level, size, data->frame - size * 2 + irLevel->start);
+		}
+		azaRingRead(level->time, data->input, data->inputCapacity, data->frame - size * 2, size * 2);
+		level->pending = 1;
+		__atomic_store_n(&level->queued, 1, __ATOMIC_RELEASE);
+		sem_post(&worker->wake);
+	} else {
+		azaRingRead(level->time, data->input, data->inputCapacity, data->frame - size * 2, size * 2);
+		azaConvolutionLevelProcess(irLevel, level);
+		azaConvolutionLevelCollect(data, level, size, data->frame - size + irLevel->start);
+	}
+}
+
+// The whole impulse response, plus the partitions still on their way through the levels
+static size_t azaConvolutionTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaConvolutionData *data = (azaConvolutionData*)dsp;
+	size_t tail = 0;
 	for (size_t c = 0; c < buffer.channels; c++) {
-		azaGateData *datum = &data[c];
-		float t = (float)buffer.samplerate / 1000.0f;
-		float attackFactor = expf(-1.0f / (datum->attack * t));
-		float decayFactor = expf(-1.0f / (datum->decay * t));
+		const azaConvolutionIR *ir = data[c].ir;
+		if (!ir) continue;
+		size_t length = ir->partitionSize;
+		for (uint32_t l = 0; l < ir->levelCount; l++) {
+			const azaConvolutionIRLevel *level = &ir->levels[l];
+			length = AZA_MAX(length, (size_t)level->start + (size_t)level->count * level->size + 2 * level->size);
+		}
+		tail = AZA_MAX(tail, length);
+	}
+	return tail;
+}
 
-		azaBufferCopyChannel(sideBuffer, 0, buffer, c);
-		
-		if (datum->activationEffects) {
-			int err = azaDSP(sideBuffer, datum->activationEffects);
-			if (err) return err;
+static int azaConvolutionProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaConvolutionData *data = (azaConvolutionData*)dsp;
+	for (size_t c = 0; c < buffer.channels; c++) {
+		azaConvolutionData *datum = &data[c];
+		const azaConvolutionIR *ir = datum->ir;
+		if (!ir || !datum->input) return AZA_ERROR_NULL_POINTER;
+		float *samples = azaBufferChannelSamples(buffer, c);
+		size_t partitionSize = ir->partitionSize;
+		size_t outputMask = datum->outputCapacity - 1;
+		float amount = aza_db_to_ampf(datum->gain);
+		float amountDry = aza_db_to_ampf(datum->gainDry);
+		float *chunk = datum->headHistory + partitionSize - 1;
+		size_t done = 0;
+		while (done < buffer.frames) {
+			// Chunks end on partition boundaries so the levels can be processed between them
+			size_t frames = AZA_MIN(buffer.frames - done, partitionSize - (datum->frame & (partitionSize - 1)));
+			float *dst = samples + done * buffer.stride;
+			for (size_t i = 0; i < frames; i++) {
+				chunk[i] = dst[i * buffer.stride];
+			}
+			azaRingWrite(datum->input, datum->inputCapacity, datum->frame, chunk, frames);
+			for (size_t i = 0; i < frames; i++) {
+				size_t o = (datum->frame + i) & outputMask;
+				float wet = azaKernel.dot(ir->head, datum->headHistory + i, partitionSize) + datum->output[o];
+				datum->output[o] = 0.0f;
+				dst[i * buffer.stride] = wet * amount + chunk[i] * amountDry;
+			}
+			memmove(datum->headHistory, datum->headHistory + frames, sizeof(float) * (partitionSize - 1));
+			datum->frame += frames;
+			done += frames;
+			for (uint32_t l = 0; l < ir->levelCount; l++) {
+				if ((datum->frame & (ir->levels[l].size - 1)) == 0) {
+					azaConvolutionLevelBoundary(datum, l);
+				}
+			}
 		}
-		
-#if 0
-		azaBufferCopyChannel(buffer, c, sideBuffer, 0);
-		if (c == 0) {
-			azaRms(sideBuffer, &datum->rms);
-			AZA_PRINT_INFO("rms: %fdB\n", aza_amp_to_dbf(sideBuffer.samples[sideBuffer.frames-1]));
+	}
+	return AZA_SUCCESS;
+}
+
+int azaConvolution(azaBuffer buffer, azaConvolutionData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
+
+
+int azaVoicePoolDataInit(azaVoicePoolData *data) {
+	data->header.kind = AZA_DSP_VOICE_POOL;
+	data->header.structSize = sizeof(*data);
+	azaDSPProfileReset(&data->header);
+	data->header.silentFrames = AZA_TAIL_INFINITE;
+
+	if (data->capacity == 0 || data->capacity > AZAUDIO_VOICE_POOL_MAX_VOICES) {
+		AZA_PRINT_ERR("azaVoicePoolDataInit error: capacity (%u) must be from 1 to %u\n", data->capacity, AZAUDIO_VOICE_POOL_MAX_VOICES);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	data->table = azaGetResampleTable(data->quality);
+	uint32_t capacity = data->capacity;
+	data->position = calloc(capacity, sizeof(*data->position));
+	data->pitch = calloc(capacity, sizeof(*data->pitch));
+	data->amp = calloc(capacity, sizeof(*data->amp));
+	data->pan = calloc(capacity, sizeof(*data->pan));
+	data->mixGains = calloc(capacity * 2, sizeof(*data->mixGains));
+	data->source = calloc(capacity, sizeof(*data->source));
+	data->priority = calloc(capacity, sizeof(*data->priority));
+	data->started = calloc(capacity, sizeof(*data->started));
+	data->generation = calloc(capacity, sizeof(*data->generation));
+	data->looping = calloc(capacity, sizeof(*data->looping));
+	data->active = calloc(capacity, sizeof(*data->active));
+	data->activeSlot = calloc(capacity, sizeof(*data->activeSlot));
+	data->free = calloc(capacity, sizeof(*data->free));
+	if (!data->table || !data->position || !data->pitch || !data->amp || !data->pan || !data->mixGains || !data->source || !data->priority || !data->started || !data->generation || !data->looping || !data->active || !data->activeSlot || !data->free) {
+		azaVoicePoolDataDeinit(data);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	for (uint32_t i = 0; i < capacity; i++) {
+		data->generation[i] = 1;
+		// Popped from the back, so the first voices get used first
+		data->free[i] = capacity - 1 - i;
+	}
+	data->freeCount = capacity;
+	data->activeCount = 0;
+	data->frame = 0;
+	return AZA_SUCCESS;
+}
+
+void azaVoicePoolDataDeinit(azaVoicePoolData *data) {
+	free(data->position);
+	free(data->pitch);
+	free(data->amp);
+	free(data->pan);
+	free(data->mixGains);
+	free(data->source);
+	free(data->priority);
+	free(data->started);
+	free(data->generation);
+	free(data->looping);
+	free(data->active);
+	free(data->activeSlot);
+	free(data->free);
+	data->position = NULL;
+	data->pitch = NULL;
+	data->amp = NULL;
+	data->pan = NULL;
+	data->mixGains = NULL;
+	data->source = NULL;
+	data->priority = NULL;
+	data->started = NULL;
+	data->generation = NULL;
+	data->looping = NULL;
+	data->active = NULL;
+	data->activeSlot = NULL;
+	data->free = NULL;
+	data->activeCount = 0;
+	data->freeCount = 0;
+}
+
+static azaVoiceHandle azaVoiceMakeHandle(azaVoicePoolData *data, uint32_t index) {
+	return ((azaVoiceHandle)data->generation[index] << 16) | index;
+}
+
+// Returns nonzero and sets index if the voice is still playing
+static int azaVoiceFind(azaVoicePoolData *data, azaVoiceHandle voice, uint32_t *index) {
+	*index = voice & 0xFFFF;
+	return *index < data->capacity && data->generation[*index] == (uint16_t)(voice >> 16);
+}
+
+static void azaVoiceRelease(azaVoicePoolData *data, uint32_t index) {
+	uint32_t slot = data->activeSlot[index];
+	uint32_t last = data->active[--data->activeCount];
+	data->active[slot] = last;
+	data->activeSlot[last] = slot;
+	// Zero is left out so no handle is ever AZA_VOICE_INVALID
+	if (++data->generation[index] == 0) data->generation[index] = 1;
+	data->source[index] = NULL;
+	data->free[data->freeCount++] = index;
+}
+
+// Gains for the two channels of a stereo buffer, where the center is unity on both sides
+static void azaVoiceTargetGains(azaVoicePoolData *data, uint32_t index, float masterAmp, float gains[2]) {
+	float amp = data->amp[index] * masterAmp;
+	float pan = data->pan[index];
+	gains[0] = amp * AZA_MIN(1.0f, 1.0f - pan);
+	gains[1] = amp * AZA_MIN(1.0f, 1.0f + pan);
+}
+
+azaVoiceHandle azaVoicePlay(azaVoicePoolData *data, const azaBuffer *source, float gain, float pitch, float pan, uint32_t priority, int looping) {
+	if (source == NULL || source->frames == 0 || source->channels == 0) return AZA_VOICE_INVALID;
+	if (data->freeCount == 0) {
+		uint32_t victim = data->active[0];
+		for (uint32_t i = 1; i < data->activeCount; i++) {
+			uint32_t index = data->active[i];
+			if (data->priority[index] < data->priority[victim] || (data->priority[index] == data->priority[victim] && data->started[index] < data->started[victim])) {
+				victim = index;
+			}
 		}
-#else
-		azaRms(sideBuffer, &datum->rms);
-		for (size_t i = 0; i < buffer.frames; i++) {
-			size_t s = i * buffer.stride + c;
+		if (data->priority[victim] > priority) return AZA_VOICE_INVALID;
+		azaVoiceRelease(data, victim);
+	}
+	uint32_t index = data->free[--data->freeCount];
+	data->activeSlot[index] = data->activeCount;
+	data->active[data->activeCount++] = index;
+	data->position[index] = 0;
+	data->pitch[index] = AZA_MAX(pitch, 0.0f);
+	data->amp[index] = aza_db_to_ampf(gain);
+	data->pan[index] = clampf(pan, -1.0f, 1.0f);
+	data->source[index] = source;
+	data->priority[index] = priority;
+	data->started[index] = data->frame;
+	data->looping[index] = looping != 0;
+	// Starts right at the target so the attack of one-shots isn't softened
+	azaVoiceTargetGains(data, index, aza_db_to_ampf(data->gain), &data->mixGains[index*2]);
+	return azaVoiceMakeHandle(data, index);
+}
 
-			float rms = aza_amp_to_dbf(sideBuffer.samples[i]);
-			if (rms < -120.0f) rms = -120.0f;
-			if (rms > datum->threshold) {
-				datum->attenuation = rms + attackFactor * (datum->attenuation - rms);
-			} else {
-				datum->attenuation = rms + decayFactor * (datum->attenuation - rms);
+int azaVoiceIsPlaying(azaVoicePoolData *data, azaVoiceHandle voice) {
+	uint32_t index;
+	return azaVoiceFind(data, voice, &index);
+}
+
+void azaVoiceStop(azaVoicePoolData *data, azaVoiceHandle voice) {
+	uint32_t index;
+	if (azaVoiceFind(data, voice, &index)) {
+		azaVoiceRelease(data, index);
+	}
+}
+
+void azaVoiceSetGain(azaVoicePoolData *data, azaVoiceHandle voice, float gain) {
+	uint32_t index;
+	if (azaVoiceFind(data, voice, &index)) {
+		data->amp[index] = aza_db_to_ampf(gain);
+	}
+}
+
+void azaVoiceSetPitch(azaVoicePoolData *data, azaVoiceHandle voice, float pitch) {
+	uint32_t index;
+	if (azaVoiceFind(data, voice, &index)) {
+		data->pitch[index] = AZA_MAX(pitch, 0.0f);
+	}
+}
+
+void azaVoiceSetPan(azaVoicePoolData *data, azaVoiceHandle voice, float pan) {
+	uint32_t index;
+	if (azaVoiceFind(data, voice, &index)) {
+		data->pan[index] = clampf(pan, -1.0f, 1.0f);
+	}
+}
+
+// Renders up to frames of one source channel into dst stepping by step each frame, starting at position.
+// Returns how many frames were rendered before a one-shot ran out.
+static size_t azaVoiceRender(float *dst, size_t frames, const azaResampleTable *table, uint32_t band, const float *src, size_t stride, int64_t srcFrames, uint64_t position, uint64_t step, int looping) {
+	uint64_t end = (uint64_t)srcFrames << 32;
+	int64_t taps = (int64_t)table->taps;
+	size_t i = 0;
+	if (step == ((uint64_t)1 << 32) && (uint32_t)position == 0) {
+		// Exactly 1x on a sample boundary is a straight copy
+		int64_t index = (int64_t)(position >> 32);
+		while (i < frames) {
+			if (index >= srcFrames) {
+				if (!looping) break;
+				index = 0;
 			}
-			float gain;
-			if (datum->attenuation > datum->threshold) {
-				gain = 0.0f;
+			size_t count = AZA_MIN(frames - i, (size_t)(srcFrames - index));
+			azaKernel.copyStrided(dst + i, 1, src + index * stride, stride, count);
+			i += count;
+			index += count;
+		}
+		return i;
+	}
+	for (; i < frames; i++) {
+		if (position >= end) {
+			if (!looping) break;
+			position %= end;
+		}
+		int64_t start = (int64_t)(position >> 32) - taps / 2 + 1;
+		const float *window;
+		float gathered[AZA_RESAMPLE_QUALITY_32];
+		if (stride == 1 && start >= 0 && start + taps <= srcFrames) {
+			window = src + start;
+		} else if (looping) {
+			int64_t index = start % srcFrames;
+			if (index < 0) index += srcFrames;
+			for (int64_t k = 0; k < taps; k++) {
+				gathered[k] = src[index * stride];
+				if (++index == srcFrames) index = 0;
+			}
+			window = gathered;
+		} else {
+			// One-shots are silent on either side
+			for (int64_t k = 0; k < taps; k++) {
+				int64_t index = start + k;
+				gathered[k] = index >= 0 && index < srcFrames ? src[index * stride] : 0.0f;
+			}
+			window = gathered;
+		}
+		dst[i] = azaResampleSample(table, band, window, (uint32_t)position);
+		position += step;
+	}
+	return i;
+}
+
+// dst[i] += src[i] * gain, where gain goes linearly from gainStart towards gainEnd
+static void azaVoiceAccumulate(float *dst, const float *src, size_t frames, float gainStart, float gainEnd) {
+	if (gainStart == gainEnd) {
+		azaKernel.mix(dst, 1.0f, src, gainStart, frames);
+		return;
+	}
+	float delta = (gainEnd - gainStart) / (float)frames;
+	for (size_t i = 0; i < frames; i++) {
+		dst[i] += src[i] * (gainStart + delta * (float)i);
+	}
+}
+
+// Adds nothing while no voices are playing
+static size_t azaVoicePoolTail(azaDSPData *dsp, azaBuffer buffer) {
+	azaVoicePoolData *data = (azaVoicePoolData*)dsp;
+	return data->activeCount ? AZA_TAIL_INFINITE : 0;
+}
+
+static int azaVoicePoolProcess(azaBuffer buffer, azaDSPData *dsp) {
+	azaVoicePoolData *data = (azaVoicePoolData*)dsp;
+	float masterAmp = aza_db_to_ampf(data->gain);
+	// Every voice adds into one contiguous channel after another so the adds can be SIMD regardless of the buffer's layout
+	azaBuffer accumBuffer = azaPushSideBuffer(buffer.frames * buffer.channels, 1, buffer.samplerate);
+	if (!accumBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
+	azaBuffer renderBuffer = azaPushSideBuffer(buffer.frames, 1, buffer.samplerate);
+	if (!renderBuffer.samples) return AZA_ERROR_OUT_OF_MEMORY;
+	memset(accumBuffer.samples, 0, sizeof(float) * buffer.frames * buffer.channels);
+	// Backwards so voices that finish can be swapped out from under us
+	for (uint32_t a = data->activeCount; a-- > 0;) {
+		uint32_t index = data->active[a];
+		const azaBuffer *source = data->source[index];
+		int64_t srcFrames = (int64_t)source->frames;
+		float speed = data->pitch[index] * (float)source->samplerate / (float)buffer.samplerate;
+		uint64_t step = (uint64_t)((double)speed * 4294967296.0);
+		uint32_t band = azaResampleBand(speed);
+		int panned = source->channels == 1 && buffer.channels == 2;
+		float gains[2];
+		azaVoiceTargetGains(data, index, masterAmp, gains);
+		if (!panned) {
+			// Balance only applies to mono on stereo
+			gains[0] = gains[1] = data->amp[index] * masterAmp;
+		}
+		size_t rendered = buffer.frames;
+		for (size_t sc = 0; sc < source->channels && sc < buffer.channels; sc++) {
+			rendered = azaVoiceRender(renderBuffer.samples, buffer.frames, data->table, band, azaBufferChannelSamples(*source, sc), source->stride, srcFrames, data->position[index], step, data->looping[index]);
+			for (size_t c = sc; c < buffer.channels; c += source->channels) {
+				size_t g = panned ? c : 0;
+				azaVoiceAccumulate(accumBuffer.samples + c * buffer.frames, renderBuffer.samples, rendered, data->mixGains[index*2+g], gains[g]);
+			}
+		}
+		data->mixGains[index*2+0] = gains[0];
+		data->mixGains[index*2+1] = gains[1];
+		uint64_t end = (uint64_t)srcFrames << 32;
+		if (rendered < buffer.frames) {
+			azaVoiceRelease(data, index);
+			continue;
+		}
+		uint64_t position = data->position[index] + step * buffer.frames;
+		if (position >= end) {
+			if (data->looping[index]) {
+				position %= end;
 			} else {
-				gain = -10.0f * (datum->threshold - datum->attenuation);
+				azaVoiceRelease(data, index);
+				continue;
+			}
+		}
+		data->position[index] = position;
+	}
+	for (size_t c = 0; c < buffer.channels; c++) {
+		float *samples = azaBufferChannelSamples(buffer, c);
+		const float *accum = accumBuffer.samples + c * buffer.frames;
+		if (buffer.stride == 1) {
+			azaKernel.mix(samples, 1.0f, accum, 1.0f, buffer.frames);
+		} else {
+			for (size_t i = 0; i < buffer.frames; i++) {
+				samples[i * buffer.stride] += accum[i];
 			}
-			datum->gain = gain;
-			buffer.samples[s] = buffer.samples[s] * aza_db_to_ampf(gain);
 		}
-#endif
 	}
 	azaPopSideBuffer();
-	if (data->header.pNext) {
-		return azaDSP(buffer, data->header.pNext);
+	azaPopSideBuffer();
+	data->frame += buffer.frames;
+	return AZA_SUCCESS;
+}
+
+int azaVoicePool(azaBuffer buffer, azaVoicePoolData *data) {
+	if (data == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	return azaDSP(buffer, &data->header);
+}
+
+
+
+typedef size_t (*fp_azaDSPTail)(azaDSPData *data, azaBuffer buffer);
+
+typedef struct azaDSPKindInfo {
+	fp_azaDSPProcess process;
+	fp_azaDSPTail tail;
+	// Nonzero if silent input always gives silent output, even while the state is still settling
+	int keepsSilence;
+	// Side buffer samples needed per frame as fixed + perChannel * channels, spread over depth side buffers
+	uint32_t scratchFixed;
+	uint32_t scratchPerChannel;
+	uint32_t scratchDepth;
+} azaDSPKindInfo;
+
+static const azaDSPKindInfo azaDSPKinds[] = {
+	[AZA_DSP_RMS]               = { azaRmsProcess,              azaRmsTail,               0, 1, 0, 1 },
+	[AZA_DSP_FILTER]            = { azaFilterProcess,           azaFilterTail,            0, 0, 0, 0 },
+	[AZA_DSP_LOOKAHEAD_LIMITER] = { azaLookaheadLimiterProcess, azaLookaheadLimiterTail,  0, 1, 0, 1 },
+	[AZA_DSP_COMPRESSOR]        = { azaCompressorProcess,       azaCompressorTail,        1, 1, 0, 1 },
+	[AZA_DSP_DELAY]             = { azaDelayProcess,            azaDelayTail,             0, 1, 0, 1 },
+	[AZA_DSP_REVERB]            = { azaReverbProcess,           azaReverbTail,            0, 1 + AZAUDIO_REVERB_LINES, 0, 2 },
+	[AZA_DSP_SAMPLER]           = { azaSamplerProcess,          azaSamplerTail,           0, 1, 0, 1 },
+	// Gates with activationEffects also copy every channel, which azaDSPChainValidate adds in
+	[AZA_DSP_GATE]              = { azaGateProcess,             azaGateTail,              1, 1, 0, 1 },
+	[AZA_DSP_BIQUAD]            = { azaBiquadProcess,           azaBiquadTail,            0, 0, 0, 0 },
+	[AZA_DSP_CONVOLUTION]       = { azaConvolutionProcess,      azaConvolutionTail,       0, 0, 0, 0 },
+	[AZA_DSP_VOICE_POOL]        = { azaVoicePoolProcess,        azaVoicePoolTail,         0, 1, 1, 2 },
+};
+
+static const azaDSPKindInfo* azaDSPKindGet(azaDSPKind kind) {
+	if ((uint32_t)kind >= sizeof(azaDSPKinds) / sizeof(azaDSPKinds[0]) || !azaDSPKinds[kind].process) {
+		return NULL;
+	}
+	return &azaDSPKinds[kind];
+}
+
+#if AZAUDIO_PROFILE
+static void azaDSPProfileRecord(azaDSPData *data, azaBuffer buffer, uint64_t ns) {
+	azaDSPProfileCounters *profile = &data->profile;
+	uint64_t bufferNs = buffer.samplerate ? (uint64_t)buffer.frames * 1000000000ull / buffer.samplerate : 0;
+	uint64_t load = bufferNs ? ns * 1000000ull / bufferNs : 0;
+	__atomic_add_fetch(&profile->calls, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&profile->frames, buffer.frames, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&profile->ns, ns, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&profile->bufferNs, bufferNs, __ATOMIC_RELAXED);
+	uint64_t current = __atomic_load_n(&profile->minNs, __ATOMIC_RELAXED);
+	while (ns < current && !__atomic_compare_exchange_n(&profile->minNs, &current, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	current = __atomic_load_n(&profile->maxNs, __ATOMIC_RELAXED);
+	while (ns > current && !__atomic_compare_exchange_n(&profile->maxNs, &current, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	current = __atomic_load_n(&profile->peakLoad, __ATOMIC_RELAXED);
+	while (load > current && !__atomic_compare_exchange_n(&profile->peakLoad, &current, load, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+#endif
+
+// Every node in a chain runs through here, so this is the only place that needs profiling or silence handling.
+// Clears buffer->silent if the node might have made sound.
+static inline int azaDSPProcessNode(const azaDSPKindInfo *kind, azaBuffer *buffer, azaDSPData *data) {
+	if (buffer->silent) {
+		// Nothing can come out once the tail is over, and the state is as good as reset
+		size_t tail = kind->tail(data, *buffer);
+		if (tail != AZA_TAIL_INFINITE && data->silentFrames >= tail) return AZA_SUCCESS;
+		data->silentFrames = azaTailAdd(data->silentFrames, buffer->frames);
+		if (!kind->keepsSilence) buffer->silent = 0;
+	} else {
+		data->silentFrames = 0;
+	}
+#if AZAUDIO_PROFILE
+	uint64_t start = aza_now_ns();
+	int err = kind->process(*buffer, data);
+	azaDSPProfileRecord(data, *buffer, aza_now_ns() - start);
+	return err;
+#else
+	return kind->process(*buffer, data);
+#endif
+}
+
+azaDSPProfile azaDSPProfileGet(const azaDSPData *data) {
+	azaDSPProfile result = {0};
+	result.kind = data->kind;
+#if AZAUDIO_PROFILE
+	const azaDSPProfileCounters *profile = &data->profile;
+	result.calls = __atomic_load_n(&profile->calls, __ATOMIC_RELAXED);
+	result.frames = __atomic_load_n(&profile->frames, __ATOMIC_RELAXED);
+	if (result.calls == 0) return result;
+	uint64_t ns = __atomic_load_n(&profile->ns, __ATOMIC_RELAXED);
+	uint64_t bufferNs = __atomic_load_n(&profile->bufferNs, __ATOMIC_RELAXED);
+	result.minNs = (double)__atomic_load_n(&profile->minNs, __ATOMIC_RELAXED);
+	result.maxNs = (double)__atomic_load_n(&profile->maxNs, __ATOMIC_RELAXED);
+	result.avgNs = (double)ns / (double)result.calls;
+	result.nsPerFrame = result.frames ? (double)ns / (double)result.frames : 0.0;
+	result.loadPercent = bufferNs ? (double)ns / (double)bufferNs * 100.0 : 0.0;
+	result.peakLoadPercent = (double)__atomic_load_n(&profile->peakLoad, __ATOMIC_RELAXED) / 10000.0;
+#endif
+	return result;
+}
+
+void azaDSPProfileReset(azaDSPData *data) {
+#if AZAUDIO_PROFILE
+	azaDSPProfileCounters *profile = &data->profile;
+	__atomic_store_n(&profile->calls, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&profile->frames, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&profile->ns, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&profile->bufferNs, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&profile->minNs, UINT64_MAX, __ATOMIC_RELAXED);
+	__atomic_store_n(&profile->maxNs, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&profile->peakLoad, 0, __ATOMIC_RELAXED);
+#else
+	(void)data;
+#endif
+}
+
+int azaDSP(azaBuffer buffer, azaDSPData *data) {
+	int err = azaCheckBuffer(buffer);
+	if (err) return err;
+	size_t depth = sideBuffersInUse;
+	for (; data; data = data->pNext) {
+		const azaDSPKindInfo *kind = azaDSPKindGet(data->kind);
+		if (!kind) {
+			err = AZA_ERROR_INVALID_DSP_STRUCT;
+			break;
+		}
+		err = azaDSPProcessNode(kind, &buffer, data);
+		if (err) break;
+	}
+	// Scoped release for anything that returned without popping its side buffers
+	azaPopSideBuffersTo(depth);
+	return err;
+}
+
+size_t azaDSPTail(azaDSPData *data, azaBuffer buffer) {
+	const azaDSPKindInfo *kind = azaDSPKindGet(data->kind);
+	if (!kind) return 0;
+	return kind->tail(data, buffer);
+}
+
+
+
+#define AZAUDIO_DSP_PLAN_MAX_NODES 256
+
+typedef struct azaDSPScratchNeed {
+	uint32_t fixed;
+	uint32_t perChannel;
+	uint32_t depth;
+} azaDSPScratchNeed;
+
+// The chain nested in data, if its kind has one. Taken from data[0], since we can't know how many channels there will be.
+static azaDSPData* azaDSPNestedHead(azaDSPData *data) {
+	if (data->kind == AZA_DSP_DELAY) {
+		return ((azaDelayData*)data)->wetEffects;
+	} else if (data->kind == AZA_DSP_GATE) {
+		return ((azaGateData*)data)->activationEffects;
+	}
+	return NULL;
+}
+
+// Walks head and every chain nested in it, making sure they're all known kinds with no loops, and works out the most scratch needed at once.
+// path holds pathCount nodes of the chains we're nested in, with room for AZAUDIO_DSP_PLAN_MAX_NODES.
+static int azaDSPChainValidate(azaDSPData *head, azaDSPData **path, uint32_t pathCount, azaDSPScratchNeed *need) {
+	*need = (azaDSPScratchNeed) {0};
+	for (azaDSPData *data = head; data; data = data->pNext) {
+		const azaDSPKindInfo *kind = azaDSPKindGet(data->kind);
+		if (!kind) {
+			AZA_PRINT_ERR("azaDSPPlanCompile error: unknown kind (%d)\n", (int)data->kind);
+			return AZA_ERROR_INVALID_DSP_STRUCT;
+		}
+		for (uint32_t i = 0; i < pathCount; i++) {
+			if (path[i] == data) {
+				AZA_PRINT_ERR("azaDSPPlanCompile error: chain loops back on itself\n");
+				return AZA_ERROR_INVALID_CONFIGURATION;
+			}
+		}
+		if (pathCount >= AZAUDIO_DSP_PLAN_MAX_NODES) {
+			AZA_PRINT_ERR("azaDSPPlanCompile error: more than %u nodes\n", AZAUDIO_DSP_PLAN_MAX_NODES);
+			return AZA_ERROR_INVALID_CONFIGURATION;
+		}
+		path[pathCount++] = data;
+		azaDSPScratchNeed step = {
+			.fixed = kind->scratchFixed,
+			.perChannel = kind->scratchPerChannel,
+			.depth = kind->scratchDepth,
+		};
+		azaDSPData *nested = azaDSPNestedHead(data);
+		if (data->kind == AZA_DSP_GATE && nested) step.perChannel += 1;
+		if (nested) {
+			// Nested chains run while the side buffers of the one containing them are still in use
+			azaDSPScratchNeed nestedNeed;
+			int err = azaDSPChainValidate(nested, path, pathCount, &nestedNeed);
+			if (err) return err;
+			step.fixed += nestedNeed.fixed;
+			step.perChannel += nestedNeed.perChannel;
+			step.depth += nestedNeed.depth;
+		}
+		need->fixed = AZA_MAX(need->fixed, step.fixed);
+		need->perChannel = AZA_MAX(need->perChannel, step.perChannel);
+		need->depth = AZA_MAX(need->depth, step.depth);
 	}
 	return AZA_SUCCESS;
 }
+
+// How many nodes are in head and the chains nested in it, which must have been validated
+static uint32_t azaDSPChainCount(azaDSPData *head) {
+	uint32_t count = 0;
+	for (azaDSPData *data = head; data; data = data->pNext) {
+		count += 1 + azaDSPChainCount(azaDSPNestedHead(data));
+	}
+	return count;
+}
+
+static void azaDSPPlanRecordNested(azaDSPPlan *plan, azaDSPData *head, uint32_t depth) {
+	for (azaDSPData *data = head; data; data = data->pNext) {
+		plan->nested[plan->nestedCount++] = (azaDSPPlanNested) {
+			.data = data,
+			.kind = data->kind,
+			.depth = depth,
+		};
+		azaDSPPlanRecordNested(plan, azaDSPNestedHead(data), depth + 1);
+	}
+}
+
+#ifndef NDEBUG
+// Whether head walks the same as what was recorded from *index up to end, never walking further than that so loops end too
+static int azaDSPPlanNestedMatches(const azaDSPPlan *plan, azaDSPData *head, uint32_t depth, uint32_t *index, uint32_t end) {
+	for (azaDSPData *data = head; data; data = data->pNext) {
+		if (*index == end) return 0;
+		const azaDSPPlanNested *nested = &plan->nested[(*index)++];
+		if (nested->data != data || nested->kind != data->kind || nested->depth != depth) return 0;
+		if (!azaDSPPlanNestedMatches(plan, azaDSPNestedHead(data), depth + 1, index, end)) return 0;
+	}
+	return 1;
+}
+
+// Whether the chain is still what was compiled, nested chains and all
+static int azaDSPPlanMatches(const azaDSPPlan *plan) {
+	if (plan->count == 0) return plan->head == NULL;
+	if (plan->steps[0].data != plan->head) return 0;
+	for (uint32_t i = 0; i < plan->count; i++) {
+		const azaDSPPlanStep *step = &plan->steps[i];
+		if (step->data->kind != step->kind) return 0;
+		azaDSPData *next = i + 1 < plan->count ? plan->steps[i+1].data : NULL;
+		if (step->data->pNext != next) return 0;
+		uint32_t index = step->nestedStart;
+		uint32_t end = step->nestedStart + step->nestedCount;
+		if (!azaDSPPlanNestedMatches(plan, azaDSPNestedHead(step->data), 0, &index, end) || index != end) return 0;
+	}
+	return 1;
+}
+#endif
+
+// Returns AZA_ERROR_OUT_OF_MEMORY without touching the heap if the chain doesn't fit and allocate isn't set
+static int azaDSPPlanBuildSteps(azaDSPPlan *plan, azaDSPData *head, int allocate) {
+	azaDSPData *path[AZAUDIO_DSP_PLAN_MAX_NODES];
+	azaDSPScratchNeed need;
+	plan->head = head;
+	plan->count = 0;
+	plan->nestedCount = 0;
+	int err = azaDSPChainValidate(head, path, 0, &need);
+	if (err) return err;
+	uint32_t count = 0;
+	uint32_t nestedCount = 0;
+	for (azaDSPData *data = head; data; data = data->pNext) {
+		count++;
+		nestedCount += azaDSPChainCount(azaDSPNestedHead(data));
+	}
+	if (count > plan->capacity) {
+		if (!allocate) return AZA_ERROR_OUT_OF_MEMORY;
+		azaDSPPlanStep *steps = realloc(plan->steps, sizeof(azaDSPPlanStep) * count);
+		if (!steps) return AZA_ERROR_OUT_OF_MEMORY;
+		plan->steps = steps;
+		plan->capacity = count;
+	}
+	if (nestedCount > plan->nestedCapacity) {
+		if (!allocate) return AZA_ERROR_OUT_OF_MEMORY;
+		azaDSPPlanNested *nested = realloc(plan->nested, sizeof(azaDSPPlanNested) * nestedCount);
+		if (!nested) return AZA_ERROR_OUT_OF_MEMORY;
+		plan->nested = nested;
+		plan->nestedCapacity = nestedCount;
+	}
+	for (azaDSPData *data = head; data; data = data->pNext) {
+		azaDSPPlanStep *step = &plan->steps[plan->count++];
+		*step = (azaDSPPlanStep) {
+			.data = data,
+			.kind = data->kind,
+			.nestedStart = plan->nestedCount,
+		};
+		azaDSPPlanRecordNested(plan, azaDSPNestedHead(data), 0);
+		step->nestedCount = plan->nestedCount - step->nestedStart;
+	}
+	plan->scratchFixed = need.fixed;
+	plan->scratchPerChannel = need.perChannel;
+	plan->scratchDepth = need.depth;
+	return AZA_SUCCESS;
+}
+
+// Whatever happens is kept in plan->error until the chain is dirty again
+static int azaDSPPlanBuild(azaDSPPlan *plan, azaDSPData *head, int allocate) {
+	plan->error = azaDSPPlanBuildSteps(plan, head, allocate);
+	plan->dirty = 0;
+	return plan->error;
+}
+
+void azaDSPPlanInit(azaDSPPlan *plan) {
+	memset(plan, 0, sizeof(*plan));
+}
+
+void azaDSPPlanDeinit(azaDSPPlan *plan) {
+	free(plan->steps);
+	free(plan->nested);
+	memset(plan, 0, sizeof(*plan));
+}
+
+int azaDSPPlanCompile(azaDSPPlan *plan, azaDSPData *head) {
+	return azaDSPPlanBuild(plan, head, 1);
+}
+
+int azaDSPPlanRun(azaDSPPlan *plan, azaBuffer buffer) {
+	plan->silent = 0;
+	int err = azaCheckBuffer(buffer);
+	if (err) return err;
+	if AZA_UNLIKELY(plan->dirty) {
+		azaDSPPlanBuild(plan, plan->head, 0);
+	}
+	if AZA_UNLIKELY(plan->error) {
+		if (plan->error == AZA_ERROR_OUT_OF_MEMORY) {
+			// It's been validated, so the slow way is safe until azaDSPPlanCompile makes room
+			return azaDSP(buffer, plan->head);
+		}
+		return plan->error;
+	}
+	assert(azaDSPPlanMatches(plan) && "The chain was changed without setting plan->dirty");
+	size_t depth = sideBuffersInUse;
+	for (uint32_t i = 0; i < plan->count; i++) {
+		azaDSPPlanStep *step = &plan->steps[i];
+		err = azaDSPProcessNode(&azaDSPKinds[step->kind], &buffer, step->data);
+		if (err) break;
+	}
+	azaPopSideBuffersTo(depth);
+	plan->silent = buffer.silent && !err;
+	return err;
+}
+
+int azaDSPPlanReserveScratch(const azaDSPPlan *plan, size_t frames, size_t channels) {
+	size_t perFrame = plan->scratchFixed + plan->scratchPerChannel * channels;
+	if (perFrame == 0) return AZA_SUCCESS;
+	// Every side buffer can round up by as much as AZA_SCRATCH_ALIGN
+	return azaScratchReserve(frames * perFrame + AZA_SCRATCH_ALIGN * plan->scratchDepth, 1, 1);
+}
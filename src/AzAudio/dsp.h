@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+#include "fft.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -21,6 +23,44 @@ extern "C" {
 
 
 
+// Instruction sets the DSP kernels can be dispatched to
+typedef enum azaSIMDLevel {
+	AZA_SIMD_LEVEL_SCALAR=0,
+	AZA_SIMD_LEVEL_SSE2,
+	AZA_SIMD_LEVEL_AVX2,
+	AZA_SIMD_LEVEL_AVX512,
+	AZA_SIMD_LEVEL_NEON,
+} azaSIMDLevel;
+// The best level the running CPU supports
+azaSIMDLevel azaGetSIMDLevelSupported();
+// The level currently in use, chosen by azaInit
+azaSIMDLevel azaGetSIMDLevel();
+// Forces a specific level, such as AZA_SIMD_LEVEL_SCALAR for a reference result.
+// Returns AZA_ERROR_INVALID_CONFIGURATION if the CPU can't run it.
+int azaSetSIMDLevel(azaSIMDLevel level);
+
+// Sets the calling thread to flush denormals to zero (FTZ and DAZ on x86, FZ on ARM), so feedback fading out after a sound stops doesn't slow to a crawl.
+// Streams and the worker threads AzAudio starts do this themselves. Threads calling the DSP directly should do it too.
+// Returns the previous mode to give to azaFlushDenormalsEnd. CPUs without such a mode rely on the DSP flushing its own feedback states instead.
+uint32_t azaFlushDenormalsBegin();
+void azaFlushDenormalsEnd(uint32_t previous);
+
+// Accuracy of the dB/amplitude conversions done by the dynamics processors and sampler
+// Errors are the worst case measured against double precision over amplitudes 1e-7 to 100 and -140dB to +20dB
+typedef enum azaMathAccuracy {
+	// amp to dB within 0.005dB, dB to amp within 0.001dB
+	AZA_MATH_ACCURACY_LOW=0,
+	// amp to dB within 0.0001dB, dB to amp within 0.00001dB (default)
+	AZA_MATH_ACCURACY_MEDIUM,
+	// amp to dB within 0.00002dB, dB to amp within 0.00001dB, about what float allows (log10f is off by up to 0.00001dB)
+	AZA_MATH_ACCURACY_HIGH,
+	// Uses log10f and powf directly
+	AZA_MATH_ACCURACY_LIBM,
+} azaMathAccuracy;
+void azaSetMathAccuracy(azaMathAccuracy accuracy);
+azaMathAccuracy azaGetMathAccuracy();
+
+
 // Buffer used by DSP functions for their input/output
 typedef struct azaBuffer {
 	// actual read/write-able data
@@ -35,10 +75,18 @@ typedef struct azaBuffer {
 	size_t channels;
 	// samples per second, used by DSP functions that rely on timing
 	size_t samplerate;
+	// If not NULL, the buffer is planar (deinterleaved) and samples is ignored.
+	// Each channel c has its own samples at planes[c], with stride still being the distance between samples (usually 1).
+	float **planes;
+	// Set if every sample is known to be 0, which lets DSP whose tails have died out skip it.
+	// Leave it 0 if unsure, which is always safe.
+	int silent;
 } azaBuffer;
 // You must first set frames and channels before calling this to allocate samples.
 // If samples are externally-managed, you don't have to do this.
 int azaBufferInit(azaBuffer *data);
+// Same as azaBufferInit, but allocates a planar buffer
+int azaBufferInitPlanar(azaBuffer *data);
 int azaBufferDeinit(azaBuffer *data);
 
 // Mixes src into the existing contents of dst
@@ -47,6 +95,47 @@ void azaBufferMix(azaBuffer dst, float volumeDst, azaBuffer src, float volumeSrc
 // Copies the contents of one channel of src into dst
 void azaBufferCopyChannel(azaBuffer dst, size_t channelDst, azaBuffer src, size_t channelSrc);
 
+// Copies all the channels of src into dst, converting between interleaved and planar layouts as needed
+void azaBufferCopy(azaBuffer dst, azaBuffer src);
+
+// Returns a pointer to the first sample of the given channel, for either layout.
+// Subsequent samples are buffer.stride floats apart.
+static inline float* azaBufferChannelSamples(azaBuffer buffer, size_t channel) {
+	if (buffer.planes) {
+		return buffer.planes[channel];
+	} else {
+		return buffer.samples + channel;
+	}
+}
+
+// Returns a single-channel view into the given channel
+static inline azaBuffer azaBufferChannel(azaBuffer buffer, size_t channel) {
+	return (azaBuffer) {
+		.samples = azaBufferChannelSamples(buffer, channel),
+		.frames = buffer.frames,
+		.stride = buffer.stride,
+		.channels = 1,
+		.samplerate = buffer.samplerate,
+		.planes = NULL,
+	};
+}
+
+// Returns a view of frames frames of buffer from start.
+// Planar buffers need an array of buffer.channels pointers to hold the moved planes, which the view points into.
+static inline azaBuffer azaBufferSlice(azaBuffer buffer, size_t start, size_t frames, float **planes) {
+	buffer.frames = frames;
+	if (buffer.planes) {
+		for (size_t c = 0; c < buffer.channels; c++) {
+			planes[c] = buffer.planes[c] + start * buffer.stride;
+		}
+		buffer.planes = planes;
+		buffer.samples = planes[0];
+	} else {
+		buffer.samples += start * buffer.stride;
+	}
+	return buffer;
+}
+
 static inline azaBuffer azaBufferOneSample(float *sample, size_t samplerate) {
 	return (azaBuffer) {
 		.samples = sample,
@@ -54,6 +143,7 @@ static inline azaBuffer azaBufferOneSample(float *sample, size_t samplerate) {
 		.stride = 1,
 		.channels = 1,
 		.samplerate = samplerate,
+		.planes = NULL,
 	};
 }
 
@@ -68,24 +158,181 @@ typedef enum azaDSPKind {
 	AZA_DSP_REVERB,
 	AZA_DSP_SAMPLER,
 	AZA_DSP_GATE,
+	AZA_DSP_BIQUAD,
+	AZA_DSP_CONVOLUTION,
+	AZA_DSP_VOICE_POOL,
 } azaDSPKind;
 
+// Define AZAUDIO_PROFILE as 1 for the library and everything that includes it to time every DSP node as it runs.
+// Otherwise none of the timing gets compiled in and azaDSPProfileGet only gives zeroes.
+#ifndef AZAUDIO_PROFILE
+#define AZAUDIO_PROFILE 0
+#endif
+
+#if AZAUDIO_PROFILE
+// Running totals for one node, added to atomically by whichever thread runs it
+typedef struct azaDSPProfileCounters {
+	uint64_t calls;
+	uint64_t frames;
+	uint64_t ns;
+	// How long the buffers it ran on take to play
+	uint64_t bufferNs;
+	uint64_t minNs;
+	uint64_t maxNs;
+	// The highest ns / bufferNs of any one call, in millionths
+	uint64_t peakLoad;
+} azaDSPProfileCounters;
+#endif
+
+// How far tails have to decay below what went in before they count as finished
+#define AZAUDIO_TAIL_DB 100.0f
+
 // Generic interface to all the DSP datas
 typedef struct azaDSPData {
 	azaDSPKind kind;
 	uint32_t structSize;
 	struct azaDSPData *pNext;
+	// Frames of silent input processed in a row. Once it's past the tail, silent buffers are skipped entirely.
+	// Starts out at SIZE_MAX since freshly initialized state is already at rest.
+	size_t silentFrames;
+#if AZAUDIO_PROFILE
+	azaDSPProfileCounters profile;
+#endif
 } azaDSPData;
+// Runs data and everything chained after it through pNext.
+// If buffer.silent is set, anything that's had silent input for longer than its tail (delay echoes, reverb decay, filter ringing, envelopes) gets skipped.
 int azaDSP(azaBuffer buffer, azaDSPData *data);
+// Frames of silent input after which data would only output silence, and its state would be at rest, or SIZE_MAX if that never happens (like for samplers).
+// Includes any chains nested in it, but not what's after it through pNext.
+size_t azaDSPTail(azaDSPData *data, azaBuffer buffer);
+
+typedef int (*fp_azaDSPProcess)(azaBuffer buffer, azaDSPData *data);
+
+typedef struct azaDSPPlanStep {
+	azaDSPData *data;
+	// What data->kind was when compiled
+	azaDSPKind kind;
+	// Where the chains nested in data start in the plan's nested array, and how many nodes they have between them
+	uint32_t nestedStart;
+	uint32_t nestedCount;
+} azaDSPPlanStep;
+
+// A node of a nested chain (such as wetEffects) as it was when compiled, in the order they're walked, for debug builds to check against
+typedef struct azaDSPPlanNested {
+	azaDSPData *data;
+	azaDSPKind kind;
+	// How many chains deep it is, so the same nodes nested differently don't look the same
+	uint32_t depth;
+} azaDSPPlanNested;
+
+// A chain of DSP that's been checked once up front and flattened into an array, so running it is a loop over the nodes without checking them again.
+// Chains nested in a node (such as a delay's wetEffects) are checked and counted towards the scratch, but not flattened, since the node runs them itself
+// through azaDSP partway through its own processing.
+// After changing the nodes in the chain or any chain nested in it, set dirty so the next run compiles it again, which never allocates.
+// Debug builds assert that a chain that isn't dirty is still what was compiled.
+// If the new chain doesn't fit what was allocated, it runs the slow way until azaDSPPlanCompile is called again off the audio thread.
+typedef struct azaDSPPlan {
+	azaDSPData *head;
+	azaDSPPlanStep *steps;
+	uint32_t count;
+	uint32_t capacity;
+	azaDSPPlanNested *nested;
+	uint32_t nestedCount;
+	uint32_t nestedCapacity;
+	// Side buffer samples the chain needs per frame at most, as scratchFixed + scratchPerChannel * channels, over scratchDepth side buffers
+	uint32_t scratchFixed;
+	uint32_t scratchPerChannel;
+	uint32_t scratchDepth;
+	int dirty;
+	// What the last compile returned, so a chain that's invalid or doesn't fit isn't checked again every run until it's dirty
+	int error;
+	// Set if the output of the last azaDSPPlanRun is known to be silent, to pass on to whatever it feeds
+	int silent;
+} azaDSPPlan;
+void azaDSPPlanInit(azaDSPPlan *plan);
+void azaDSPPlanDeinit(azaDSPPlan *plan);
+// Checks head and every chain nested in it (wetEffects and activationEffects) for unknown kinds and loops, and flattens it into plan
+int azaDSPPlanCompile(azaDSPPlan *plan, azaDSPData *head);
+// To change the chain from the audio thread, set plan->head and plan->dirty and this will compile it without allocating.
+int azaDSPPlanRun(azaDSPPlan *plan, azaBuffer buffer);
+// Reserves the calling thread's scratch arena for running plan on buffers of up to frames frames of channels channels
+int azaDSPPlanReserveScratch(const azaDSPPlan *plan, size_t frames, size_t channels);
+
+typedef struct azaDSPProfile {
+	azaDSPKind kind;
+	uint64_t calls;
+	uint64_t frames;
+	// Nanoseconds per call
+	double minNs;
+	double avgNs;
+	double maxNs;
+	double nsPerFrame;
+	// Percent of the buffers' duration spent in the node overall, and in its worst call
+	double loadPercent;
+	double peakLoadPercent;
+} azaDSPProfile;
+// Stats for data alone rather than its whole chain, though they include chains nested in it like wetEffects.
+// Lock-free and safe to call from any thread while the DSP runs, but fields can come from either side of a call finishing.
+azaDSPProfile azaDSPProfileGet(const azaDSPData *data);
+// Starts the stats over. Every azaXDataInit does this.
+void azaDSPProfileReset(azaDSPData *data);
+
+// Side buffers used within the DSP functions come out of a scratch arena owned by each thread.
+// Reserve it up front on every thread that runs DSP and the audio thread never has to allocate.
+// Streams reserve AZAUDIO_SCRATCH_DEFAULT_DEPTH side buffers of their frames and channels (at least AZAUDIO_REVERB_LINES) in azaStreamInit,
+// and their thread adopts it before the first mix. Running out allocates anyway, which debug builds report.
+#define AZAUDIO_SCRATCH_DEFAULT_DEPTH 8
+// Makes room for depth nested side buffers of frames * channels samples on the calling thread. Must not be called from within DSP.
+int azaScratchReserve(size_t frames, size_t channels, size_t depth);
+// Frees the calling thread's arena
+void azaScratchFree();
+// A scratch arena that can be reserved on one thread and handed to the thread that runs the DSP,
+// for when that thread isn't ours to reserve on ahead of time (such as a backend's callback thread).
+typedef struct azaScratchBlock azaScratchBlock;
+// Allocates an arena like azaScratchReserve does, but for any thread. Returns NULL if out of memory.
+azaScratchBlock* azaScratchBlockReserve(size_t frames, size_t channels, size_t depth);
+// Makes block the calling thread's arena if it's bigger than what it has, without allocating or freeing anything. Must not be called from within DSP.
+// Returns whichever block the thread doesn't use (the old arena, or block itself), which the caller now owns and frees with azaScratchBlockFree off the audio thread.
+azaScratchBlock* azaScratchAdopt(azaScratchBlock *block);
+// Safe to call with NULL
+void azaScratchBlockFree(azaScratchBlock *block);
+typedef struct azaScratchStats {
+	// Samples reserved on the calling thread
+	size_t capacity;
+	// The most samples any one thread has had in use at once
+	size_t highWater;
+	// How many times a thread ran out and had to allocate, which should stay 0
+	size_t growths;
+} azaScratchStats;
+azaScratchStats azaScratchGetStats();
+void azaScratchResetStats();
 
 
 typedef struct azaRmsData {
 	azaDSPData header;
-	float squared;
-	float buffer[AZAUDIO_RMS_SAMPLES];
-	int index;
+	// The last windowSamples input samples, in a power of 2 ring
+	float *buffer;
+	uint32_t capacity;
+	uint32_t windowSamples;
+	uint32_t index;
+	// Running sum of the squares over the window, summed again from scratch once per window length
+	double squared;
+	uint32_t sinceResum;
+	// Progress through the current decimation period, and the values being interpolated between
+	uint32_t phase;
+	float from, to;
+	
+	// User configuration
+	
+	// length of the window in ms, 0 means AZAUDIO_RMS_SAMPLES samples
+	// Changing it clears the history
+	float window;
+	// If above 1, the RMS is only worked out once every decimation samples and linearly interpolated in between, lagging by decimation samples.
+	// Good for envelopes that only need to be at control rate.
+	uint32_t decimation;
 } azaRmsData;
 void azaRmsDataInit(azaRmsData *data);
+void azaRmsDataDeinit(azaRmsData *data);
 int azaRms(azaBuffer buffer, azaRmsData *data);
 
 
@@ -98,11 +345,17 @@ typedef enum azaFilterKind {
 typedef struct azaFilterData {
 	azaDSPData header;
 	float outputs[2];
+	// Coefficients are only recomputed when these change
+	float decays[2];
+	azaFilterKind kindCached;
+	float frequencyCached;
+	size_t samplerateCached;
 	
 	// User configuration
 	
 	azaFilterKind kind;
 	// Cutoff frequency in Hz
+	// For AZA_FILTER_BAND_PASS this is the center, and the band spans an octave either side
 	float frequency;
 	// Blends the effect output with the dry signal where 1 is fully dry and 0 is fully wet.
 	float dryMix;
@@ -112,16 +365,70 @@ int azaFilter(azaBuffer buffer, azaFilterData *data);
 
 
 
+#define AZAUDIO_BIQUAD_MAX_CHANNELS 8
+
+typedef enum azaBiquadKind {
+	AZA_BIQUAD_LOW_PASS,
+	AZA_BIQUAD_HIGH_PASS,
+	// Constant 0dB peak gain
+	AZA_BIQUAD_BAND_PASS,
+	AZA_BIQUAD_NOTCH,
+	AZA_BIQUAD_ALL_PASS,
+	AZA_BIQUAD_PEAKING,
+	AZA_BIQUAD_LOW_SHELF,
+	AZA_BIQUAD_HIGH_SHELF,
+} azaBiquadKind;
+
+// Unlike most DSP datas, a single azaBiquadData processes every channel in the buffer (up to AZAUDIO_BIQUAD_MAX_CHANNELS).
+// The channel states sit side by side so 2, 4 or 8 channels are filtered at once with SIMD.
+typedef struct azaBiquadData {
+	azaDSPData header;
+	// Transposed direct form II state
+	float z1[AZAUDIO_BIQUAD_MAX_CHANNELS];
+	float z2[AZAUDIO_BIQUAD_MAX_CHANNELS];
+	// b0, b1, b2, a1, a2 normalized so a0 is 1
+	float coefficients[5];
+	// Coefficients are only recomputed when these change
+	azaBiquadKind kindCached;
+	float frequencyCached;
+	float qCached;
+	float gainCached;
+	size_t samplerateCached;
+	
+	// User configuration
+	
+	azaBiquadKind kind;
+	// Cutoff or center frequency in Hz
+	float frequency;
+	// Resonance, leave at 0 for 1/sqrt(2) (Butterworth for the low and high passes)
+	float q;
+	// Gain in dB for AZA_BIQUAD_PEAKING, AZA_BIQUAD_LOW_SHELF and AZA_BIQUAD_HIGH_SHELF
+	float gain;
+} azaBiquadData;
+void azaBiquadDataInit(azaBiquadData *data);
+int azaBiquad(azaBuffer buffer, azaBiquadData *data);
+
+
+
 int azaCubicLimiter(azaBuffer buffer);
 
 
 
-// NOTE: This limiter increases latency by AZAUDIO_LOOKAHEAD_SAMPLES samples
+// NOTE: This limiter increases latency by the lookahead time
 typedef struct azaLookaheadLimiterData {
 	azaDSPData header;
-	float gainBuffer[AZAUDIO_LOOKAHEAD_SAMPLES];
-	float valBuffer[AZAUDIO_LOOKAHEAD_SAMPLES];
-	int index;
+	// One allocation holding the rings below, each with capacity entries (a power of 2)
+	// delayed input samples
+	float *valBuffer;
+	// sliding window maxima, averaged over the window for a smooth gain ramp
+	float *maxBuffer;
+	// monotonic deque of peaks in dB giving the sliding window maximum in O(1)
+	float *dequeValues;
+	uint32_t *dequeFrames;
+	uint32_t capacity;
+	uint32_t lookaheadSamples;
+	uint32_t frame;
+	uint32_t dequeFront, dequeBack;
 	float sum;
 	
 	// User configuration
@@ -130,8 +437,15 @@ typedef struct azaLookaheadLimiterData {
 	float gainInput;
 	// output gain in dB (should never peak higher than this)
 	float gainOutput;
+	// lookahead time in ms, 0 means AZAUDIO_LOOKAHEAD_SAMPLES samples
+	// Changing it clears the delayed signal
+	float lookahead;
+	// If nonzero in data[0], all channels get the same gain from the loudest one.
+	// The detector and configuration of data[0] are used for every channel.
+	int linked;
 } azaLookaheadLimiterData;
 void azaLookaheadLimiterDataInit(azaLookaheadLimiterData *data);
+void azaLookaheadLimiterDataDeinit(azaLookaheadLimiterData *data);
 int azaLookaheadLimiter(azaBuffer buffer, azaLookaheadLimiterData *data);
 
 
@@ -153,19 +467,33 @@ typedef struct azaCompressorData {
 	float attack;
 	// decay time in ms
 	float decay;
+	// If nonzero in data[0], all channels get the same gain from one envelope that follows the loudest of them.
+	// The detector and configuration of data[0] are used for every channel.
+	int linked;
 } azaCompressorData;
 void azaCompressorDataInit(azaCompressorData *data);
+void azaCompressorDataDeinit(azaCompressorData *data);
 int azaCompressor(azaBuffer buffer, azaCompressorData *data);
 
 
 
+// The samplerate azaDelayDataInit reserves for, so delayMax holds at any rate up to this one.
+// Higher rates get shorter delays unless azaDelayDataResize makes room.
+#define AZAUDIO_DELAY_RESERVE_SAMPLERATE 96000
+
 typedef struct azaDelayData {
 	azaDSPData header;
 	float *buffer; // Must be dynamically-allocated to allow different time spans
+	// Always a power of 2 so indices wrap with a mask
 	size_t capacity;
 	// Needs to be kept track of to handle the resizing of buffer gracefully
 	size_t delaySamples;
+	// Write position, only ever increases and gets masked by capacity-1
 	size_t index;
+	// Buffer from azaDelayDataResize waiting for the audio thread to swap it in
+	void *pending;
+	// Buffers the audio thread swapped out, freed by the next azaDelayDataResize or azaDelayDataDeinit
+	void *retired;
 	
 	// User configuration
 	
@@ -173,24 +501,55 @@ typedef struct azaDelayData {
 	float gain;
 	// dry gain in dB
 	float gainDry;
-	// delay time in ms
+	// delay time in ms, limited to what the buffer can hold
 	float delay;
+	// longest delay time in ms reserved by azaDelayDataInit, so the audio thread never has to allocate
+	// Only guaranteed at samplerates up to AZAUDIO_DELAY_RESERVE_SAMPLERATE, past which it's cut short in proportion
+	float delayMax;
 	// 0 to 1 multiple of output feeding back into input
 	float feedback;
 	// You can provide a chain of effects to operate on the wet output
 	azaDSPData *wetEffects;
 } azaDelayData;
+// Reserves max(delay, delayMax) at AZAUDIO_DELAY_RESERVE_SAMPLERATE
 void azaDelayDataInit(azaDelayData *data);
 void azaDelayDataDeinit(azaDelayData *data);
+// Call from any thread but the audio thread to make room for delayMax ms at samplerate.
+// The new buffer is swapped in by the next azaDelay call, keeping as much of the delayed signal as fits.
+// Not safe to call from multiple threads at once.
+int azaDelayDataResize(azaDelayData *data, float delayMax, size_t samplerate);
 int azaDelay(azaBuffer buffer, azaDelayData *data);
 
 
 
-#define AZAUDIO_REVERB_DELAY_COUNT 15
+#define AZAUDIO_REVERB_LINES 8
+// The samplerate azaReverbDataInit reserves for, so the lines and delayMax hold at any rate up to this one.
+// Higher rates get shorter lines, and shorter pre-delays unless azaReverbDataResize makes room.
+#define AZAUDIO_REVERB_RESERVE_SAMPLERATE 96000
+// Feedback delay network with one tank shared by every channel, so one azaReverbData handles the whole buffer.
+// Each channel hears the tank through a different row of the mixing matrix, keeping them decorrelated.
 typedef struct azaReverbData {
 	azaDSPData header;
-	azaDelayData delayDatas[AZAUDIO_REVERB_DELAY_COUNT];
-	azaFilterData filterDatas[AZAUDIO_REVERB_DELAY_COUNT];
+	// AZAUDIO_REVERB_LINES delay lines interleaved, capacity frames long
+	float *lines;
+	size_t capacity;
+	size_t index;
+	// Delays the input to the tank by the delay parameter, always a power of 2
+	float *preDelayBuffer;
+	size_t preDelayCapacity;
+	size_t preDelayIndex;
+	// Pre-delay buffer from azaReverbDataResize waiting for the audio thread to swap it in
+	void *preDelayPending;
+	// Pre-delay buffers the audio thread swapped out, freed by the next azaReverbDataResize or azaReverbDataDeinit
+	void *preDelayRetired;
+	// Per-line state, updated together by the reverb kernel
+	int32_t lineDelays[AZAUDIO_REVERB_LINES];
+	float lineGains[AZAUDIO_REVERB_LINES];
+	float lineDamping[AZAUDIO_REVERB_LINES];
+	float lineLowpass[AZAUDIO_REVERB_LINES];
+	float roomsizeCached;
+	float colorCached;
+	size_t samplerateCached;
 	
 	// User configuration
 	
@@ -202,20 +561,42 @@ typedef struct azaReverbData {
 	float roomsize;
 	// value affecting damping of high frequencies, roughly in the range of 1 to 5
 	float color;
-	// delay for first reflections in ms
+	// delay for first reflections in ms, limited to what the pre-delay buffer can hold
 	float delay;
+	// longest delay in ms reserved by azaReverbDataInit, so the audio thread never has to allocate
+	// Only guaranteed at samplerates up to AZAUDIO_REVERB_RESERVE_SAMPLERATE, past which it's cut short in proportion
+	float delayMax;
 } azaReverbData;
+// Reserves max(delay, delayMax) at AZAUDIO_REVERB_RESERVE_SAMPLERATE
 void azaReverbDataInit(azaReverbData *data);
 void azaReverbDataDeinit(azaReverbData *data);
+// Call from any thread but the audio thread to make room for a delay of delayMax ms at samplerate.
+// The new pre-delay buffer is swapped in by the next azaReverb call, keeping as much of the delayed input as fits.
+// Not safe to call from multiple threads at once.
+int azaReverbDataResize(azaReverbData *data, float delayMax, size_t samplerate);
 int azaReverb(azaBuffer buffer, azaReverbData *data);
 
 
 
+// Number of taps in the windowed-sinc kernels used to interpolate between samples when playing back at a different rate.
+// More taps means less aliasing and a flatter passband for more CPU time, which is the same at any playback speed.
+typedef enum azaResampleQuality {
+	// 8 taps
+	AZA_RESAMPLE_QUALITY_DEFAULT=0,
+	AZA_RESAMPLE_QUALITY_4=4,
+	AZA_RESAMPLE_QUALITY_8=8,
+	AZA_RESAMPLE_QUALITY_16=16,
+	AZA_RESAMPLE_QUALITY_32=32,
+} azaResampleQuality;
+
 typedef struct azaSamplerData {
 	azaDSPData header;
-	float frame;
+	// Playback position in source frames as 32.32 fixed point
+	uint64_t position;
 	float s; // Smooth speed
 	float g; // Smooth gain
+	// Set by azaSamplerDataInit from quality
+	const struct azaResampleTable *table;
 	
 	// User configuration
 	
@@ -225,6 +606,8 @@ typedef struct azaSamplerData {
 	float speed;
 	// volume of effect in dB
 	float gain;
+	// interpolation quality, only read by azaSamplerDataInit
+	azaResampleQuality quality;
 } azaSamplerData;
 int azaSamplerDataInit(azaSamplerData *data);
 int azaSampler(azaBuffer buffer, azaSamplerData *data);
@@ -247,12 +630,153 @@ typedef struct azaGateData {
 	float decay;
 	// Any effects to apply to the activation signal
 	azaDSPData *activationEffects;
+	// If nonzero in data[0], all channels get the same gain from one envelope that follows the loudest of them.
+	// The detector and configuration of data[0] are used for every channel, though each channel's activationEffects still apply to its own signal.
+	int linked;
 } azaGateData;
 void azaGateDataInit(azaGateData *data);
+void azaGateDataDeinit(azaGateData *data);
 int azaGate(azaBuffer buffer, azaGateData *data);
 
 
 
+#define AZAUDIO_CONVOLUTION_MAX_LEVELS 3
+// Partitions of one size within an azaConvolutionIR
+typedef struct azaConvolutionIRLevel {
+	// Length of each partition, which gets transformed at twice this size
+	uint32_t size;
+	// Where the first partition starts in the impulse response
+	uint32_t start;
+	uint32_t count;
+	// count spectra of size+1 complex bins
+	float *spectra;
+	azaFFT fft;
+} azaConvolutionIRLevel;
+
+// An impulse response prepared for azaConvolution.
+// The first partition is convolved directly so there's no latency, and the rest in the frequency domain with partitions that get 8 times longer for each level into the tail.
+// It's read-only once made, so any number of azaConvolutionData can share one.
+typedef struct azaConvolutionIR {
+	uint32_t partitionSize;
+	// The first partitionSize samples reversed
+	float *head;
+	uint32_t levelCount;
+	azaConvolutionIRLevel levels[AZAUDIO_CONVOLUTION_MAX_LEVELS];
+} azaConvolutionIR;
+// partitionSize is the length of the smallest partitions, a power of 2 from 16 to 512, or 0 for 64.
+// Smaller partitions cost more CPU, larger ones make the direct part more expensive.
+int azaConvolutionIRInit(azaConvolutionIR *data, const float *samples, size_t frames, uint32_t partitionSize);
+void azaConvolutionIRDeinit(azaConvolutionIR *data);
+
+typedef struct azaConvolutionLevel {
+	// Spectra of the last count blocks of input, the newest at fdlIndex
+	float *fdl;
+	uint32_t fdlIndex;
+	// Where the products of the spectra are summed
+	float *accum;
+	// Two partitions of input going in, and one partition of output coming out of the second half
+	float *time;
+	// Used by the background thread, nonzero while it owns time
+	int queued;
+	// Nonzero if time has output that still has to be added
+	int pending;
+} azaConvolutionLevel;
+
+typedef struct azaConvolutionData {
+	azaDSPData header;
+	// Input history, a power of 2 long
+	float *input;
+	size_t inputCapacity;
+	// Output of the partitioned levels, added ahead of time, a power of 2 long
+	float *output;
+	size_t outputCapacity;
+	// The last partitionSize-1 input samples followed by the current chunk, for the direct part
+	float *headHistory;
+	size_t frame;
+	azaConvolutionLevel levels[AZAUDIO_CONVOLUTION_MAX_LEVELS];
+	void *worker;
+	
+	// User configuration
+	
+	// Must be set before azaConvolutionDataInit and outlive this
+	const azaConvolutionIR *ir;
+	// effect gain in dB
+	float gain;
+	// dry gain in dB
+	float gainDry;
+	// If nonzero at init, the levels after the first are computed on a background thread, which gets a whole partition of time to finish each one
+	int threaded;
+} azaConvolutionData;
+int azaConvolutionDataInit(azaConvolutionData *data);
+void azaConvolutionDataDeinit(azaConvolutionData *data);
+int azaConvolution(azaBuffer buffer, azaConvolutionData *data);
+
+
+
+// Identifies one sound started by azaVoicePlay. Stays unique after the voice ends, so a stale handle won't touch whatever takes its slot.
+typedef uint32_t azaVoiceHandle;
+#define AZA_VOICE_INVALID 0
+#define AZAUDIO_VOICE_POOL_MAX_VOICES 65535
+
+// Plays many one-shot or looping sounds at once, mixing them all into the buffer it processes (adding to what's already there).
+// Voice state is kept as one array per field so the mixer only touches what it needs.
+// Voices are interpolated one at a time with the taps going across the SIMD registers. Putting voices across the registers instead didn't mix any more of them,
+// since every voice reads its own window and pair of rows wherever its phase lands, so the loads cost the same either way.
+// Play, stop, and the setters aren't thread-safe, so call them from the thread that processes the pool (or between calls).
+typedef struct azaVoicePoolData {
+	azaDSPData header;
+	// Playback position in source frames as 32.32 fixed point
+	uint64_t *position;
+	// Playback speed multiplier
+	float *pitch;
+	// Amplitude, converted from dB
+	float *amp;
+	// -1 is left, 1 is right, only used for mono sources on stereo buffers
+	float *pan;
+	// Per-channel gains the last block ended on, 2 per voice, ramped towards amp and pan over each block
+	float *mixGains;
+	const azaBuffer **source;
+	uint32_t *priority;
+	// Frame the voice started on, to steal the oldest first
+	uint64_t *started;
+	uint16_t *generation;
+	uint8_t *looping;
+	// Indices of playing voices, activeCount long, and where each voice is in there
+	uint32_t *active;
+	uint32_t *activeSlot;
+	uint32_t activeCount;
+	// Indices of free voices, freeCount long
+	uint32_t *free;
+	uint32_t freeCount;
+	uint64_t frame;
+	const struct azaResampleTable *table;
+	
+	// User configuration
+	
+	// How many voices can play at once, up to AZAUDIO_VOICE_POOL_MAX_VOICES, only read by azaVoicePoolDataInit
+	uint32_t capacity;
+	// interpolation quality, only read by azaVoicePoolDataInit
+	azaResampleQuality quality;
+	// volume of the whole pool in dB
+	float gain;
+} azaVoicePoolData;
+int azaVoicePoolDataInit(azaVoicePoolData *data);
+void azaVoicePoolDataDeinit(azaVoicePoolData *data);
+int azaVoicePool(azaBuffer buffer, azaVoicePoolData *data);
+// Starts playing source, which must outlive the voice, with gain in dB, pitch as a speed multiplier, and pan from -1 to 1.
+// If every voice is busy, steals the lowest priority voice (the oldest of those) as long as its priority isn't higher than this one's.
+// Returns AZA_VOICE_INVALID if nothing could be stolen.
+azaVoiceHandle azaVoicePlay(azaVoicePoolData *data, const azaBuffer *source, float gain, float pitch, float pan, uint32_t priority, int looping);
+// Returns nonzero if the voice is still playing
+int azaVoiceIsPlaying(azaVoicePoolData *data, azaVoiceHandle voice);
+void azaVoiceStop(azaVoicePoolData *data, azaVoiceHandle voice);
+// Changes to gain and pan are ramped over the next block, pitch changes are immediate
+void azaVoiceSetGain(azaVoicePoolData *data, azaVoiceHandle voice, float gain);
+void azaVoiceSetPitch(azaVoicePoolData *data, azaVoiceHandle voice, float pitch);
+void azaVoiceSetPan(azaVoicePoolData *data, azaVoiceHandle voice, float pan);
+
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -30,6 +30,10 @@ enum {
 	AZA_ERROR_INVALID_CONFIGURATION,
 	// A generic azaDSPData struct wasn't a valid kind
 	AZA_ERROR_INVALID_DSP_STRUCT,
+	// An allocation failed
+	AZA_ERROR_OUT_OF_MEMORY,
+	// A fixed-capacity queue had no room left
+	AZA_ERROR_QUEUE_FULL,
 };
 
 #ifdef __cplusplus
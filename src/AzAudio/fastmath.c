@@ -0,0 +1,90 @@
+/*
+	File: fastmath.c
+	Author: Philip Haynes
+*/
+
+#include "fastmath.h"
+
+#include "helpers.h"
+#include "simd.h"
+
+// Minimax fits of log2(1+t) and 2^t over [0, 1)
+static const azaFastMathCoefficients fastMathTiers[3] = {
+	// AZA_MATH_ACCURACY_LOW
+	{
+		.log = { 1.424593842e+00f, -5.892065983e-01f, 1.653837043e-01f },
+		.logDegree = 3,
+		.exp = { 6.951167871e-01f, 2.276449897e-01f, 7.706704289e-02f },
+		.expDegree = 3,
+	},
+	// AZA_MATH_ACCURACY_MEDIUM
+	{
+		.log = { 1.441965616e+00f, -7.096628106e-01f, 4.175957487e-01f, -1.962695931e-01f, 4.638534157e-02f },
+		.logDegree = 5,
+		.exp = { 6.931513118e-01f, 2.401644501e-01f, 5.579991331e-02f, 9.017030077e-03f, 1.867130170e-03f },
+		.expDegree = 5,
+	},
+	// AZA_MATH_ACCURACY_HIGH
+	{
+		.log = { 1.442667829e+00f, -7.205854682e-01f, 4.735534067e-01f, -3.259019596e-01f, 1.942943006e-01f, -7.955771440e-02f, 1.552991244e-02f },
+		.logDegree = 7,
+		.exp = { 6.931471843e-01f, 2.402264059e-01f, 5.550501766e-02f, 9.614299977e-03f, 1.341875247e-03f, 1.437922024e-04f, 2.142463167e-05f },
+		.expDegree = 7,
+	},
+};
+
+const azaFastMathCoefficients *azaFastMath = &fastMathTiers[AZA_MATH_ACCURACY_MEDIUM];
+static azaMathAccuracy mathAccuracy = AZA_MATH_ACCURACY_MEDIUM;
+
+void azaSetMathAccuracy(azaMathAccuracy accuracy) {
+	switch (accuracy) {
+		case AZA_MATH_ACCURACY_LOW:
+		case AZA_MATH_ACCURACY_MEDIUM:
+		case AZA_MATH_ACCURACY_HIGH:
+			azaFastMath = &fastMathTiers[accuracy];
+			break;
+		default:
+			accuracy = AZA_MATH_ACCURACY_LIBM;
+			azaFastMath = NULL;
+			break;
+	}
+	mathAccuracy = accuracy;
+}
+
+azaMathAccuracy azaGetMathAccuracy() {
+	return mathAccuracy;
+}
+
+float aza_fast_amp_to_dbf(float amp) {
+	if AZA_UNLIKELY(azaFastMath == NULL) {
+		return aza_amp_to_dbf(amp);
+	}
+	return aza_poly_log2f(amp, azaFastMath) * AZA_LOG2_TO_DB;
+}
+
+float aza_fast_db_to_ampf(float db) {
+	if AZA_UNLIKELY(azaFastMath == NULL) {
+		return aza_db_to_ampf(db);
+	}
+	return aza_poly_exp2f(db * AZA_DB_TO_LOG2, azaFastMath);
+}
+
+void aza_amp_to_db_block(float *dst, const float *src, size_t count) {
+	if AZA_UNLIKELY(azaFastMath == NULL) {
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = aza_amp_to_dbf(src[i]);
+		}
+		return;
+	}
+	azaKernel.ampToDb(dst, src, count, azaFastMath);
+}
+
+void aza_db_to_amp_block(float *dst, const float *src, size_t count) {
+	if AZA_UNLIKELY(azaFastMath == NULL) {
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = aza_db_to_ampf(src[i]);
+		}
+		return;
+	}
+	azaKernel.dbToAmp(dst, src, count, azaFastMath);
+}
@@ -0,0 +1,83 @@
+/*
+	File: fastmath.h
+	Author: Philip Haynes
+	Polynomial approximations of log2 and exp2 for converting between dB and amplitude in bulk. Not to be included in headers.
+*/
+
+#ifndef AZAUDIO_FASTMATH_H
+#define AZAUDIO_FASTMATH_H
+
+#include "dsp.h"
+
+#include <float.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AZA_FASTMATH_MAX_DEGREE 7
+
+// 20 * log10(2), converts log2 to dB
+#define AZA_LOG2_TO_DB 6.0205999132796239f
+// log2(10) / 20, converts dB to log2
+#define AZA_DB_TO_LOG2 0.1660964047443681f
+
+typedef struct azaFastMathCoefficients {
+	// log2(1+t) = t * (log[0] + t * (log[1] + t * ...)) for t in [0, 1)
+	float log[AZA_FASTMATH_MAX_DEGREE];
+	int logDegree;
+	// 2^t = 1 + t * (exp[0] + t * (exp[1] + t * ...)) for t in [0, 1)
+	float exp[AZA_FASTMATH_MAX_DEGREE];
+	int expDegree;
+} azaFastMathCoefficients;
+
+// Coefficients for the current azaMathAccuracy. NULL means we use libm.
+extern const azaFastMathCoefficients *azaFastMath;
+
+// Inputs at or below 0 (and NaNs) are treated as FLT_MIN, giving about -126
+static inline float aza_poly_log2f(float x, const azaFastMathCoefficients *k) {
+	union { float f; uint32_t i; } u;
+	u.f = x >= FLT_MIN ? x : FLT_MIN;
+	float e = (float)((int)(u.i >> 23) - 127);
+	u.i = (u.i & 0x007FFFFFu) | 0x3F800000u;
+	float t = u.f - 1.0f;
+	float p = k->log[k->logDegree-1];
+	for (int d = k->logDegree-2; d >= 0; d--) {
+		p = p * t + k->log[d];
+	}
+	return e + t * p;
+}
+
+// Inputs are clamped to [-126, 128)
+static inline float aza_poly_exp2f(float x, const azaFastMathCoefficients *k) {
+	// Written so NaNs end up at -126
+	if (!(x >= -126.0f)) x = -126.0f;
+	if (x > 127.999f) x = 127.999f;
+	int n = (int)x;
+	if ((float)n > x) n--;
+	float t = x - (float)n;
+	float p = k->exp[k->expDegree-1];
+	for (int d = k->expDegree-2; d >= 0; d--) {
+		p = p * t + k->exp[d];
+	}
+	union { float f; uint32_t i; } u;
+	u.f = 1.0f + t * p;
+	u.i += (uint32_t)n << 23;
+	return u.f;
+}
+
+// Scalar versions for loops that can't be done in blocks, respecting azaMathAccuracy
+float aza_fast_amp_to_dbf(float amp);
+float aza_fast_db_to_ampf(float db);
+
+// dst[i] = aza_amp_to_dbf(src[i]), dst may be src
+void aza_amp_to_db_block(float *dst, const float *src, size_t count);
+// dst[i] = aza_db_to_ampf(src[i]), dst may be src
+void aza_db_to_amp_block(float *dst, const float *src, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_FASTMATH_H
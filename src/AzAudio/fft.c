@@ -0,0 +1,194 @@
+/*
+	File: fft.c
+	Author: Philip Haynes
+*/
+
+#include "fft.h"
+
+#include "error.h"
+#include "helpers.h"
+#include "simd.h"
+
+int azaFFTInit(azaFFT *data, uint32_t size) {
+	if (size < AZAUDIO_FFT_MIN_SIZE || size > AZAUDIO_FFT_MAX_SIZE || (size & (size - 1))) {
+		AZA_PRINT_ERR("azaFFTInit error: size (%u) must be a power of 2 from %u to %u\n", size, AZAUDIO_FFT_MIN_SIZE, AZAUDIO_FFT_MAX_SIZE);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	uint32_t half = size / 2;
+	data->size = size;
+	data->bitReverse = malloc(sizeof(uint32_t) * half);
+	data->twiddles = malloc(sizeof(float) * half * 2);
+	data->twiddlesInverse = malloc(sizeof(float) * half * 2);
+	data->twiddlesReal = malloc(sizeof(float) * (half + 1) * 2);
+	if (!data->bitReverse || !data->twiddles || !data->twiddlesInverse || !data->twiddlesReal) {
+		azaFFTDeinit(data);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	uint32_t bits = 0;
+	while ((1u << bits) < half) bits++;
+	for (uint32_t i = 0; i < half; i++) {
+		uint32_t r = 0;
+		for (uint32_t b = 0; b < bits; b++) {
+			r |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		data->bitReverse[i] = r;
+	}
+	for (uint32_t pass = 1; pass < half; pass <<= 1) {
+		for (uint32_t j = 0; j < pass; j++) {
+			double angle = -3.14159265358979323846 * (double)j / (double)pass;
+			float *w = data->twiddles + (pass - 1 + j) * 2;
+			float *wInverse = data->twiddlesInverse + (pass - 1 + j) * 2;
+			w[0] = wInverse[0] = (float)cos(angle);
+			w[1] = (float)sin(angle);
+			wInverse[1] = -w[1];
+		}
+	}
+	for (uint32_t k = 0; k <= half; k++) {
+		double angle = -2.0 * 3.14159265358979323846 * (double)k / (double)size;
+		data->twiddlesReal[k*2+0] = (float)cos(angle);
+		data->twiddlesReal[k*2+1] = (float)sin(angle);
+	}
+	return AZA_SUCCESS;
+}
+
+void azaFFTDeinit(azaFFT *data) {
+	free(data->bitReverse);
+	free(data->twiddles);
+	free(data->twiddlesInverse);
+	free(data->twiddlesReal);
+	data->bitReverse = NULL;
+	data->twiddles = NULL;
+	data->twiddlesInverse = NULL;
+	data->twiddlesReal = NULL;
+}
+
+static void azaFFTBitReverseInPlace(const azaFFT *data, float *x) {
+	uint32_t half = data->size / 2;
+	for (uint32_t i = 0; i < half; i++) {
+		uint32_t r = data->bitReverse[i];
+		if (r > i) {
+			float re = x[i*2+0], im = x[i*2+1];
+			x[i*2+0] = x[r*2+0];
+			x[i*2+1] = x[r*2+1];
+			x[r*2+0] = re;
+			x[r*2+1] = im;
+		}
+	}
+}
+
+// In-place transform of size/2 complex values that have already been put in bit-reversed order
+// The first two passes are done together as radix-4 since their twiddles are trivial, the rest go to the SIMD kernels.
+static void azaFFTComplex(const azaFFT *data, float *x, int inverse) {
+	uint32_t count = data->size / 2;
+	// Forward multiplies by -i, inverse by i
+	float sign = inverse ? 1.0f : -1.0f;
+	for (uint32_t i = 0; i < count; i += 4) {
+		float *p = x + i * 2;
+		float t0r = p[0] + p[2], t0i = p[1] + p[3];
+		float t1r = p[0] - p[2], t1i = p[1] - p[3];
+		float t2r = p[4] + p[6], t2i = p[5] + p[7];
+		float t3r = -sign * (p[5] - p[7]), t3i = sign * (p[4] - p[6]);
+		p[0] = t0r + t2r; p[1] = t0i + t2i;
+		p[4] = t0r - t2r; p[5] = t0i - t2i;
+		p[2] = t1r + t3r; p[3] = t1i + t3i;
+		p[6] = t1r - t3r; p[7] = t1i - t3i;
+	}
+	const float *twiddles = inverse ? data->twiddlesInverse : data->twiddles;
+	for (uint32_t half = 4; half < count; half <<= 1) {
+		azaKernel.fftPass(x, count, half, twiddles + (half - 1) * 2);
+	}
+}
+
+// Untangles the spectra of the even and odd samples from the complex transform, working on bins k and half-k together
+static void azaFFTForwardFinish(const azaFFT *data, float *dst) {
+	uint32_t half = data->size / 2;
+	dst[half*2+0] = dst[0] - dst[1];
+	dst[half*2+1] = 0.0f;
+	dst[0] = dst[0] + dst[1];
+	dst[1] = 0.0f;
+	for (uint32_t k = 1; k <= half / 2; k++) {
+		float *a = dst + k * 2;
+		float *b = dst + (half - k) * 2;
+		// even = (Z[k] + conj(Z[half-k])) / 2, odd = (Z[k] - conj(Z[half-k])) / 2i
+		float evenR = 0.5f * (a[0] + b[0]), evenI = 0.5f * (a[1] - b[1]);
+		float oddR = 0.5f * (a[1] + b[1]), oddI = -0.5f * (a[0] - b[0]);
+		float wr = data->twiddlesReal[k*2+0], wi = data->twiddlesReal[k*2+1];
+		float tr = oddR * wr - oddI * wi, ti = oddR * wi + oddI * wr;
+		// X[k] = even + w^k odd, X[half-k] = conj(even - w^k odd)
+		a[0] = evenR + tr;
+		a[1] = evenI + ti;
+		b[0] = evenR - tr;
+		b[1] = -(evenI - ti);
+	}
+}
+
+// Rebuilds bins k and half-k of the half size complex spectrum from bins k and half-k of src, scaled for the inverse
+static inline void azaFFTInverseStart(const azaFFT *data, const float *src, uint32_t k, float z[2], float y[2]) {
+	uint32_t half = data->size / 2;
+	float scale = 1.0f / (float)half;
+	const float *a = src + k * 2;
+	const float *b = src + (half - k) * 2;
+	// even = (X[k] + conj(X[half-k])) / 2, odd = (X[k] - conj(X[half-k])) / (2 w^k)
+	float evenR = 0.5f * (a[0] + b[0]), evenI = 0.5f * (a[1] - b[1]);
+	float dr = 0.5f * (a[0] - b[0]), di = 0.5f * (a[1] + b[1]);
+	float wr = data->twiddlesReal[k*2+0], wi = -data->twiddlesReal[k*2+1];
+	float oddR = dr * wr - di * wi, oddI = dr * wi + di * wr;
+	// Z[k] = even + i*odd, Z[half-k] = conj(even) + i*conj(odd)
+	z[0] = (evenR - oddI) * scale;
+	z[1] = (evenI + oddR) * scale;
+	y[0] = (evenR + oddI) * scale;
+	y[1] = (oddR - evenI) * scale;
+}
+
+void azaFFTForward(const azaFFT *data, float *dst, const float *src) {
+	uint32_t half = data->size / 2;
+	// Treat the even samples as real and odd samples as imaginary parts of a half size complex transform
+	for (uint32_t i = 0; i < half; i++) {
+		uint32_t r = data->bitReverse[i];
+		dst[r*2+0] = src[i*2+0];
+		dst[r*2+1] = src[i*2+1];
+	}
+	azaFFTComplex(data, dst, 0);
+	azaFFTForwardFinish(data, dst);
+}
+
+void azaFFTForwardInPlace(const azaFFT *data, float *buffer) {
+	azaFFTBitReverseInPlace(data, buffer);
+	azaFFTComplex(data, buffer, 0);
+	azaFFTForwardFinish(data, buffer);
+}
+
+void azaFFTInverse(const azaFFT *data, float *dst, const float *src) {
+	uint32_t half = data->size / 2;
+	// Stores straight into bit-reversed order
+	for (uint32_t k = 0; k <= half / 2; k++) {
+		float z[2], y[2];
+		azaFFTInverseStart(data, src, k, z, y);
+		uint32_t r = data->bitReverse[k];
+		dst[r*2+0] = z[0];
+		dst[r*2+1] = z[1];
+		if (k != 0 && k != half - k) {
+			r = data->bitReverse[half - k];
+			dst[r*2+0] = y[0];
+			dst[r*2+1] = y[1];
+		}
+	}
+	azaFFTComplex(data, dst, 1);
+}
+
+void azaFFTInverseInPlace(const azaFFT *data, float *buffer) {
+	uint32_t half = data->size / 2;
+	// Both bins of a pair are read before either is written, so this works in place
+	for (uint32_t k = 0; k <= half / 2; k++) {
+		float z[2], y[2];
+		azaFFTInverseStart(data, buffer, k, z, y);
+		buffer[k*2+0] = z[0];
+		buffer[k*2+1] = z[1];
+		if (k != 0 && k != half - k) {
+			buffer[(half-k)*2+0] = y[0];
+			buffer[(half-k)*2+1] = y[1];
+		}
+	}
+	azaFFTBitReverseInPlace(data, buffer);
+	azaFFTComplex(data, buffer, 1);
+}
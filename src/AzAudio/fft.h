@@ -0,0 +1,52 @@
+/*
+	File: fft.h
+	Author: Philip Haynes
+	Real-valued fast fourier transforms for power of two sizes.
+*/
+
+#ifndef AZAUDIO_FFT_H
+#define AZAUDIO_FFT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AZAUDIO_FFT_MIN_SIZE 32
+#define AZAUDIO_FFT_MAX_SIZE 65536
+
+// Precomputed tables for transforms of one size, read-only once made so it can be shared between threads.
+typedef struct azaFFT {
+	// Number of real samples, a power of 2 from AZAUDIO_FFT_MIN_SIZE to AZAUDIO_FFT_MAX_SIZE
+	uint32_t size;
+	// Index reversal table for the size/2 complex transform underneath
+	uint32_t *bitReverse;
+	// Twiddles for each radix-2 pass of the complex transform, laid out so every pass reads them in order.
+	// The pass combining pairs of length half starts at index half-1. Interleaved real and imaginary.
+	float *twiddles;
+	// Conjugates of twiddles, for inverse transforms
+	float *twiddlesInverse;
+	// exp(-2*pi*i*k/size) for k in [0, size/2], interleaved real and imaginary
+	float *twiddlesReal;
+} azaFFT;
+int azaFFTInit(azaFFT *data, uint32_t size);
+void azaFFTDeinit(azaFFT *data);
+
+// Spectra are size/2+1 complex bins from DC to nyquist, interleaved real and imaginary, so size+2 floats long.
+// Forward transforms are unscaled, inverse transforms are scaled by 1/size so a round trip gives back the input.
+
+// dst is size+2 floats, src is size floats
+void azaFFTForward(const azaFFT *data, float *dst, const float *src);
+// dst is size floats, src is size+2 floats
+void azaFFTInverse(const azaFFT *data, float *dst, const float *src);
+// buffer is size+2 floats with the samples in the first size, and gets replaced by the spectrum
+void azaFFTForwardInPlace(const azaFFT *data, float *buffer);
+// buffer is size+2 floats holding a spectrum, and gets replaced by size samples
+void azaFFTInverseInPlace(const azaFFT *data, float *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_FFT_H
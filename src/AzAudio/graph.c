@@ -0,0 +1,473 @@
+/*
+	File: graph.c
+	Author: Philip Haynes
+*/
+
+#include "graph.h"
+
+#include "error.h"
+#include "helpers.h"
+#include "simd.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+
+#define AZA_GRAPH_NONE UINT32_MAX
+// How many times an idle thread checks for work before it starts yielding
+#define AZAUDIO_GRAPH_SPINS 256
+
+// Chase-Lev deque. The owning thread pushes and pops at the bottom while the others steal from the top.
+// Every node is pushed at most once per block, so it never has to hold more than every node at once and never grows.
+typedef struct azaGraphQueue {
+	_Alignas(64) int64_t top;
+	_Alignas(64) int64_t bottom;
+	_Alignas(64) uint32_t *items;
+	uint32_t mask;
+} azaGraphQueue;
+
+typedef struct azaGraphWorker {
+	pthread_t thread;
+	sem_t wake;
+	int quit;
+	uint32_t queue;
+	azaGraph *graph;
+} azaGraphWorker;
+
+static void azaGraphQueuePush(azaGraphQueue *queue, uint32_t node) {
+	int64_t bottom = __atomic_load_n(&queue->bottom, __ATOMIC_RELAXED);
+	__atomic_store_n(&queue->items[bottom & queue->mask], node, __ATOMIC_RELAXED);
+	__atomic_store_n(&queue->bottom, bottom + 1, __ATOMIC_RELEASE);
+}
+
+static uint32_t azaGraphQueuePop(azaGraphQueue *queue) {
+	int64_t bottom = __atomic_load_n(&queue->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&queue->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t top = __atomic_load_n(&queue->top, __ATOMIC_RELAXED);
+	if (top > bottom) {
+		__atomic_store_n(&queue->bottom, bottom + 1, __ATOMIC_RELAXED);
+		return AZA_GRAPH_NONE;
+	}
+	uint32_t node = __atomic_load_n(&queue->items[bottom & queue->mask], __ATOMIC_RELAXED);
+	if (top == bottom) {
+		// The last one, which a thief might be taking at the same time
+		if (!__atomic_compare_exchange_n(&queue->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+			node = AZA_GRAPH_NONE;
+		}
+		__atomic_store_n(&queue->bottom, bottom + 1, __ATOMIC_RELAXED);
+	}
+	return node;
+}
+
+static uint32_t azaGraphQueueSteal(azaGraphQueue *queue) {
+	int64_t top = __atomic_load_n(&queue->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	int64_t bottom = __atomic_load_n(&queue->bottom, __ATOMIC_ACQUIRE);
+	if (top >= bottom) return AZA_GRAPH_NONE;
+	uint32_t node = __atomic_load_n(&queue->items[top & queue->mask], __ATOMIC_RELAXED);
+	if (!__atomic_compare_exchange_n(&queue->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+		return AZA_GRAPH_NONE;
+	}
+	return node;
+}
+
+static inline void azaGraphRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static thread_local const azaGraph *scratchGraph = NULL;
+static thread_local uint32_t scratchGeneration = 0;
+
+// Makes sure the calling thread's scratch arena fits every node's effects, so nothing allocates while processing
+static void azaGraphReserveScratch(azaGraph *graph) {
+	if AZA_LIKELY(scratchGraph == graph && scratchGeneration == graph->scratchGeneration) return;
+	for (uint32_t i = 0; i < graph->nodeCount; i++) {
+		azaDSPPlanReserveScratch(&graph->nodes[i].plan, graph->maxFrames, graph->channels);
+	}
+	scratchGraph = graph;
+	scratchGeneration = graph->scratchGeneration;
+}
+
+static void azaGraphRunNode(azaGraph *graph, uint32_t index, azaGraphQueue *queue) {
+	azaGraphNode *node = &graph->nodes[index];
+	size_t count = graph->frames * graph->channels;
+	azaBuffer buffer = {
+		.samples = node->samples,
+		.frames = graph->frames,
+		.stride = graph->channels,
+		.channels = graph->channels,
+		.samplerate = graph->samplerate,
+		.planes = NULL,
+	};
+	// Every input has finished, so they can be read without any locking
+	memset(node->samples, 0, sizeof(float) * count);
+	buffer.silent = 1;
+	for (uint32_t i = 0; i < node->inputCount; i++) {
+		const azaGraphSend *send = &graph->sends[graph->inputs[node->inputStart + i]];
+		const azaGraphNode *src = &graph->nodes[send->src];
+		if (src->silent) continue;
+		azaKernel.mix(node->samples, 1.0f, src->samples, send->amp, count);
+		buffer.silent = 0;
+	}
+	int err = AZA_SUCCESS;
+	if (node->callback) {
+		buffer.silent = 0;
+		err = node->callback(buffer, node->userData);
+	}
+	if (!err && node->effects) {
+		if AZA_UNLIKELY(node->plan.head != node->effects || node->effectsChanged) {
+			// Compiled by the run without allocating, or run the slow way until azaGraphCompile
+			node->plan.head = node->effects;
+			node->plan.dirty = 1;
+			node->effectsChanged = 0;
+		}
+		if (!err) err = azaDSPPlanRun(&node->plan, buffer);
+		buffer.silent = node->plan.silent;
+	}
+	node->silent = buffer.silent && !err;
+	if (err) {
+		// Only the first error is kept, and the rest of the graph still runs so the joins all finish
+		int expected = AZA_SUCCESS;
+		__atomic_compare_exchange_n(&graph->error, &expected, err, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+	}
+	// Whoever finishes the last input of a node gets to run it
+	for (uint32_t i = 0; i < node->outputCount; i++) {
+		uint32_t dst = graph->outputs[node->outputStart + i];
+		if (__atomic_sub_fetch(&graph->nodes[dst].pending, 1, __ATOMIC_ACQ_REL) == 0) {
+			azaGraphQueuePush(queue, dst);
+		}
+	}
+	__atomic_add_fetch(&graph->done, 1, __ATOMIC_RELEASE);
+}
+
+// Runs nodes from our own queue, stealing from the others when it runs dry, until every node of the block is done
+static void azaGraphWork(azaGraph *graph, uint32_t self, uint32_t generation) {
+	azaGraphQueue *queue = &graph->queues[self];
+	uint32_t queueCount = graph->workerCount + 1;
+	uint32_t victim = self;
+	uint32_t idle = 0;
+	while (__atomic_load_n(&graph->done, __ATOMIC_ACQUIRE) < graph->nodeCount && __atomic_load_n(&graph->generation, __ATOMIC_ACQUIRE) == generation) {
+		uint32_t node = azaGraphQueuePop(queue);
+		for (uint32_t i = 1; node == AZA_GRAPH_NONE && i < queueCount; i++) {
+			victim = (victim + 1) % queueCount;
+			if (victim == self) victim = (victim + 1) % queueCount;
+			node = azaGraphQueueSteal(&graph->queues[victim]);
+		}
+		if (node == AZA_GRAPH_NONE) {
+			// Whatever's left is already running somewhere. Spinning is the quickest way to notice when it's done,
+			// but if it takes a while we yield in case the thread running it is waiting on this core.
+			if (++idle < AZAUDIO_GRAPH_SPINS) {
+				azaGraphRelax();
+			} else {
+				sched_yield();
+			}
+			continue;
+		}
+		idle = 0;
+		azaGraphRunNode(graph, node, queue);
+	}
+}
+
+static void* azaGraphWorkerProc(void *userData) {
+	azaGraphWorker *worker = userData;
+	azaGraph *graph = worker->graph;
+	azaFlushDenormalsBegin();
+	while (1) {
+		sem_wait(&worker->wake);
+		if (__atomic_load_n(&worker->quit, __ATOMIC_ACQUIRE)) break;
+		uint32_t generation = __atomic_load_n(&graph->generation, __ATOMIC_ACQUIRE);
+		azaGraphReserveScratch(graph);
+		azaGraphWork(graph, worker->queue, generation);
+	}
+	azaScratchFree();
+	return NULL;
+}
+
+static void azaGraphStopWorkers(azaGraph *graph) {
+	for (uint32_t i = 0; i < graph->workerCount; i++) {
+		azaGraphWorker *worker = &graph->workers[i];
+		__atomic_store_n(&worker->quit, 1, __ATOMIC_RELEASE);
+		sem_post(&worker->wake);
+		pthread_join(worker->thread, NULL);
+		sem_destroy(&worker->wake);
+	}
+	graph->workerCount = 0;
+}
+
+int azaGraphInit(azaGraph *graph, size_t channels, size_t maxFrames, uint32_t workers) {
+	memset(graph, 0, sizeof(*graph));
+	if (channels < 1 || channels > AZAUDIO_GRAPH_MAX_CHANNELS) {
+		AZA_PRINT_ERR("azaGraphInit error: channels (%zu) must be from 1 to %u\n", channels, AZAUDIO_GRAPH_MAX_CHANNELS);
+		return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	}
+	if (maxFrames < 1) {
+		return AZA_ERROR_INVALID_FRAME_COUNT;
+	}
+	if (workers > AZAUDIO_GRAPH_MAX_WORKERS) {
+		AZA_PRINT_ERR("azaGraphInit error: workers (%u) can't be more than %u\n", workers, AZAUDIO_GRAPH_MAX_WORKERS);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	graph->channels = channels;
+	graph->maxFrames = maxFrames;
+	graph->queues = aligned_alloc(64, sizeof(azaGraphQueue) * (workers + 1));
+	graph->workers = malloc(sizeof(azaGraphWorker) * AZA_MAX(workers, 1));
+	if (!graph->queues || !graph->workers) {
+		azaGraphDeinit(graph);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	memset(graph->queues, 0, sizeof(azaGraphQueue) * (workers + 1));
+	for (uint32_t i = 0; i < workers; i++) {
+		azaGraphWorker *worker = &graph->workers[i];
+		worker->quit = 0;
+		worker->queue = i + 1;
+		worker->graph = graph;
+		sem_init(&worker->wake, 0, 0);
+		int err = pthread_create(&worker->thread, NULL, azaGraphWorkerProc, worker);
+		if (err) {
+			// Without any attributes, the only way this fails is the system running out of threads or memory for them (EAGAIN)
+			AZA_PRINT_ERR("azaGraphInit error: failed to start worker %u of %u (%s)\n", i, workers, strerror(err));
+			sem_destroy(&worker->wake);
+			azaGraphDeinit(graph);
+			return AZA_ERROR_OUT_OF_MEMORY;
+		}
+		graph->workerCount = i + 1;
+	}
+	return AZA_SUCCESS;
+}
+
+// Frees everything azaGraphCompile makes
+static void azaGraphFreeCompiled(azaGraph *graph) {
+	free(graph->inputs);
+	free(graph->outputs);
+	free(graph->roots);
+	free(graph->samples);
+	graph->inputs = NULL;
+	graph->outputs = NULL;
+	graph->roots = NULL;
+	graph->samples = NULL;
+	if (graph->queues) {
+		for (uint32_t i = 0; i <= graph->workerCount; i++) {
+			free(graph->queues[i].items);
+			graph->queues[i].items = NULL;
+		}
+	}
+	graph->compiled = 0;
+}
+
+void azaGraphDeinit(azaGraph *graph) {
+	azaGraphFreeCompiled(graph);
+	azaGraphStopWorkers(graph);
+	for (uint32_t i = 0; i < graph->nodeCount; i++) {
+		azaDSPPlanDeinit(&graph->nodes[i].plan);
+	}
+	free(graph->nodes);
+	free(graph->sends);
+	free(graph->queues);
+	free(graph->workers);
+	graph->nodes = NULL;
+	graph->sends = NULL;
+	graph->queues = NULL;
+	graph->workers = NULL;
+	graph->nodeCount = graph->nodeCapacity = 0;
+	graph->sendCount = graph->sendCapacity = 0;
+}
+
+int azaGraphAddNode(azaGraph *graph, fp_azaGraphNodeCallback callback, void *userData, azaDSPData *effects, uint32_t *index) {
+	if (graph->nodeCount == graph->nodeCapacity) {
+		uint32_t capacity = AZA_MAX(graph->nodeCapacity * 2, 16);
+		azaGraphNode *nodes = realloc(graph->nodes, sizeof(azaGraphNode) * capacity);
+		if (!nodes) return AZA_ERROR_OUT_OF_MEMORY;
+		graph->nodes = nodes;
+		graph->nodeCapacity = capacity;
+	}
+	azaGraphNode *node = &graph->nodes[graph->nodeCount];
+	memset(node, 0, sizeof(*node));
+	azaDSPPlanInit(&node->plan);
+	node->callback = callback;
+	node->userData = userData;
+	node->effects = effects;
+	if (index) *index = graph->nodeCount;
+	graph->nodeCount++;
+	graph->compiled = 0;
+	return AZA_SUCCESS;
+}
+
+int azaGraphAddSend(azaGraph *graph, uint32_t src, uint32_t dst, float gain) {
+	if (src >= graph->nodeCount || dst >= graph->nodeCount || src == dst) {
+		AZA_PRINT_ERR("azaGraphAddSend error: can't send from node %u to node %u with %u nodes\n", src, dst, graph->nodeCount);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	if (graph->sendCount == graph->sendCapacity) {
+		uint32_t capacity = AZA_MAX(graph->sendCapacity * 2, 16);
+		azaGraphSend *sends = realloc(graph->sends, sizeof(azaGraphSend) * capacity);
+		if (!sends) return AZA_ERROR_OUT_OF_MEMORY;
+		graph->sends = sends;
+		graph->sendCapacity = capacity;
+	}
+	graph->sends[graph->sendCount++] = (azaGraphSend) {
+		.src = src,
+		.dst = dst,
+		.gain = gain,
+	};
+	graph->compiled = 0;
+	return AZA_SUCCESS;
+}
+
+int azaGraphCompile(azaGraph *graph) {
+	azaGraphFreeCompiled(graph);
+	uint32_t nodeCount = graph->nodeCount;
+	if (graph->output >= nodeCount) {
+		AZA_PRINT_ERR("azaGraphCompile error: output (%u) isn't one of the %u nodes\n", graph->output, nodeCount);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	// Each node's samples start on a 64 byte boundary so no two nodes share a cache line
+	size_t nodeSamples = (graph->maxFrames * graph->channels + 15) & ~(size_t)15;
+	uint32_t *order = malloc(sizeof(uint32_t) * nodeCount);
+	graph->inputs = malloc(sizeof(uint32_t) * AZA_MAX(graph->sendCount, 1));
+	graph->outputs = malloc(sizeof(uint32_t) * AZA_MAX(graph->sendCount, 1));
+	graph->roots = malloc(sizeof(uint32_t) * nodeCount);
+	graph->samples = aligned_alloc(64, sizeof(float) * nodeSamples * nodeCount);
+	uint32_t queueCapacity = (uint32_t)aza_next_pow2(nodeCount);
+	int outOfMemory = !order || !graph->inputs || !graph->outputs || !graph->roots || !graph->samples;
+	for (uint32_t i = 0; i <= graph->workerCount && !outOfMemory; i++) {
+		azaGraphQueue *queue = &graph->queues[i];
+		queue->items = malloc(sizeof(uint32_t) * queueCapacity);
+		queue->mask = queueCapacity - 1;
+		if (!queue->items) outOfMemory = 1;
+	}
+	if (outOfMemory) {
+		free(order);
+		azaGraphFreeCompiled(graph);
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	// Sends grouped by destination for reading inputs, and by source for counting down joins
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		azaGraphNode *node = &graph->nodes[i];
+		node->inputCount = 0;
+		node->outputCount = 0;
+		node->samples = graph->samples + nodeSamples * i;
+	}
+	for (uint32_t s = 0; s < graph->sendCount; s++) {
+		azaGraphSend *send = &graph->sends[s];
+		send->amp = aza_db_to_ampf(send->gain);
+		graph->nodes[send->dst].inputCount++;
+		graph->nodes[send->src].outputCount++;
+	}
+	uint32_t inputStart = 0, outputStart = 0;
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		azaGraphNode *node = &graph->nodes[i];
+		node->inputStart = inputStart;
+		node->outputStart = outputStart;
+		inputStart += node->inputCount;
+		outputStart += node->outputCount;
+		node->inputCount = 0;
+		node->outputCount = 0;
+	}
+	for (uint32_t s = 0; s < graph->sendCount; s++) {
+		azaGraphSend *send = &graph->sends[s];
+		azaGraphNode *dst = &graph->nodes[send->dst];
+		azaGraphNode *src = &graph->nodes[send->src];
+		graph->inputs[dst->inputStart + dst->inputCount++] = s;
+		graph->outputs[src->outputStart + src->outputCount++] = send->dst;
+	}
+	// Runs through the graph in dependency order the same way processing will, so any nodes never reached are in a loop
+	uint32_t orderCount = 0;
+	graph->rootCount = 0;
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		azaGraphNode *node = &graph->nodes[i];
+		node->pending = node->inputCount;
+		if (node->inputCount == 0) {
+			graph->roots[graph->rootCount++] = i;
+			order[orderCount++] = i;
+		}
+	}
+	for (uint32_t o = 0; o < orderCount; o++) {
+		azaGraphNode *node = &graph->nodes[order[o]];
+		for (uint32_t i = 0; i < node->outputCount; i++) {
+			uint32_t dst = graph->outputs[node->outputStart + i];
+			if (--graph->nodes[dst].pending == 0) {
+				order[orderCount++] = dst;
+			}
+		}
+	}
+	free(order);
+	if (orderCount < nodeCount) {
+		AZA_PRINT_ERR("azaGraphCompile error: the sends make a loop\n");
+		azaGraphFreeCompiled(graph);
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		azaGraphNode *node = &graph->nodes[i];
+		int err = azaDSPPlanCompile(&node->plan, node->effects);
+		node->effectsChanged = 0;
+		if (err) {
+			azaGraphFreeCompiled(graph);
+			return err;
+		}
+	}
+	graph->scratchGeneration++;
+	graph->compiled = 1;
+	return AZA_SUCCESS;
+}
+
+int azaGraphProcess(azaGraph *graph, azaBuffer buffer) {
+	if (!graph->compiled) {
+		AZA_PRINT_ERR("azaGraphProcess error: the graph hasn't been compiled since it was changed\n");
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	if (buffer.samples == NULL && buffer.planes == NULL) {
+		return AZA_ERROR_NULL_POINTER;
+	}
+	if (buffer.channels != graph->channels) {
+		return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	}
+	azaGraphReserveScratch(graph);
+	float *planes[AZAUDIO_GRAPH_MAX_CHANNELS];
+	for (size_t start = 0; start < buffer.frames; start += graph->maxFrames) {
+		size_t frames = AZA_MIN(buffer.frames - start, graph->maxFrames);
+		graph->frames = frames;
+		graph->samplerate = buffer.samplerate;
+		graph->error = AZA_SUCCESS;
+		for (uint32_t i = 0; i < graph->nodeCount; i++) {
+			graph->nodes[i].pending = graph->nodes[i].inputCount;
+		}
+		__atomic_store_n(&graph->done, 0, __ATOMIC_RELAXED);
+		uint32_t generation = __atomic_add_fetch(&graph->generation, 1, __ATOMIC_RELEASE);
+		for (uint32_t i = 0; i < graph->rootCount; i++) {
+			azaGraphQueuePush(&graph->queues[0], graph->roots[i]);
+		}
+		for (uint32_t i = 0; i < graph->workerCount; i++) {
+			sem_post(&graph->workers[i].wake);
+		}
+		// Returns once every node is done, including any still running on the workers
+		azaGraphWork(graph, 0, generation);
+
+		azaBuffer dst = buffer;
+		dst.frames = frames;
+		if (buffer.planes) {
+			for (size_t c = 0; c < buffer.channels; c++) {
+				planes[c] = buffer.planes[c] + start * buffer.stride;
+			}
+			dst.planes = planes;
+			dst.samples = planes[0];
+		} else {
+			dst.samples += start * buffer.stride;
+		}
+		azaBufferCopy(dst, (azaBuffer) {
+			.samples = graph->nodes[graph->output].samples,
+			.frames = frames,
+			.stride = graph->channels,
+			.channels = graph->channels,
+			.samplerate = buffer.samplerate,
+			.planes = NULL,
+		});
+		if (graph->error) return graph->error;
+	}
+	return AZA_SUCCESS;
+}
@@ -0,0 +1,122 @@
+/*
+	File: graph.h
+	Author: Philip Haynes
+	A graph of buses that mix into each other, with independent branches spread over a pool of worker threads.
+*/
+
+#ifndef AZAUDIO_GRAPH_H
+#define AZAUDIO_GRAPH_H
+
+#include "dsp.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AZAUDIO_GRAPH_MAX_WORKERS 64
+#define AZAUDIO_GRAPH_MAX_CHANNELS 64
+
+typedef int (*fp_azaGraphNodeCallback)(azaBuffer buffer, void *userData);
+
+typedef struct azaGraphNode {
+	// Everything in here is managed by the graph other than the user configuration
+	azaDSPPlan plan;
+	// maxFrames frames of the graph's channels, interleaved
+	float *samples;
+	// Where this node's sends start in the graph's inputs, and how many there are
+	uint32_t inputStart;
+	uint32_t inputCount;
+	// Where the nodes this one sends to start in the graph's outputs, and how many there are
+	uint32_t outputStart;
+	uint32_t outputCount;
+	// Inputs that have yet to finish this block, counted down by whoever finishes them
+	uint32_t pending;
+	// Set if the node's output this block is known to be silent, so whatever it sends to can skip mixing it
+	int silent;
+
+	// User configuration
+
+	// Called with the node's buffer holding the sum of its inputs, silent if it has none, may be NULL.
+	// Nodes with a callback are never treated as silent, since there's no telling what it wrote.
+	fp_azaGraphNodeCallback callback;
+	void *userData;
+	// Run on the node's buffer after the callback, may be NULL
+	azaDSPData *effects;
+	// Set after changing the nodes in effects (or the chains nested in them) in place, so the node compiles its chain again. Cleared once it has.
+	// Pointing effects at another chain is noticed without it.
+	int effectsChanged;
+} azaGraphNode;
+
+// Mixes src into dst by gain (in dB) once src has run its effects
+typedef struct azaGraphSend {
+	uint32_t src;
+	uint32_t dst;
+	float gain;
+	// gain as an amplitude, set by azaGraphCompile
+	float amp;
+} azaGraphSend;
+
+struct azaGraphWorker;
+struct azaGraphQueue;
+
+typedef struct azaGraph {
+	azaGraphNode *nodes;
+	uint32_t nodeCount;
+	uint32_t nodeCapacity;
+	azaGraphSend *sends;
+	uint32_t sendCount;
+	uint32_t sendCapacity;
+	// Built by azaGraphCompile. Indices of sends by destination, and destination nodes by source.
+	uint32_t *inputs;
+	uint32_t *outputs;
+	// Nodes with no inputs, which start every block
+	uint32_t *roots;
+	uint32_t rootCount;
+	// One work-stealing queue per thread, where [0] belongs to whoever calls azaGraphProcess
+	struct azaGraphQueue *queues;
+	struct azaGraphWorker *workers;
+	uint32_t workerCount;
+	float *samples;
+	size_t channels;
+	size_t maxFrames;
+	// The block being processed
+	size_t frames;
+	size_t samplerate;
+	uint32_t generation;
+	uint32_t done;
+	// The first error any node gave this block
+	int error;
+	// Bumped whenever the threads need to reserve their scratch arenas again
+	uint32_t scratchGeneration;
+	int compiled;
+
+	// User configuration
+
+	// The node whose buffer azaGraphProcess outputs, which is the first one added unless changed
+	uint32_t output;
+} azaGraph;
+
+// Every node has channels channels and processes up to maxFrames at a time.
+// workers is the number of threads to start on top of the one calling azaGraphProcess, which always helps out.
+// They take on the scheduling policy and priority of the thread calling azaGraphInit, so call it from the audio thread (or one set up like it)
+// if the workers should be real-time too. Workers with a higher priority than the thread calling azaGraphProcess can starve it.
+int azaGraphInit(azaGraph *graph, size_t channels, size_t maxFrames, uint32_t workers);
+void azaGraphDeinit(azaGraph *graph);
+// Nodes and sends can only be added while azaGraphProcess isn't running, after which the graph must be compiled again.
+// Writes the new node's index to index, which stays valid for the life of the graph.
+int azaGraphAddNode(azaGraph *graph, fp_azaGraphNodeCallback callback, void *userData, azaDSPData *effects, uint32_t *index);
+int azaGraphAddSend(azaGraph *graph, uint32_t src, uint32_t dst, float gain);
+// Works out the order nodes can run in, fails if the sends make a loop, and allocates everything processing needs.
+// Changing only a node's effects chain doesn't need a compile (see effectsChanged), though until there is one, a chain bigger than the last one runs the slow way.
+int azaGraphCompile(azaGraph *graph);
+// Runs every node, writing the output node into buffer, which must have the graph's channels.
+// Nodes become ready as their inputs finish and go to whichever thread gets them first. Anything the workers don't get to runs on the calling thread.
+int azaGraphProcess(azaGraph *graph, azaBuffer buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_GRAPH_H
@@ -6,6 +6,7 @@
 #include "helpers.h"
 
 #include <assert.h>
+#include <time.h>
 
 float trif(float x) {
 	x /= AZA_PI;
@@ -66,6 +67,24 @@ size_t aza_grow(size_t startSize, size_t minSize, size_t alignment) {
 	return startSize;
 }
 
+size_t aza_next_pow2(size_t size) {
+	size_t result = 1;
+	while (result < size) {
+		result <<= 1;
+	}
+	return result;
+}
+
+float aza_flush_denormal(float x) {
+	return fabsf(x) < 1e-30f ? 0.0f : x;
+}
+
+uint64_t aza_now_ns() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 float clampf(float a, float minimum, float maximum) {
 	return a < minimum ? minimum : (a > maximum ? maximum : a);
 }
@@ -10,6 +10,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,7 +52,21 @@ size_t aza_align_non_power_of_two(size_t size, size_t alignment);
 // Grows the size by 3/2 repeatedly until it's at least as big as minSize
 size_t aza_grow(size_t size, size_t minSize, size_t alignment);
 
+// Smallest power of 2 that's at least size, for ring buffers that wrap with a mask
+size_t aza_next_pow2(size_t size);
+
+// Added into feedback paths so their decay settles around here instead of sinking into denormals on CPUs that can't flush them.
+// That's about -400dB, and well above the smallest normal float.
+#define AZA_DENORMAL_OFFSET 1e-20f
+
+// Zero if x is small enough to be on its way to being a denormal, for flushing recursive states after each block
+float aza_flush_denormal(float x);
+
+// Nanoseconds from an arbitrary point, monotonic
+uint64_t aza_now_ns();
+
 #define AZA_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define AZA_MIN(a, b) ((a) < (b) ? (a) : (b))
 
 #define AZA_SAMPLES_TO_MS(samples, samplerate) ((float)(samples) / (float)(samplerate) * 1000.0f)
 
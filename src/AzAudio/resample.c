@@ -0,0 +1,201 @@
+/*
+	File: resample.c
+	Author: Philip Haynes
+*/
+
+#include "resample.h"
+
+#include "error.h"
+#include "helpers.h"
+
+#include <pthread.h>
+
+#define AZAUDIO_RESAMPLE_TIERS 4
+
+static azaResampleTable *resampleTables[AZAUDIO_RESAMPLE_TIERS] = {0};
+static pthread_mutex_t resampleTablesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Zeroth order modified bessel function of the first kind, for the kaiser window
+static double azaBesselI0(double x) {
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++) {
+		term *= (x * 0.5 / (double)k) * (x * 0.5 / (double)k);
+		sum += term;
+		if (term < sum * 1e-12) break;
+	}
+	return sum;
+}
+
+static uint32_t azaResampleTier(azaResampleQuality quality) {
+	switch (quality) {
+		case AZA_RESAMPLE_QUALITY_4: return 0;
+		case AZA_RESAMPLE_QUALITY_16: return 2;
+		case AZA_RESAMPLE_QUALITY_32: return 3;
+		default: return 1;
+	}
+}
+
+// Fills bands of rows, where each band's cutoff is lowered for stepping through the source speeds[band] times faster
+static void azaResampleTableBuild(azaResampleTable *table, uint32_t tier, const double *speeds, uint32_t bands) {
+	// Shorter kernels can't reject much anyway, so they get a gentler window and a lower cutoff (relative to nyquist) to keep the passband ripple down.
+	static const double betas[AZAUDIO_RESAMPLE_TIERS] = { 3.0, 5.0, 7.0, 9.0 };
+	static const double cutoffs[AZAUDIO_RESAMPLE_TIERS] = { 0.75, 0.84, 0.90, 0.94 };
+	uint32_t taps = table->taps;
+	double halfWidth = (double)taps * 0.5;
+	double beta = betas[tier];
+	double windowScale = 1.0 / azaBesselI0(beta);
+	for (uint32_t band = 0; band < bands; band++) {
+		double cutoff = cutoffs[tier] / AZA_MAX(speeds[band], 1.0);
+		for (uint32_t phase = 0; phase <= AZAUDIO_RESAMPLE_PHASES; phase++) {
+			float *row = table->coefficients + (band * (AZAUDIO_RESAMPLE_PHASES+1) + phase) * taps;
+			double fraction = (double)phase / (double)AZAUDIO_RESAMPLE_PHASES;
+			double total = 0.0;
+			double kernel[32];
+			for (uint32_t k = 0; k < taps; k++) {
+				double t = (double)k - halfWidth + 1.0 - fraction;
+				double x = t / halfWidth;
+				double window = x * x < 1.0 ? azaBesselI0(beta * sqrt(1.0 - x * x)) * windowScale : 0.0;
+				double arg = AZA_PI * cutoff * t;
+				double sinc = t == 0.0 ? 1.0 : sin(arg) / arg;
+				kernel[k] = sinc * window;
+				total += kernel[k];
+			}
+			// Normalized per row so DC passes at exactly unity no matter the phase
+			for (uint32_t k = 0; k < taps; k++) {
+				row[k] = (float)(kernel[k] / total);
+			}
+		}
+	}
+}
+
+const azaResampleTable* azaGetResampleTable(azaResampleQuality quality) {
+	uint32_t tier = azaResampleTier(quality);
+	azaResampleTable *table = __atomic_load_n(&resampleTables[tier], __ATOMIC_ACQUIRE);
+	if (table) return table;
+	pthread_mutex_lock(&resampleTablesMutex);
+	table = resampleTables[tier];
+	if (!table) {
+		uint32_t taps = 4u << tier;
+		table = malloc(sizeof(azaResampleTable) + sizeof(float) * AZAUDIO_RESAMPLE_BANDS * (AZAUDIO_RESAMPLE_PHASES+1) * taps);
+		if (table) {
+			table->taps = taps;
+			table->coefficients = (float*)(table + 1);
+			double speeds[AZAUDIO_RESAMPLE_BANDS];
+			for (uint32_t band = 0; band < AZAUDIO_RESAMPLE_BANDS; band++) {
+				speeds[band] = pow(2.0, (double)band * 0.5);
+			}
+			azaResampleTableBuild(table, tier, speeds, AZAUDIO_RESAMPLE_BANDS);
+			__atomic_store_n(&resampleTables[tier], table, __ATOMIC_RELEASE);
+		}
+	}
+	pthread_mutex_unlock(&resampleTablesMutex);
+	return table;
+}
+
+int azaResamplerInit(azaResampler *data, size_t channels, size_t srcSamplerate, size_t dstSamplerate, size_t maxFrames, azaResampleQuality quality) {
+	if (channels < 1 || channels > AZAUDIO_RESAMPLER_MAX_CHANNELS) {
+		AZA_PRINT_ERR("azaResamplerInit error: channels (%zu) must be from 1 to %u\n", channels, AZAUDIO_RESAMPLER_MAX_CHANNELS);
+		return AZA_ERROR_INVALID_CHANNEL_COUNT;
+	}
+	if (srcSamplerate == 0 || dstSamplerate == 0 || maxFrames == 0) {
+		AZA_PRINT_ERR("azaResamplerInit error: samplerates and maxFrames must be nonzero\n");
+		return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	double ratio = (double)srcSamplerate / (double)dstSamplerate;
+	uint32_t tier = azaResampleTier(quality);
+	uint32_t taps = 4u << tier;
+	// The ratio never changes, so we get a single band with exactly the right cutoff
+	azaResampleTable *table = malloc(sizeof(azaResampleTable) + sizeof(float) * (AZAUDIO_RESAMPLE_PHASES+1) * taps);
+	if (table == NULL) {
+		return AZA_ERROR_OUT_OF_MEMORY;
+	}
+	table->taps = taps;
+	table->coefficients = (float*)(table + 1);
+	azaResampleTableBuild(table, tier, &ratio, 1);
+	data->table = table;
+	data->band = 0;
+	data->step = (uint64_t)(ratio * 4294967296.0 + 0.5);
+	data->maxFrames = maxFrames;
+	// Room for a full write on top of what one process needs, plus the kernel on either side
+	data->history.frames = (size_t)ceil((double)maxFrames * ratio) + maxFrames + taps + 2;
+	data->history.channels = channels;
+	data->history.samplerate = srcSamplerate;
+	int err = azaBufferInitPlanar(&data->history);
+	if (err) {
+		free(table);
+		data->table = NULL;
+		return err;
+	}
+	// Silence before the start so the first frame has history
+	data->frames = taps / 2 - 1;
+	for (size_t c = 0; c < channels; c++) {
+		memset(data->history.planes[c], 0, sizeof(float) * data->frames);
+	}
+	data->position = (uint64_t)data->frames << 32;
+	return AZA_SUCCESS;
+}
+
+void azaResamplerDeinit(azaResampler *data) {
+	free((azaResampleTable*)data->table);
+	data->table = NULL;
+	azaBufferDeinit(&data->history);
+	data->history.planes = NULL;
+	data->history.samples = NULL;
+}
+
+size_t azaResamplerNeeded(const azaResampler *data, size_t dstFrames) {
+	if (dstFrames == 0) return 0;
+	uint64_t last = data->position + data->step * (dstFrames - 1);
+	size_t needed = (size_t)(last >> 32) + data->table->taps / 2 + 1;
+	return needed > data->frames ? needed - data->frames : 0;
+}
+
+size_t azaResamplerAvailable(const azaResampler *data) {
+	size_t halfTaps = data->table->taps / 2;
+	if (data->frames < halfTaps + 1) return 0;
+	// The last frame that can be centered on with all its taps in history
+	uint64_t last = (uint64_t)(data->frames - halfTaps) << 32;
+	if (data->position >= last) return 0;
+	return (size_t)((last - data->position - 1) / data->step) + 1;
+}
+
+azaBuffer azaResamplerInput(azaResampler *data, size_t frames) {
+	for (size_t c = 0; c < data->history.channels; c++) {
+		data->inputPlanes[c] = data->history.planes[c] + data->frames;
+	}
+	return (azaBuffer) {
+		.samples = data->inputPlanes[0],
+		.frames = frames,
+		.stride = 1,
+		.channels = data->history.channels,
+		.samplerate = data->history.samplerate,
+		.planes = data->inputPlanes,
+	};
+}
+
+void azaResamplerCommit(azaResampler *data, size_t frames) {
+	data->frames += frames;
+}
+
+void azaResamplerProcess(azaResampler *data, azaBuffer dst) {
+	int64_t halfTaps = (int64_t)data->table->taps / 2;
+	for (size_t c = 0; c < data->history.channels && c < dst.channels; c++) {
+		const float *src = data->history.planes[c];
+		float *samples = azaBufferChannelSamples(dst, c);
+		uint64_t position = data->position;
+		for (size_t i = 0; i < dst.frames; i++) {
+			const float *window = src + (int64_t)(position >> 32) - halfTaps + 1;
+			samples[i * dst.stride] = azaResampleSample(data->table, data->band, window, (uint32_t)position);
+			position += data->step;
+		}
+	}
+	data->position += data->step * dst.frames;
+	// Keep only what the next frame's kernel reaches back to
+	size_t drop = (size_t)(data->position >> 32) - (size_t)(halfTaps - 1);
+	if (drop > data->frames) drop = data->frames;
+	for (size_t c = 0; c < data->history.channels; c++) {
+		memmove(data->history.planes[c], data->history.planes[c] + drop, sizeof(float) * (data->frames - drop));
+	}
+	data->frames -= drop;
+	data->position -= (uint64_t)drop << 32;
+}
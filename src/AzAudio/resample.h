@@ -0,0 +1,101 @@
+/*
+	File: resample.h
+	Author: Philip Haynes
+	Polyphase windowed-sinc interpolation tables shared by everything that changes playback rate. Not to be included in headers.
+*/
+
+#ifndef AZAUDIO_RESAMPLE_H
+#define AZAUDIO_RESAMPLE_H
+
+#include "dsp.h"
+#include "simd.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of fractional positions between two samples that get their own row of coefficients.
+// Positions in between are linearly interpolated from the two nearest rows.
+#define AZAUDIO_RESAMPLE_PHASE_BITS 8
+#define AZAUDIO_RESAMPLE_PHASES (1 << AZAUDIO_RESAMPLE_PHASE_BITS)
+// Each band has its cutoff lowered for stepping through the source faster, up to 2^((AZAUDIO_RESAMPLE_BANDS-1)/2) = 8x.
+// Speeds beyond that use the last band and will alias.
+#define AZAUDIO_RESAMPLE_BANDS 7
+
+typedef struct azaResampleTable {
+	// 4, 8, 16, or 32
+	uint32_t taps;
+	// AZAUDIO_RESAMPLE_BANDS bands of AZAUDIO_RESAMPLE_PHASES+1 rows of taps coefficients.
+	// Tap k of a row weighs the source sample at floor(position) - taps/2 + 1 + k.
+	float *coefficients;
+} azaResampleTable;
+
+// Gets the tables for the given quality, building them the first time they're asked for. Thread-safe.
+// The tables live until exit, so it's best to call this outside of the audio thread first.
+// Returns NULL if we're out of memory.
+const azaResampleTable* azaGetResampleTable(azaResampleQuality quality);
+
+// Which band to use when moving through the source speed samples per output sample
+static inline uint32_t azaResampleBand(float speed) {
+	// 2^(b/2) for each band b
+	static const float bandSpeeds[AZAUDIO_RESAMPLE_BANDS-1] = {
+		1.0f, 1.41421356f, 2.0f, 2.82842712f, 4.0f, 5.65685425f,
+	};
+	uint32_t band = 0;
+	while (band < AZAUDIO_RESAMPLE_BANDS-1 && speed > bandSpeeds[band]) band++;
+	return band;
+}
+
+// Interpolates the source at fraction (32-bit fixed point) of the way between src[taps/2-1] and src[taps/2].
+// src must have table->taps samples available.
+static inline float azaResampleSample(const azaResampleTable *table, uint32_t band, const float *src, uint32_t fraction) {
+	uint32_t phase = fraction >> (32 - AZAUDIO_RESAMPLE_PHASE_BITS);
+	uint32_t phaseMask = (1u << (32 - AZAUDIO_RESAMPLE_PHASE_BITS)) - 1;
+	float phaseFraction = (float)(fraction & phaseMask) * (1.0f / (float)(phaseMask + 1));
+	const float *rows = table->coefficients + (band * (AZAUDIO_RESAMPLE_PHASES+1) + phase) * table->taps;
+	return azaKernel.polyphase(src, rows, table->taps, phaseFraction);
+}
+
+#define AZAUDIO_RESAMPLER_MAX_CHANNELS 64
+
+// Converts a continuous multichannel stream from one samplerate to another.
+// Source frames are written into it as they come, and destination frames are made once there's enough source around them.
+// Nothing is allocated after init, so it's safe to use on the audio thread.
+typedef struct azaResampler {
+	// Owned by the resampler, with a single band made for its ratio
+	const azaResampleTable *table;
+	uint32_t band;
+	// Source frames per destination frame as 32.32 fixed point
+	uint64_t step;
+	// Where the next destination frame is in history as 32.32 fixed point
+	uint64_t position;
+	// Planar source frames, with the first frames of each channel filled
+	azaBuffer history;
+	size_t frames;
+	// Views into history where new source frames get written
+	float *inputPlanes[AZAUDIO_RESAMPLER_MAX_CHANNELS];
+	// The most frames that can be made or written at once
+	size_t maxFrames;
+} azaResampler;
+// maxFrames is the most destination frames made by one azaResamplerProcess, and the most source frames written at once.
+int azaResamplerInit(azaResampler *data, size_t channels, size_t srcSamplerate, size_t dstSamplerate, size_t maxFrames, azaResampleQuality quality);
+void azaResamplerDeinit(azaResampler *data);
+// How many more source frames have to be written before dstFrames can be made
+size_t azaResamplerNeeded(const azaResampler *data, size_t dstFrames);
+// How many destination frames can be made from the source frames written so far
+size_t azaResamplerAvailable(const azaResampler *data);
+// A planar buffer at the source samplerate to write the next frames of source into, followed by azaResamplerCommit.
+// frames can be up to maxFrames.
+azaBuffer azaResamplerInput(azaResampler *data, size_t frames);
+void azaResamplerCommit(azaResampler *data, size_t frames);
+// Fills dst with dst.frames destination frames, which must be no more than azaResamplerAvailable and maxFrames.
+// Source frames that are no longer needed are dropped.
+void azaResamplerProcess(azaResampler *data, azaBuffer dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_RESAMPLE_H
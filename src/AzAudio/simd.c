@@ -0,0 +1,1340 @@
+/*
+	File: simd.c
+	Author: Philip Haynes
+*/
+
+#include "simd.h"
+
+#include "error.h"
+#include "helpers.h"
+
+#include <string.h>
+
+#if AZA_SIMD_X86
+#include <immintrin.h>
+#define AZA_TARGET(x) __attribute__((target(x)))
+#endif
+
+#if AZA_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+
+
+// Scalar
+
+
+
+static void azaMixScalar(float *dst, float volumeDst, const float *src, float volumeSrc, size_t count) {
+	if (volumeDst == 1.0f && volumeSrc == 1.0f) {
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = dst[i] + src[i];
+		}
+	} else if AZA_LIKELY(volumeDst == 1.0f) {
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = dst[i] + src[i] * volumeSrc;
+		}
+	} else if (volumeSrc == 1.0f) {
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = dst[i] * volumeDst + src[i];
+		}
+	} else {
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = dst[i] * volumeDst + src[i] * volumeSrc;
+		}
+	}
+}
+
+static void azaCopyStridedScalar(float *dst, size_t dstStride, const float *src, size_t srcStride, size_t count) {
+	if (dstStride == 1 && srcStride == 1) {
+		memcpy(dst, src, sizeof(float) * count);
+	} else {
+		for (size_t i = 0; i < count; i++) {
+			dst[i * dstStride] = src[i * srcStride];
+		}
+	}
+}
+
+static void azaCubicLimiterScalar(float *samples, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		float sample = clampf(samples[i], -1.0f, 1.0f);
+		samples[i] = 1.5f * sample - 0.5f * sample * sample * sample;
+	}
+}
+
+static void azaInterleave2Scalar(float *dst, const float *left, const float *right, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		dst[i*2+0] = left[i];
+		dst[i*2+1] = right[i];
+	}
+}
+
+static void azaDeinterleave2Scalar(float *left, float *right, const float *src, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		left[i] = src[i*2+0];
+		right[i] = src[i*2+1];
+	}
+}
+
+static void azaBiquadChannelScalar(float *samples, size_t stride, size_t frames, const float *k, float *z1, float *z2) {
+	float s1 = *z1, s2 = *z2;
+	for (size_t i = 0; i < frames; i++) {
+		float x = samples[i * stride];
+		float y = k[0] * x + s1;
+		s1 = k[1] * x - k[3] * y + s2;
+		s2 = k[2] * x - k[4] * y;
+		samples[i * stride] = y;
+	}
+	*z1 = s1;
+	*z2 = s2;
+}
+
+static void azaBiquadScalar(azaBuffer buffer, const float coefficients[5], float *z1, float *z2) {
+	for (size_t c = 0; c < buffer.channels; c++) {
+		azaBiquadChannelScalar(azaBufferChannelSamples(buffer, c), buffer.stride, buffer.frames, coefficients, &z1[c], &z2[c]);
+	}
+}
+
+static void azaAmpToDbScalar(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k) {
+	for (size_t i = 0; i < count; i++) {
+		dst[i] = aza_poly_log2f(src[i], k) * AZA_LOG2_TO_DB;
+	}
+}
+
+static void azaDbToAmpScalar(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k) {
+	for (size_t i = 0; i < count; i++) {
+		dst[i] = aza_poly_exp2f(src[i] * AZA_DB_TO_LOG2, k);
+	}
+}
+
+
+static void azaReverbScalar(azaReverbData *data, const float *input, float *taps, size_t frames) {
+	size_t mask = data->capacity - 1;
+	float *lowpass = data->lineLowpass;
+	for (size_t i = 0; i < frames; i++) {
+		size_t index = data->index + i;
+		float v[AZAUDIO_REVERB_LINES];
+		for (int j = 0; j < AZAUDIO_REVERB_LINES; j++) {
+			float out = data->lines[((index - data->lineDelays[j]) & mask) * AZAUDIO_REVERB_LINES + j];
+			taps[i * AZAUDIO_REVERB_LINES + j] = out;
+			lowpass[j] = out + data->lineDamping[j] * (lowpass[j] - out);
+			v[j] = lowpass[j] * data->lineGains[j];
+		}
+		// Fast Walsh-Hadamard transform
+		for (int h = 1; h < AZAUDIO_REVERB_LINES; h <<= 1) {
+			for (int j = 0; j < AZAUDIO_REVERB_LINES; j += h*2) {
+				for (int k = j; k < j+h; k++) {
+					float a = v[k], b = v[k+h];
+					v[k] = a + b;
+					v[k+h] = a - b;
+				}
+			}
+		}
+		float *dst = data->lines + (index & mask) * AZAUDIO_REVERB_LINES;
+		for (int j = 0; j < AZAUDIO_REVERB_LINES; j++) {
+			dst[j] = v[j] + input[i];
+		}
+	}
+	data->index += frames;
+}
+
+
+static void azaComplexMulAddScalar(float *dst, const float *a, const float *b, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		float ar = a[i*2+0], ai = a[i*2+1];
+		float br = b[i*2+0], bi = b[i*2+1];
+		dst[i*2+0] += ar * br - ai * bi;
+		dst[i*2+1] += ar * bi + ai * br;
+	}
+}
+
+static float azaDotScalar(const float *a, const float *b, size_t count) {
+	float result = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		result += a[i] * b[i];
+	}
+	return result;
+}
+
+
+static void azaFFTPassScalar(float *x, size_t count, size_t half, const float *twiddles) {
+	for (size_t i = 0; i < count; i += half * 2) {
+		float *a = x + i * 2;
+		float *b = x + (i + half) * 2;
+		for (size_t j = 0; j < half; j++) {
+			float wr = twiddles[j*2+0], wi = twiddles[j*2+1];
+			float vr = b[j*2+0] * wr - b[j*2+1] * wi;
+			float vi = b[j*2+0] * wi + b[j*2+1] * wr;
+			b[j*2+0] = a[j*2+0] - vr;
+			b[j*2+1] = a[j*2+1] - vi;
+			a[j*2+0] += vr;
+			a[j*2+1] += vi;
+		}
+	}
+}
+
+static float azaPolyphaseScalar(const float *src, const float *rows, size_t taps, float fraction) {
+	float sum0 = 0.0f, sum1 = 0.0f;
+	for (size_t i = 0; i < taps; i++) {
+		sum0 += src[i] * rows[i];
+		sum1 += src[i] * rows[taps + i];
+	}
+	return sum0 + fraction * (sum1 - sum0);
+}
+
+
+
+#if AZA_SIMD_X86
+
+// SSE2
+
+
+
+AZA_TARGET("sse2")
+static void azaMixSSE2(float *dst, float volumeDst, const float *src, float volumeSrc, size_t count) {
+	__m128 vDst = _mm_set1_ps(volumeDst);
+	__m128 vSrc = _mm_set1_ps(volumeSrc);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128 a0 = _mm_mul_ps(_mm_loadu_ps(dst + i), vDst);
+		__m128 a1 = _mm_mul_ps(_mm_loadu_ps(dst + i + 4), vDst);
+		__m128 b0 = _mm_mul_ps(_mm_loadu_ps(src + i), vSrc);
+		__m128 b1 = _mm_mul_ps(_mm_loadu_ps(src + i + 4), vSrc);
+		_mm_storeu_ps(dst + i, _mm_add_ps(a0, b0));
+		_mm_storeu_ps(dst + i + 4, _mm_add_ps(a1, b1));
+	}
+	azaMixScalar(dst + i, volumeDst, src + i, volumeSrc, count - i);
+}
+
+AZA_TARGET("sse2")
+static void azaCopyStridedSSE2(float *dst, size_t dstStride, const float *src, size_t srcStride, size_t count) {
+	size_t i = 0;
+	// The vectors reach past the last sample of the channel (src and dst may point at any channel of an interleaved buffer), so the last frame is always left to the scalar loop
+	if (dstStride == 1 && srcStride == 2) {
+		// Deinterleave one channel of a stereo buffer
+		for (; i + 5 <= count; i += 4) {
+			__m128 a = _mm_loadu_ps(src + i * 2);
+			__m128 b = _mm_loadu_ps(src + i * 2 + 4);
+			_mm_storeu_ps(dst + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		}
+	} else if (dstStride == 1 && srcStride == 4) {
+		for (; i + 5 <= count; i += 4) {
+			__m128 a = _mm_loadu_ps(src + i * 4);
+			__m128 b = _mm_loadu_ps(src + i * 4 + 4);
+			__m128 c = _mm_loadu_ps(src + i * 4 + 8);
+			__m128 d = _mm_loadu_ps(src + i * 4 + 12);
+			__m128 ab = _mm_unpacklo_ps(a, b);
+			__m128 cd = _mm_unpacklo_ps(c, d);
+			_mm_storeu_ps(dst + i, _mm_movelh_ps(ab, cd));
+		}
+	} else if (dstStride == 2 && srcStride == 1) {
+		// Interleave into one channel of a stereo buffer, keeping the other channel intact
+		for (; i + 5 <= count; i += 4) {
+			__m128 s = _mm_loadu_ps(src + i);
+			__m128 a = _mm_loadu_ps(dst + i * 2);
+			__m128 b = _mm_loadu_ps(dst + i * 2 + 4);
+			// [s0 a1 s1 a3] and [s2 b1 s3 b3]
+			__m128 oddA = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 3, 1));
+			__m128 oddB = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 3, 1));
+			_mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(s, oddA));
+			_mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(s, oddB));
+		}
+	} else {
+		azaCopyStridedScalar(dst, dstStride, src, srcStride, count);
+		return;
+	}
+	azaCopyStridedScalar(dst + i * dstStride, dstStride, src + i * srcStride, srcStride, count - i);
+}
+
+AZA_TARGET("sse2")
+static void azaCubicLimiterSSE2(float *samples, size_t count) {
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 minusOne = _mm_set1_ps(-1.0f);
+	__m128 a = _mm_set1_ps(1.5f);
+	__m128 b = _mm_set1_ps(0.5f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(samples + i);
+		x = _mm_min_ps(_mm_max_ps(x, minusOne), one);
+		__m128 x3 = _mm_mul_ps(_mm_mul_ps(x, x), x);
+		_mm_storeu_ps(samples + i, _mm_sub_ps(_mm_mul_ps(a, x), _mm_mul_ps(b, x3)));
+	}
+	azaCubicLimiterScalar(samples + i, count - i);
+}
+
+AZA_TARGET("sse2")
+static void azaInterleave2SSE2(float *dst, const float *left, const float *right, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 l = _mm_loadu_ps(left + i);
+		__m128 r = _mm_loadu_ps(right + i);
+		_mm_storeu_ps(dst + i*2, _mm_unpacklo_ps(l, r));
+		_mm_storeu_ps(dst + i*2 + 4, _mm_unpackhi_ps(l, r));
+	}
+	azaInterleave2Scalar(dst + i*2, left + i, right + i, count - i);
+}
+
+AZA_TARGET("sse2")
+static void azaDeinterleave2SSE2(float *left, float *right, const float *src, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 a = _mm_loadu_ps(src + i*2);
+		__m128 b = _mm_loadu_ps(src + i*2 + 4);
+		_mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+	azaDeinterleave2Scalar(left + i, right + i, src + i*2, count - i);
+}
+
+// One frame of a biquad for 4 channels at once
+#define AZA_BIQUAD_TICK_SSE(x, y) \
+	y = _mm_add_ps(_mm_mul_ps(b0, x), s1);\
+	s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), s2);\
+	s2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y))
+
+// Processes 2 or 4 adjacent channels of an interleaved buffer
+AZA_TARGET("sse2")
+static void azaBiquadLanesSSE2(float *samples, size_t stride, size_t frames, size_t lanes, const float *k, float *z1, float *z2) {
+	__m128 b0 = _mm_set1_ps(k[0]), b1 = _mm_set1_ps(k[1]), b2 = _mm_set1_ps(k[2]);
+	__m128 a1 = _mm_set1_ps(k[3]), a2 = _mm_set1_ps(k[4]);
+	__m128 x, y;
+	if (lanes == 4) {
+		__m128 s1 = _mm_loadu_ps(z1), s2 = _mm_loadu_ps(z2);
+		for (size_t i = 0; i < frames; i++) {
+			x = _mm_loadu_ps(samples + i * stride);
+			AZA_BIQUAD_TICK_SSE(x, y);
+			_mm_storeu_ps(samples + i * stride, y);
+		}
+		_mm_storeu_ps(z1, s1);
+		_mm_storeu_ps(z2, s2);
+	} else {
+		__m128 s1 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)z1);
+		__m128 s2 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)z2);
+		for (size_t i = 0; i < frames; i++) {
+			x = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(samples + i * stride));
+			AZA_BIQUAD_TICK_SSE(x, y);
+			_mm_storel_pi((__m64*)(samples + i * stride), y);
+		}
+		_mm_storel_pi((__m64*)z1, s1);
+		_mm_storel_pi((__m64*)z2, s2);
+	}
+}
+
+// Processes 4 planes at once by transposing blocks of 4x4 samples
+AZA_TARGET("sse2")
+static void azaBiquadPlanesSSE2(float **planes, size_t frames, const float *k, float *z1, float *z2) {
+	__m128 b0 = _mm_set1_ps(k[0]), b1 = _mm_set1_ps(k[1]), b2 = _mm_set1_ps(k[2]);
+	__m128 a1 = _mm_set1_ps(k[3]), a2 = _mm_set1_ps(k[4]);
+	__m128 s1 = _mm_loadu_ps(z1), s2 = _mm_loadu_ps(z2);
+	size_t i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 x0 = _mm_loadu_ps(planes[0] + i);
+		__m128 x1 = _mm_loadu_ps(planes[1] + i);
+		__m128 x2 = _mm_loadu_ps(planes[2] + i);
+		__m128 x3 = _mm_loadu_ps(planes[3] + i);
+		_MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+		__m128 y0, y1, y2, y3;
+		AZA_BIQUAD_TICK_SSE(x0, y0);
+		AZA_BIQUAD_TICK_SSE(x1, y1);
+		AZA_BIQUAD_TICK_SSE(x2, y2);
+		AZA_BIQUAD_TICK_SSE(x3, y3);
+		_MM_TRANSPOSE4_PS(y0, y1, y2, y3);
+		_mm_storeu_ps(planes[0] + i, y0);
+		_mm_storeu_ps(planes[1] + i, y1);
+		_mm_storeu_ps(planes[2] + i, y2);
+		_mm_storeu_ps(planes[3] + i, y3);
+	}
+	for (; i < frames; i++) {
+		__m128 x = _mm_setr_ps(planes[0][i], planes[1][i], planes[2][i], planes[3][i]), y;
+		AZA_BIQUAD_TICK_SSE(x, y);
+		float out[4];
+		_mm_storeu_ps(out, y);
+		for (int c = 0; c < 4; c++) planes[c][i] = out[c];
+	}
+	_mm_storeu_ps(z1, s1);
+	_mm_storeu_ps(z2, s2);
+}
+
+AZA_TARGET("sse2")
+static void azaBiquadSSE2(azaBuffer buffer, const float coefficients[5], float *z1, float *z2) {
+	size_t c = 0;
+	if (buffer.planes) {
+		if (buffer.stride == 1) {
+			for (; c + 4 <= buffer.channels; c += 4) {
+				azaBiquadPlanesSSE2(buffer.planes + c, buffer.frames, coefficients, z1 + c, z2 + c);
+			}
+		}
+	} else {
+		for (; c + 4 <= buffer.channels; c += 4) {
+			azaBiquadLanesSSE2(buffer.samples + c, buffer.stride, buffer.frames, 4, coefficients, z1 + c, z2 + c);
+		}
+		for (; c + 2 <= buffer.channels; c += 2) {
+			azaBiquadLanesSSE2(buffer.samples + c, buffer.stride, buffer.frames, 2, coefficients, z1 + c, z2 + c);
+		}
+	}
+	for (; c < buffer.channels; c++) {
+		azaBiquadChannelScalar(azaBufferChannelSamples(buffer, c), buffer.stride, buffer.frames, coefficients, &z1[c], &z2[c]);
+	}
+}
+
+
+AZA_TARGET("sse2")
+static void azaAmpToDbSSE2(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k) {
+	__m128 c[AZA_FASTMATH_MAX_DEGREE];
+	for (int d = 0; d < k->logDegree; d++) c[d] = _mm_set1_ps(k->log[d]);
+	__m128 minimum = _mm_set1_ps(FLT_MIN);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 toDb = _mm_set1_ps(AZA_LOG2_TO_DB);
+	__m128i mantissaMask = _mm_set1_epi32(0x007FFFFF);
+	__m128i exponentOne = _mm_set1_epi32(0x3F800000);
+	__m128i bias = _mm_set1_epi32(127);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		// max returns the second operand for NaNs
+		__m128i xi = _mm_castps_si128(_mm_max_ps(_mm_loadu_ps(src + i), minimum));
+		__m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(xi, 23), bias));
+		__m128 t = _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(_mm_and_si128(xi, mantissaMask), exponentOne)), one);
+		__m128 p = c[k->logDegree-1];
+		for (int d = k->logDegree-2; d >= 0; d--) {
+			p = _mm_add_ps(_mm_mul_ps(p, t), c[d]);
+		}
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_add_ps(e, _mm_mul_ps(t, p)), toDb));
+	}
+	azaAmpToDbScalar(dst + i, src + i, count - i, k);
+}
+
+AZA_TARGET("sse2")
+static void azaDbToAmpSSE2(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k) {
+	__m128 c[AZA_FASTMATH_MAX_DEGREE];
+	for (int d = 0; d < k->expDegree; d++) c[d] = _mm_set1_ps(k->exp[d]);
+	__m128 minimum = _mm_set1_ps(-126.0f);
+	__m128 maximum = _mm_set1_ps(127.999f);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 toLog2 = _mm_set1_ps(AZA_DB_TO_LOG2);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_mul_ps(_mm_loadu_ps(src + i), toLog2);
+		x = _mm_min_ps(_mm_max_ps(x, minimum), maximum);
+		// Truncation rounds negatives the wrong way, so floor them manually
+		__m128i n = _mm_cvttps_epi32(x);
+		__m128 nf = _mm_cvtepi32_ps(n);
+		__m128 over = _mm_cmpgt_ps(nf, x);
+		n = _mm_add_epi32(n, _mm_castps_si128(over));
+		nf = _mm_sub_ps(nf, _mm_and_ps(over, one));
+		__m128 t = _mm_sub_ps(x, nf);
+		__m128 p = c[k->expDegree-1];
+		for (int d = k->expDegree-2; d >= 0; d--) {
+			p = _mm_add_ps(_mm_mul_ps(p, t), c[d]);
+		}
+		__m128i r = _mm_castps_si128(_mm_add_ps(one, _mm_mul_ps(t, p)));
+		_mm_storeu_ps(dst + i, _mm_castsi128_ps(_mm_add_epi32(r, _mm_slli_epi32(n, 23))));
+	}
+	azaDbToAmpScalar(dst + i, src + i, count - i, k);
+}
+
+
+_Static_assert(AZAUDIO_REVERB_LINES == 8, "The SIMD reverb kernels assume 8 lines");
+
+// Hadamard stages: lane j pairs with lane j^h, giving a+b in the lane with that bit clear and a-b in the other
+AZA_TARGET("sse2")
+static void azaReverbSSE2(azaReverbData *data, const float *input, float *taps, size_t frames) {
+	size_t mask = data->capacity - 1;
+	const float *lines = data->lines;
+	const int32_t *d = data->lineDelays;
+	__m128 damp0 = _mm_loadu_ps(data->lineDamping), damp1 = _mm_loadu_ps(data->lineDamping + 4);
+	__m128 gain0 = _mm_loadu_ps(data->lineGains), gain1 = _mm_loadu_ps(data->lineGains + 4);
+	__m128 lp0 = _mm_loadu_ps(data->lineLowpass), lp1 = _mm_loadu_ps(data->lineLowpass + 4);
+	const __m128 sign1 = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+	const __m128 sign2 = _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f);
+	for (size_t i = 0; i < frames; i++) {
+		size_t index = data->index + i;
+		__m128 out0 = _mm_setr_ps(
+			lines[((index - d[0]) & mask) * 8 + 0],
+			lines[((index - d[1]) & mask) * 8 + 1],
+			lines[((index - d[2]) & mask) * 8 + 2],
+			lines[((index - d[3]) & mask) * 8 + 3]);
+		__m128 out1 = _mm_setr_ps(
+			lines[((index - d[4]) & mask) * 8 + 4],
+			lines[((index - d[5]) & mask) * 8 + 5],
+			lines[((index - d[6]) & mask) * 8 + 6],
+			lines[((index - d[7]) & mask) * 8 + 7]);
+		_mm_storeu_ps(taps + i * 8, out0);
+		_mm_storeu_ps(taps + i * 8 + 4, out1);
+		lp0 = _mm_add_ps(out0, _mm_mul_ps(damp0, _mm_sub_ps(lp0, out0)));
+		lp1 = _mm_add_ps(out1, _mm_mul_ps(damp1, _mm_sub_ps(lp1, out1)));
+		__m128 v0 = _mm_mul_ps(lp0, gain0);
+		__m128 v1 = _mm_mul_ps(lp1, gain1);
+		v0 = _mm_add_ps(_mm_shuffle_ps(v0, v0, _MM_SHUFFLE(2, 3, 0, 1)), _mm_mul_ps(v0, sign1));
+		v1 = _mm_add_ps(_mm_shuffle_ps(v1, v1, _MM_SHUFFLE(2, 3, 0, 1)), _mm_mul_ps(v1, sign1));
+		v0 = _mm_add_ps(_mm_shuffle_ps(v0, v0, _MM_SHUFFLE(1, 0, 3, 2)), _mm_mul_ps(v0, sign2));
+		v1 = _mm_add_ps(_mm_shuffle_ps(v1, v1, _MM_SHUFFLE(1, 0, 3, 2)), _mm_mul_ps(v1, sign2));
+		__m128 x = _mm_set1_ps(input[i]);
+		float *dst = data->lines + (index & mask) * 8;
+		_mm_storeu_ps(dst, _mm_add_ps(_mm_add_ps(v0, v1), x));
+		_mm_storeu_ps(dst + 4, _mm_add_ps(_mm_sub_ps(v0, v1), x));
+	}
+	_mm_storeu_ps(data->lineLowpass, lp0);
+	_mm_storeu_ps(data->lineLowpass + 4, lp1);
+	data->index += frames;
+}
+
+
+// Multiplies 2 interleaved complex values at once
+AZA_TARGET("sse2")
+static void azaComplexMulAddSSE2(float *dst, const float *a, const float *b, size_t count) {
+	const __m128 sign = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128 va = _mm_loadu_ps(a + i*2);
+		__m128 vb = _mm_loadu_ps(b + i*2);
+		__m128 bReal = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 2, 0, 0));
+		__m128 bImag = _mm_mul_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 3, 1, 1)), sign);
+		__m128 aSwap = _mm_shuffle_ps(va, va, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 result = _mm_add_ps(_mm_mul_ps(va, bReal), _mm_mul_ps(aSwap, bImag));
+		_mm_storeu_ps(dst + i*2, _mm_add_ps(_mm_loadu_ps(dst + i*2), result));
+	}
+	azaComplexMulAddScalar(dst + i*2, a + i*2, b + i*2, count - i);
+}
+
+AZA_TARGET("sse2")
+static float azaDotSSE2(const float *a, const float *b, size_t count) {
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+	}
+	float sums[4];
+	_mm_storeu_ps(sums, _mm_add_ps(sum0, sum1));
+	return sums[0] + sums[1] + sums[2] + sums[3] + azaDotScalar(a + i, b + i, count - i);
+}
+
+
+// Complex multiply of 2 interleaved values, using the same shuffles as azaComplexMulAddSSE2
+AZA_TARGET("sse2")
+static void azaFFTPassSSE2(float *x, size_t count, size_t half, const float *twiddles) {
+	const __m128 sign = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+	for (size_t i = 0; i < count; i += half * 2) {
+		float *a = x + i * 2;
+		float *b = x + (i + half) * 2;
+		for (size_t j = 0; j < half; j += 2) {
+			__m128 w = _mm_loadu_ps(twiddles + j*2);
+			__m128 vb = _mm_loadu_ps(b + j*2);
+			__m128 wReal = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+			__m128 wImag = _mm_mul_ps(_mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1)), sign);
+			__m128 bSwap = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1));
+			__m128 v = _mm_add_ps(_mm_mul_ps(vb, wReal), _mm_mul_ps(bSwap, wImag));
+			__m128 va = _mm_loadu_ps(a + j*2);
+			_mm_storeu_ps(a + j*2, _mm_add_ps(va, v));
+			_mm_storeu_ps(b + j*2, _mm_sub_ps(va, v));
+		}
+	}
+}
+
+AZA_TARGET("sse2")
+static float azaPolyphaseSSE2(const float *src, const float *rows, size_t taps, float fraction) {
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+	for (size_t i = 0; i < taps; i += 4) {
+		__m128 x = _mm_loadu_ps(src + i);
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(x, _mm_loadu_ps(rows + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(x, _mm_loadu_ps(rows + taps + i)));
+	}
+	__m128 sum = _mm_add_ps(sum0, _mm_mul_ps(_mm_set1_ps(fraction), _mm_sub_ps(sum1, sum0)));
+	float sums[4];
+	_mm_storeu_ps(sums, sum);
+	return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+
+
+// AVX2
+
+// The SSE2 kernels are built without VEX encoding, so the upper halves of the ymm registers have to be cleared before handing the remainder to them.
+// Otherwise every SSE instruction after pays for the transition.
+
+
+
+AZA_TARGET("avx2")
+static void azaMixAVX2(float *dst, float volumeDst, const float *src, float volumeSrc, size_t count) {
+	__m256 vDst = _mm256_set1_ps(volumeDst);
+	__m256 vSrc = _mm256_set1_ps(volumeSrc);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m256 a0 = _mm256_mul_ps(_mm256_loadu_ps(dst + i), vDst);
+		__m256 a1 = _mm256_mul_ps(_mm256_loadu_ps(dst + i + 8), vDst);
+		__m256 b0 = _mm256_mul_ps(_mm256_loadu_ps(src + i), vSrc);
+		__m256 b1 = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), vSrc);
+		_mm256_storeu_ps(dst + i, _mm256_add_ps(a0, b0));
+		_mm256_storeu_ps(dst + i + 8, _mm256_add_ps(a1, b1));
+	}
+	_mm256_zeroupper();
+	azaMixSSE2(dst + i, volumeDst, src + i, volumeSrc, count - i);
+}
+
+AZA_TARGET("avx2")
+static void azaCopyStridedAVX2(float *dst, size_t dstStride, const float *src, size_t srcStride, size_t count) {
+	if (dstStride != 1 || srcStride == 1 || srcStride == 2 || srcStride == 4 || srcStride > INT32_MAX / 8) {
+		// Shuffles beat gathers for the common strides
+		azaCopyStridedSSE2(dst, dstStride, src, srcStride, count);
+		return;
+	}
+	// Gathers work for any stride
+	__m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)srcStride));
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		_mm256_storeu_ps(dst + i, _mm256_i32gather_ps(src + i * srcStride, index, 4));
+	}
+	_mm256_zeroupper();
+	azaCopyStridedScalar(dst + i, dstStride, src + i * srcStride, srcStride, count - i);
+}
+
+AZA_TARGET("avx2")
+static void azaCubicLimiterAVX2(float *samples, size_t count) {
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 minusOne = _mm256_set1_ps(-1.0f);
+	__m256 a = _mm256_set1_ps(1.5f);
+	__m256 b = _mm256_set1_ps(0.5f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_loadu_ps(samples + i);
+		x = _mm256_min_ps(_mm256_max_ps(x, minusOne), one);
+		__m256 x3 = _mm256_mul_ps(_mm256_mul_ps(x, x), x);
+		_mm256_storeu_ps(samples + i, _mm256_sub_ps(_mm256_mul_ps(a, x), _mm256_mul_ps(b, x3)));
+	}
+	_mm256_zeroupper();
+	azaCubicLimiterSSE2(samples + i, count - i);
+}
+
+AZA_TARGET("avx2")
+static void azaInterleave2AVX2(float *dst, const float *left, const float *right, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 l = _mm256_loadu_ps(left + i);
+		__m256 r = _mm256_loadu_ps(right + i);
+		// unpack works within 128-bit lanes, so fix up the halves afterwards
+		__m256 lo = _mm256_unpacklo_ps(l, r);
+		__m256 hi = _mm256_unpackhi_ps(l, r);
+		_mm256_storeu_ps(dst + i*2, _mm256_permute2f128_ps(lo, hi, 0x20));
+		_mm256_storeu_ps(dst + i*2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+	}
+	_mm256_zeroupper();
+	azaInterleave2SSE2(dst + i*2, left + i, right + i, count - i);
+}
+
+AZA_TARGET("avx2")
+static void azaDeinterleave2AVX2(float *left, float *right, const float *src, size_t count) {
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 a = _mm256_loadu_ps(src + i*2);
+		__m256 b = _mm256_loadu_ps(src + i*2 + 8);
+		__m256 lo = _mm256_permute2f128_ps(a, b, 0x20);
+		__m256 hi = _mm256_permute2f128_ps(a, b, 0x31);
+		_mm256_storeu_ps(left + i, _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm256_storeu_ps(right + i, _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+	_mm256_zeroupper();
+	azaDeinterleave2SSE2(left + i, right + i, src + i*2, count - i);
+}
+
+AZA_TARGET("avx2")
+static void azaBiquadAVX2(azaBuffer buffer, const float coefficients[5], float *z1, float *z2) {
+	if (buffer.planes || buffer.channels < 8) {
+		azaBiquadSSE2(buffer, coefficients, z1, z2);
+		return;
+	}
+	const float *k = coefficients;
+	__m256 b0 = _mm256_set1_ps(k[0]), b1 = _mm256_set1_ps(k[1]), b2 = _mm256_set1_ps(k[2]);
+	__m256 a1 = _mm256_set1_ps(k[3]), a2 = _mm256_set1_ps(k[4]);
+	__m256 s1 = _mm256_loadu_ps(z1), s2 = _mm256_loadu_ps(z2);
+	for (size_t i = 0; i < buffer.frames; i++) {
+		float *p = buffer.samples + i * buffer.stride;
+		__m256 x = _mm256_loadu_ps(p);
+		__m256 y = _mm256_add_ps(_mm256_mul_ps(b0, x), s1);
+		s1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b1, x), _mm256_mul_ps(a1, y)), s2);
+		s2 = _mm256_sub_ps(_mm256_mul_ps(b2, x), _mm256_mul_ps(a2, y));
+		_mm256_storeu_ps(p, y);
+	}
+	_mm256_storeu_ps(z1, s1);
+	_mm256_storeu_ps(z2, s2);
+	if (buffer.channels > 8) {
+		buffer.samples += 8;
+		buffer.channels -= 8;
+		_mm256_zeroupper();
+		azaBiquadSSE2(buffer, coefficients, z1 + 8, z2 + 8);
+	}
+}
+
+
+AZA_TARGET("avx2")
+static void azaAmpToDbAVX2(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k) {
+	__m256 c[AZA_FASTMATH_MAX_DEGREE];
+	for (int d = 0; d < k->logDegree; d++) c[d] = _mm256_set1_ps(k->log[d]);
+	__m256 minimum = _mm256_set1_ps(FLT_MIN);
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 toDb = _mm256_set1_ps(AZA_LOG2_TO_DB);
+	__m256i mantissaMask = _mm256_set1_epi32(0x007FFFFF);
+	__m256i exponentOne = _mm256_set1_epi32(0x3F800000);
+	__m256i bias = _mm256_set1_epi32(127);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i xi = _mm256_castps_si256(_mm256_max_ps(_mm256_loadu_ps(src + i), minimum));
+		__m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(xi, 23), bias));
+		__m256 t = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(xi, mantissaMask), exponentOne)), one);
+		__m256 p = c[k->logDegree-1];
+		for (int d = k->logDegree-2; d >= 0; d--) {
+			p = _mm256_add_ps(_mm256_mul_ps(p, t), c[d]);
+		}
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_add_ps(e, _mm256_mul_ps(t, p)), toDb));
+	}
+	_mm256_zeroupper();
+	azaAmpToDbSSE2(dst + i, src + i, count - i, k);
+}
+
+AZA_TARGET("avx2")
+static void azaDbToAmpAVX2(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k) {
+	__m256 c[AZA_FASTMATH_MAX_DEGREE];
+	for (int d = 0; d < k->expDegree; d++) c[d] = _mm256_set1_ps(k->exp[d]);
+	__m256 minimum = _mm256_set1_ps(-126.0f);
+	__m256 maximum = _mm256_set1_ps(127.999f);
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 toLog2 = _mm256_set1_ps(AZA_DB_TO_LOG2);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_mul_ps(_mm256_loadu_ps(src + i), toLog2);
+		x = _mm256_min_ps(_mm256_max_ps(x, minimum), maximum);
+		__m256 nf = _mm256_floor_ps(x);
+		__m256 t = _mm256_sub_ps(x, nf);
+		__m256 p = c[k->expDegree-1];
+		for (int d = k->expDegree-2; d >= 0; d--) {
+			p = _mm256_add_ps(_mm256_mul_ps(p, t), c[d]);
+		}
+		__m256i r = _mm256_castps_si256(_mm256_add_ps(one, _mm256_mul_ps(t, p)));
+		__m256i n = _mm256_slli_epi32(_mm256_cvtps_epi32(nf), 23);
+		_mm256_storeu_ps(dst + i, _mm256_castsi256_ps(_mm256_add_epi32(r, n)));
+	}
+	_mm256_zeroupper();
+	azaDbToAmpSSE2(dst + i, src + i, count - i, k);
+}
+
+
+AZA_TARGET("avx2")
+static void azaReverbAVX2(azaReverbData *data, const float *input, float *taps, size_t frames) {
+	__m256i mask = _mm256_set1_epi32((int32_t)(data->capacity - 1));
+	__m256i delays = _mm256_loadu_si256((const __m256i*)data->lineDelays);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256 damp = _mm256_loadu_ps(data->lineDamping);
+	__m256 gain = _mm256_loadu_ps(data->lineGains);
+	__m256 lp = _mm256_loadu_ps(data->lineLowpass);
+	const __m256 sign1 = _mm256_setr_ps(1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f);
+	const __m256 sign2 = _mm256_setr_ps(1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f);
+	const __m256 sign3 = _mm256_setr_ps(1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f);
+	size_t frameMask = data->capacity - 1;
+	for (size_t i = 0; i < frames; i++) {
+		size_t index = data->index + i;
+		__m256i offsets = _mm256_and_si256(_mm256_sub_epi32(_mm256_set1_epi32((int32_t)index), delays), mask);
+		offsets = _mm256_add_epi32(_mm256_slli_epi32(offsets, 3), lanes);
+		__m256 out = _mm256_i32gather_ps(data->lines, offsets, 4);
+		_mm256_storeu_ps(taps + i * 8, out);
+		lp = _mm256_add_ps(out, _mm256_mul_ps(damp, _mm256_sub_ps(lp, out)));
+		__m256 v = _mm256_mul_ps(lp, gain);
+		v = _mm256_add_ps(_mm256_permute_ps(v, _MM_SHUFFLE(2, 3, 0, 1)), _mm256_mul_ps(v, sign1));
+		v = _mm256_add_ps(_mm256_permute_ps(v, _MM_SHUFFLE(1, 0, 3, 2)), _mm256_mul_ps(v, sign2));
+		v = _mm256_add_ps(_mm256_permute2f128_ps(v, v, 1), _mm256_mul_ps(v, sign3));
+		_mm256_storeu_ps(data->lines + (index & frameMask) * 8, _mm256_add_ps(v, _mm256_set1_ps(input[i])));
+	}
+	_mm256_storeu_ps(data->lineLowpass, lp);
+	data->index += frames;
+}
+
+
+AZA_TARGET("avx2")
+static void azaComplexMulAddAVX2(float *dst, const float *a, const float *b, size_t count) {
+	const __m256 sign = _mm256_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256 va = _mm256_loadu_ps(a + i*2);
+		__m256 vb = _mm256_loadu_ps(b + i*2);
+		__m256 bReal = _mm256_permute_ps(vb, _MM_SHUFFLE(2, 2, 0, 0));
+		__m256 bImag = _mm256_mul_ps(_mm256_permute_ps(vb, _MM_SHUFFLE(3, 3, 1, 1)), sign);
+		__m256 aSwap = _mm256_permute_ps(va, _MM_SHUFFLE(2, 3, 0, 1));
+		__m256 result = _mm256_add_ps(_mm256_mul_ps(va, bReal), _mm256_mul_ps(aSwap, bImag));
+		_mm256_storeu_ps(dst + i*2, _mm256_add_ps(_mm256_loadu_ps(dst + i*2), result));
+	}
+	_mm256_zeroupper();
+	azaComplexMulAddSSE2(dst + i*2, a + i*2, b + i*2, count - i);
+}
+
+AZA_TARGET("avx2")
+static float azaDotAVX2(const float *a, const float *b, size_t count) {
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+	}
+	sum0 = _mm256_add_ps(sum0, sum1);
+	__m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum0), _mm256_extractf128_ps(sum0, 1));
+	float sums[4];
+	_mm_storeu_ps(sums, sum);
+	_mm256_zeroupper();
+	return sums[0] + sums[1] + sums[2] + sums[3] + azaDotSSE2(a + i, b + i, count - i);
+}
+
+
+AZA_TARGET("avx2")
+static void azaFFTPassAVX2(float *x, size_t count, size_t half, const float *twiddles) {
+	const __m256 sign = _mm256_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+	for (size_t i = 0; i < count; i += half * 2) {
+		float *a = x + i * 2;
+		float *b = x + (i + half) * 2;
+		for (size_t j = 0; j < half; j += 4) {
+			__m256 w = _mm256_loadu_ps(twiddles + j*2);
+			__m256 vb = _mm256_loadu_ps(b + j*2);
+			__m256 wReal = _mm256_permute_ps(w, _MM_SHUFFLE(2, 2, 0, 0));
+			__m256 wImag = _mm256_mul_ps(_mm256_permute_ps(w, _MM_SHUFFLE(3, 3, 1, 1)), sign);
+			__m256 bSwap = _mm256_permute_ps(vb, _MM_SHUFFLE(2, 3, 0, 1));
+			__m256 v = _mm256_add_ps(_mm256_mul_ps(vb, wReal), _mm256_mul_ps(bSwap, wImag));
+			__m256 va = _mm256_loadu_ps(a + j*2);
+			_mm256_storeu_ps(a + j*2, _mm256_add_ps(va, v));
+			_mm256_storeu_ps(b + j*2, _mm256_sub_ps(va, v));
+		}
+	}
+}
+
+AZA_TARGET("avx2")
+static float azaPolyphaseAVX2(const float *src, const float *rows, size_t taps, float fraction) {
+	if (taps < 8) return azaPolyphaseSSE2(src, rows, taps, fraction);
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= taps; i += 8) {
+		__m256 x = _mm256_loadu_ps(src + i);
+		sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(x, _mm256_loadu_ps(rows + i)));
+		sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(x, _mm256_loadu_ps(rows + taps + i)));
+	}
+	__m256 sum = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_set1_ps(fraction), _mm256_sub_ps(sum1, sum0)));
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	if (i < taps) {
+		// taps is only promised to be a multiple of 4
+		__m128 x = _mm_loadu_ps(src + i);
+		__m128 tail0 = _mm_mul_ps(x, _mm_loadu_ps(rows + i));
+		__m128 tail1 = _mm_mul_ps(x, _mm_loadu_ps(rows + taps + i));
+		half = _mm_add_ps(half, _mm_add_ps(tail0, _mm_mul_ps(_mm_set1_ps(fraction), _mm_sub_ps(tail1, tail0))));
+	}
+	float sums[4];
+	_mm_storeu_ps(sums, half);
+	return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+
+
+// AVX-512
+
+
+
+AZA_TARGET("avx512f")
+static void azaMixAVX512(float *dst, float volumeDst, const float *src, float volumeSrc, size_t count) {
+	__m512 vDst = _mm512_set1_ps(volumeDst);
+	__m512 vSrc = _mm512_set1_ps(volumeSrc);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m512 a = _mm512_mul_ps(_mm512_loadu_ps(dst + i), vDst);
+		__m512 b = _mm512_mul_ps(_mm512_loadu_ps(src + i), vSrc);
+		_mm512_storeu_ps(dst + i, _mm512_add_ps(a, b));
+	}
+	if (i < count) {
+		// Masked tail instead of a scalar loop
+		__mmask16 mask = (__mmask16)((1u << (count - i)) - 1);
+		__m512 a = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, dst + i), vDst);
+		__m512 b = _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, src + i), vSrc);
+		_mm512_mask_storeu_ps(dst + i, mask, _mm512_add_ps(a, b));
+	}
+}
+
+AZA_TARGET("avx512f")
+static void azaCopyStridedAVX512(float *dst, size_t dstStride, const float *src, size_t srcStride, size_t count) {
+	if ((dstStride == 1) == (srcStride == 1) || dstStride > INT32_MAX / 16 || srcStride > INT32_MAX / 16
+	|| (dstStride == 1 && (srcStride == 2 || srcStride == 4)) || dstStride == 2) {
+		azaCopyStridedSSE2(dst, dstStride, src, srcStride, count);
+		return;
+	}
+	__m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	size_t i = 0;
+	if (dstStride == 1) {
+		__m512i index = _mm512_mullo_epi32(lanes, _mm512_set1_epi32((int)srcStride));
+		for (; i + 16 <= count; i += 16) {
+			_mm512_storeu_ps(dst + i, _mm512_i32gather_ps(index, src + i * srcStride, 4));
+		}
+	} else {
+		__m512i index = _mm512_mullo_epi32(lanes, _mm512_set1_epi32((int)dstStride));
+		for (; i + 16 <= count; i += 16) {
+			_mm512_i32scatter_ps(dst + i * dstStride, index, _mm512_loadu_ps(src + i), 4);
+		}
+	}
+	_mm256_zeroupper();
+	azaCopyStridedScalar(dst + i * dstStride, dstStride, src + i * srcStride, srcStride, count - i);
+}
+
+AZA_TARGET("avx512f")
+static void azaCubicLimiterAVX512(float *samples, size_t count) {
+	__m512 one = _mm512_set1_ps(1.0f);
+	__m512 minusOne = _mm512_set1_ps(-1.0f);
+	__m512 a = _mm512_set1_ps(1.5f);
+	__m512 b = _mm512_set1_ps(0.5f);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m512 x = _mm512_loadu_ps(samples + i);
+		x = _mm512_min_ps(_mm512_max_ps(x, minusOne), one);
+		__m512 x3 = _mm512_mul_ps(_mm512_mul_ps(x, x), x);
+		_mm512_storeu_ps(samples + i, _mm512_sub_ps(_mm512_mul_ps(a, x), _mm512_mul_ps(b, x3)));
+	}
+	azaCubicLimiterAVX2(samples + i, count - i);
+}
+
+#endif // AZA_SIMD_X86
+
+
+
+#if AZA_SIMD_NEON
+
+// NEON
+
+
+
+static void azaMixNEON(float *dst, float volumeDst, const float *src, float volumeSrc, size_t count) {
+	float32x4_t vDst = vdupq_n_f32(volumeDst);
+	float32x4_t vSrc = vdupq_n_f32(volumeSrc);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		float32x4_t a0 = vmulq_f32(vld1q_f32(dst + i), vDst);
+		float32x4_t a1 = vmulq_f32(vld1q_f32(dst + i + 4), vDst);
+		float32x4_t b0 = vmulq_f32(vld1q_f32(src + i), vSrc);
+		float32x4_t b1 = vmulq_f32(vld1q_f32(src + i + 4), vSrc);
+		vst1q_f32(dst + i, vaddq_f32(a0, b0));
+		vst1q_f32(dst + i + 4, vaddq_f32(a1, b1));
+	}
+	azaMixScalar(dst + i, volumeDst, src + i, volumeSrc, count - i);
+}
+
+static void azaCopyStridedNEON(float *dst, size_t dstStride, const float *src, size_t srcStride, size_t count) {
+	size_t i = 0;
+	// Same as SSE2, the vectors reach past the last sample of the channel
+	if (dstStride == 1 && srcStride == 2) {
+		for (; i + 5 <= count; i += 4) {
+			vst1q_f32(dst + i, vld2q_f32(src + i * 2).val[0]);
+		}
+	} else if (dstStride == 2 && srcStride == 1) {
+		for (; i + 5 <= count; i += 4) {
+			float32x4x2_t pair = vld2q_f32(dst + i * 2);
+			pair.val[0] = vld1q_f32(src + i);
+			vst2q_f32(dst + i * 2, pair);
+		}
+	} else {
+		azaCopyStridedScalar(dst, dstStride, src, srcStride, count);
+		return;
+	}
+	azaCopyStridedScalar(dst + i * dstStride, dstStride, src + i * srcStride, srcStride, count - i);
+}
+
+static void azaCubicLimiterNEON(float *samples, size_t count) {
+	float32x4_t one = vdupq_n_f32(1.0f);
+	float32x4_t minusOne = vdupq_n_f32(-1.0f);
+	float32x4_t a = vdupq_n_f32(1.5f);
+	float32x4_t b = vdupq_n_f32(0.5f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t x = vld1q_f32(samples + i);
+		x = vminq_f32(vmaxq_f32(x, minusOne), one);
+		float32x4_t x3 = vmulq_f32(vmulq_f32(x, x), x);
+		vst1q_f32(samples + i, vsubq_f32(vmulq_f32(a, x), vmulq_f32(b, x3)));
+	}
+	azaCubicLimiterScalar(samples + i, count - i);
+}
+
+static void azaInterleave2NEON(float *dst, const float *left, const float *right, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float32x4x2_t pair;
+		pair.val[0] = vld1q_f32(left + i);
+		pair.val[1] = vld1q_f32(right + i);
+		vst2q_f32(dst + i*2, pair);
+	}
+	azaInterleave2Scalar(dst + i*2, left + i, right + i, count - i);
+}
+
+static void azaDeinterleave2NEON(float *left, float *right, const float *src, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float32x4x2_t pair = vld2q_f32(src + i*2);
+		vst1q_f32(left + i, pair.val[0]);
+		vst1q_f32(right + i, pair.val[1]);
+	}
+	azaDeinterleave2Scalar(left + i, right + i, src + i*2, count - i);
+}
+
+static void azaBiquadNEON(azaBuffer buffer, const float coefficients[5], float *z1, float *z2) {
+	size_t c = 0;
+	if (!buffer.planes) {
+		const float *k = coefficients;
+		float32x4_t b0 = vdupq_n_f32(k[0]), b1 = vdupq_n_f32(k[1]), b2 = vdupq_n_f32(k[2]);
+		float32x4_t a1 = vdupq_n_f32(k[3]), a2 = vdupq_n_f32(k[4]);
+		for (; c + 4 <= buffer.channels; c += 4) {
+			float32x4_t s1 = vld1q_f32(z1 + c), s2 = vld1q_f32(z2 + c);
+			for (size_t i = 0; i < buffer.frames; i++) {
+				float *p = buffer.samples + i * buffer.stride + c;
+				float32x4_t x = vld1q_f32(p);
+				float32x4_t y = vaddq_f32(vmulq_f32(b0, x), s1);
+				s1 = vaddq_f32(vsubq_f32(vmulq_f32(b1, x), vmulq_f32(a1, y)), s2);
+				s2 = vsubq_f32(vmulq_f32(b2, x), vmulq_f32(a2, y));
+				vst1q_f32(p, y);
+			}
+			vst1q_f32(z1 + c, s1);
+			vst1q_f32(z2 + c, s2);
+		}
+	}
+	for (; c < buffer.channels; c++) {
+		azaBiquadChannelScalar(azaBufferChannelSamples(buffer, c), buffer.stride, buffer.frames, coefficients, &z1[c], &z2[c]);
+	}
+}
+
+static void azaAmpToDbNEON(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k) {
+	float32x4_t c[AZA_FASTMATH_MAX_DEGREE];
+	for (int d = 0; d < k->logDegree; d++) c[d] = vdupq_n_f32(k->log[d]);
+	float32x4_t minimum = vdupq_n_f32(FLT_MIN);
+	float32x4_t one = vdupq_n_f32(1.0f);
+	uint32x4_t mantissaMask = vdupq_n_u32(0x007FFFFF);
+	uint32x4_t exponentOne = vdupq_n_u32(0x3F800000);
+	int32x4_t bias = vdupq_n_s32(127);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t x = vld1q_f32(src + i);
+		// vmaxq propagates NaNs, so select instead
+		x = vbslq_f32(vcgeq_f32(x, minimum), x, minimum);
+		uint32x4_t xi = vreinterpretq_u32_f32(x);
+		float32x4_t e = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(xi, 23)), bias));
+		float32x4_t t = vsubq_f32(vreinterpretq_f32_u32(vorrq_u32(vandq_u32(xi, mantissaMask), exponentOne)), one);
+		float32x4_t p = c[k->logDegree-1];
+		for (int d = k->logDegree-2; d >= 0; d--) {
+			p = vaddq_f32(vmulq_f32(p, t), c[d]);
+		}
+		vst1q_f32(dst + i, vmulq_n_f32(vaddq_f32(e, vmulq_f32(t, p)), AZA_LOG2_TO_DB));
+	}
+	azaAmpToDbScalar(dst + i, src + i, count - i, k);
+}
+
+static void azaDbToAmpNEON(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k) {
+	float32x4_t c[AZA_FASTMATH_MAX_DEGREE];
+	for (int d = 0; d < k->expDegree; d++) c[d] = vdupq_n_f32(k->exp[d]);
+	float32x4_t minimum = vdupq_n_f32(-126.0f);
+	float32x4_t maximum = vdupq_n_f32(127.999f);
+	float32x4_t one = vdupq_n_f32(1.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t x = vmulq_n_f32(vld1q_f32(src + i), AZA_DB_TO_LOG2);
+		x = vbslq_f32(vcgeq_f32(x, minimum), x, minimum);
+		x = vminq_f32(x, maximum);
+		int32x4_t n = vcvtq_s32_f32(x);
+		float32x4_t nf = vcvtq_f32_s32(n);
+		uint32x4_t over = vcgtq_f32(nf, x);
+		n = vaddq_s32(n, vreinterpretq_s32_u32(over));
+		nf = vsubq_f32(nf, vreinterpretq_f32_u32(vandq_u32(over, vreinterpretq_u32_f32(one))));
+		float32x4_t t = vsubq_f32(x, nf);
+		float32x4_t p = c[k->expDegree-1];
+		for (int d = k->expDegree-2; d >= 0; d--) {
+			p = vaddq_f32(vmulq_f32(p, t), c[d]);
+		}
+		int32x4_t r = vreinterpretq_s32_f32(vaddq_f32(one, vmulq_f32(t, p)));
+		vst1q_f32(dst + i, vreinterpretq_f32_s32(vaddq_s32(r, vshlq_n_s32(n, 23))));
+	}
+	azaDbToAmpScalar(dst + i, src + i, count - i, k);
+}
+
+static void azaReverbNEON(azaReverbData *data, const float *input, float *taps, size_t frames) {
+	size_t mask = data->capacity - 1;
+	const float *lines = data->lines;
+	const int32_t *d = data->lineDelays;
+	float32x4_t damp0 = vld1q_f32(data->lineDamping), damp1 = vld1q_f32(data->lineDamping + 4);
+	float32x4_t gain0 = vld1q_f32(data->lineGains), gain1 = vld1q_f32(data->lineGains + 4);
+	float32x4_t lp0 = vld1q_f32(data->lineLowpass), lp1 = vld1q_f32(data->lineLowpass + 4);
+	const float sign1Values[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+	const float sign2Values[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
+	float32x4_t sign1 = vld1q_f32(sign1Values), sign2 = vld1q_f32(sign2Values);
+	for (size_t i = 0; i < frames; i++) {
+		size_t index = data->index + i;
+		float *tap = taps + i * 8;
+		for (int j = 0; j < 8; j++) {
+			tap[j] = lines[((index - d[j]) & mask) * 8 + j];
+		}
+		float32x4_t out0 = vld1q_f32(tap), out1 = vld1q_f32(tap + 4);
+		lp0 = vmlaq_f32(out0, damp0, vsubq_f32(lp0, out0));
+		lp1 = vmlaq_f32(out1, damp1, vsubq_f32(lp1, out1));
+		float32x4_t v0 = vmulq_f32(lp0, gain0);
+		float32x4_t v1 = vmulq_f32(lp1, gain1);
+		v0 = vmlaq_f32(vrev64q_f32(v0), v0, sign1);
+		v1 = vmlaq_f32(vrev64q_f32(v1), v1, sign1);
+		v0 = vmlaq_f32(vcombine_f32(vget_high_f32(v0), vget_low_f32(v0)), v0, sign2);
+		v1 = vmlaq_f32(vcombine_f32(vget_high_f32(v1), vget_low_f32(v1)), v1, sign2);
+		float32x4_t x = vdupq_n_f32(input[i]);
+		float *dst = data->lines + (index & mask) * 8;
+		vst1q_f32(dst, vaddq_f32(vaddq_f32(v0, v1), x));
+		vst1q_f32(dst + 4, vaddq_f32(vsubq_f32(v0, v1), x));
+	}
+	vst1q_f32(data->lineLowpass, lp0);
+	vst1q_f32(data->lineLowpass + 4, lp1);
+	data->index += frames;
+}
+
+static void azaComplexMulAddNEON(float *dst, const float *a, const float *b, size_t count) {
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float32x4x2_t va = vld2q_f32(a + i*2);
+		float32x4x2_t vb = vld2q_f32(b + i*2);
+		float32x4x2_t vd = vld2q_f32(dst + i*2);
+		vd.val[0] = vmlsq_f32(vmlaq_f32(vd.val[0], va.val[0], vb.val[0]), va.val[1], vb.val[1]);
+		vd.val[1] = vmlaq_f32(vmlaq_f32(vd.val[1], va.val[0], vb.val[1]), va.val[1], vb.val[0]);
+		vst2q_f32(dst + i*2, vd);
+	}
+	azaComplexMulAddScalar(dst + i*2, a + i*2, b + i*2, count - i);
+}
+
+static float azaDotNEON(const float *a, const float *b, size_t count) {
+	float32x4_t sum0 = vdupq_n_f32(0.0f), sum1 = vdupq_n_f32(0.0f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+		sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+	}
+	float sums[4];
+	vst1q_f32(sums, vaddq_f32(sum0, sum1));
+	return sums[0] + sums[1] + sums[2] + sums[3] + azaDotScalar(a + i, b + i, count - i);
+}
+
+static void azaFFTPassNEON(float *x, size_t count, size_t half, const float *twiddles) {
+	for (size_t i = 0; i < count; i += half * 2) {
+		float *a = x + i * 2;
+		float *b = x + (i + half) * 2;
+		for (size_t j = 0; j < half; j += 4) {
+			float32x4x2_t w = vld2q_f32(twiddles + j*2);
+			float32x4x2_t vb = vld2q_f32(b + j*2);
+			float32x4x2_t va = vld2q_f32(a + j*2);
+			float32x4_t vr = vmlsq_f32(vmulq_f32(vb.val[0], w.val[0]), vb.val[1], w.val[1]);
+			float32x4_t vi = vmlaq_f32(vmulq_f32(vb.val[0], w.val[1]), vb.val[1], w.val[0]);
+			float32x4x2_t outA, outB;
+			outA.val[0] = vaddq_f32(va.val[0], vr);
+			outA.val[1] = vaddq_f32(va.val[1], vi);
+			outB.val[0] = vsubq_f32(va.val[0], vr);
+			outB.val[1] = vsubq_f32(va.val[1], vi);
+			vst2q_f32(a + j*2, outA);
+			vst2q_f32(b + j*2, outB);
+		}
+	}
+}
+
+static float azaPolyphaseNEON(const float *src, const float *rows, size_t taps, float fraction) {
+	float32x4_t sum0 = vdupq_n_f32(0.0f), sum1 = vdupq_n_f32(0.0f);
+	for (size_t i = 0; i < taps; i += 4) {
+		float32x4_t x = vld1q_f32(src + i);
+		sum0 = vmlaq_f32(sum0, x, vld1q_f32(rows + i));
+		sum1 = vmlaq_f32(sum1, x, vld1q_f32(rows + taps + i));
+	}
+	float32x4_t sum = vmlaq_n_f32(sum0, vsubq_f32(sum1, sum0), fraction);
+	float sums[4];
+	vst1q_f32(sums, sum);
+	return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+#endif // AZA_SIMD_NEON
+
+
+
+// Dispatch
+
+
+
+static const azaKernelTable kernelsScalar = {
+	.mix = azaMixScalar,
+	.copyStrided = azaCopyStridedScalar,
+	.cubicLimiter = azaCubicLimiterScalar,
+	.interleave2 = azaInterleave2Scalar,
+	.deinterleave2 = azaDeinterleave2Scalar,
+	.biquad = azaBiquadScalar,
+	.ampToDb = azaAmpToDbScalar,
+	.dbToAmp = azaDbToAmpScalar,
+	.reverb = azaReverbScalar,
+	.complexMulAdd = azaComplexMulAddScalar,
+	.dot = azaDotScalar,
+	.fftPass = azaFFTPassScalar,
+	.polyphase = azaPolyphaseScalar,
+};
+
+#if AZA_SIMD_X86
+static const azaKernelTable kernelsSSE2 = {
+	.mix = azaMixSSE2,
+	.copyStrided = azaCopyStridedSSE2,
+	.cubicLimiter = azaCubicLimiterSSE2,
+	.interleave2 = azaInterleave2SSE2,
+	.deinterleave2 = azaDeinterleave2SSE2,
+	.biquad = azaBiquadSSE2,
+	.ampToDb = azaAmpToDbSSE2,
+	.dbToAmp = azaDbToAmpSSE2,
+	.reverb = azaReverbSSE2,
+	.complexMulAdd = azaComplexMulAddSSE2,
+	.dot = azaDotSSE2,
+	.fftPass = azaFFTPassSSE2,
+	.polyphase = azaPolyphaseSSE2,
+};
+
+static const azaKernelTable kernelsAVX2 = {
+	.mix = azaMixAVX2,
+	.copyStrided = azaCopyStridedAVX2,
+	.cubicLimiter = azaCubicLimiterAVX2,
+	.interleave2 = azaInterleave2AVX2,
+	.deinterleave2 = azaDeinterleave2AVX2,
+	.biquad = azaBiquadAVX2,
+	.ampToDb = azaAmpToDbAVX2,
+	.dbToAmp = azaDbToAmpAVX2,
+	.reverb = azaReverbAVX2,
+	.complexMulAdd = azaComplexMulAddAVX2,
+	.dot = azaDotAVX2,
+	.fftPass = azaFFTPassAVX2,
+	.polyphase = azaPolyphaseAVX2,
+};
+
+static const azaKernelTable kernelsAVX512 = {
+	.mix = azaMixAVX512,
+	.copyStrided = azaCopyStridedAVX512,
+	.cubicLimiter = azaCubicLimiterAVX512,
+	.interleave2 = azaInterleave2AVX2,
+	.deinterleave2 = azaDeinterleave2AVX2,
+	.biquad = azaBiquadAVX2,
+	.ampToDb = azaAmpToDbAVX2,
+	.dbToAmp = azaDbToAmpAVX2,
+	.reverb = azaReverbAVX2,
+	.complexMulAdd = azaComplexMulAddAVX2,
+	.dot = azaDotAVX2,
+	.fftPass = azaFFTPassAVX2,
+	.polyphase = azaPolyphaseAVX2,
+};
+#endif
+
+#if AZA_SIMD_NEON
+static const azaKernelTable kernelsNEON = {
+	.mix = azaMixNEON,
+	.copyStrided = azaCopyStridedNEON,
+	.cubicLimiter = azaCubicLimiterNEON,
+	.interleave2 = azaInterleave2NEON,
+	.deinterleave2 = azaDeinterleave2NEON,
+	.biquad = azaBiquadNEON,
+	.ampToDb = azaAmpToDbNEON,
+	.dbToAmp = azaDbToAmpNEON,
+	.reverb = azaReverbNEON,
+	.complexMulAdd = azaComplexMulAddNEON,
+	.dot = azaDotNEON,
+	.fftPass = azaFFTPassNEON,
+	.polyphase = azaPolyphaseNEON,
+};
+#endif
+
+// Usable without azaInit, just not the fastest
+azaKernelTable azaKernel = {
+	.mix = azaMixScalar,
+	.copyStrided = azaCopyStridedScalar,
+	.cubicLimiter = azaCubicLimiterScalar,
+	.interleave2 = azaInterleave2Scalar,
+	.deinterleave2 = azaDeinterleave2Scalar,
+	.biquad = azaBiquadScalar,
+	.ampToDb = azaAmpToDbScalar,
+	.dbToAmp = azaDbToAmpScalar,
+	.reverb = azaReverbScalar,
+	.complexMulAdd = azaComplexMulAddScalar,
+	.dot = azaDotScalar,
+	.fftPass = azaFFTPassScalar,
+	.polyphase = azaPolyphaseScalar,
+};
+
+static azaSIMDLevel simdLevel = AZA_SIMD_LEVEL_SCALAR;
+
+azaSIMDLevel azaGetSIMDLevelSupported() {
+#if AZA_SIMD_X86 && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return AZA_SIMD_LEVEL_AVX512;
+	if (__builtin_cpu_supports("avx2")) return AZA_SIMD_LEVEL_AVX2;
+	if (__builtin_cpu_supports("sse2")) return AZA_SIMD_LEVEL_SSE2;
+#elif AZA_SIMD_NEON
+	return AZA_SIMD_LEVEL_NEON;
+#endif
+	return AZA_SIMD_LEVEL_SCALAR;
+}
+
+azaSIMDLevel azaGetSIMDLevel() {
+	return simdLevel;
+}
+
+int azaSetSIMDLevel(azaSIMDLevel level) {
+	azaSIMDLevel supported = azaGetSIMDLevelSupported();
+	if (level != AZA_SIMD_LEVEL_SCALAR) {
+		if (supported == AZA_SIMD_LEVEL_NEON && level != AZA_SIMD_LEVEL_NEON) {
+			return AZA_ERROR_INVALID_CONFIGURATION;
+		}
+		if (supported != AZA_SIMD_LEVEL_NEON && (level == AZA_SIMD_LEVEL_NEON || level > supported)) {
+			return AZA_ERROR_INVALID_CONFIGURATION;
+		}
+	}
+	switch (level) {
+		case AZA_SIMD_LEVEL_SCALAR: azaKernel = kernelsScalar; break;
+#if AZA_SIMD_X86
+		case AZA_SIMD_LEVEL_SSE2: azaKernel = kernelsSSE2; break;
+		case AZA_SIMD_LEVEL_AVX2: azaKernel = kernelsAVX2; break;
+		case AZA_SIMD_LEVEL_AVX512: azaKernel = kernelsAVX512; break;
+#endif
+#if AZA_SIMD_NEON
+		case AZA_SIMD_LEVEL_NEON: azaKernel = kernelsNEON; break;
+#endif
+		default: return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+	simdLevel = level;
+	return AZA_SUCCESS;
+}
+
+#if AZA_SIMD_NEON && defined(__aarch64__)
+#define AZA_FPCR_FZ (1u << 24)
+#elif AZA_SIMD_NEON
+#define AZA_FPSCR_FZ (1u << 24)
+#endif
+
+uint32_t azaFlushDenormalsBegin() {
+#if AZA_SIMD_X86
+	// FTZ flushes denormal results, DAZ treats denormal inputs as zero
+	uint32_t previous = _mm_getcsr();
+	_mm_setcsr(previous | 0x8040);
+	return previous;
+#elif defined(AZA_FPCR_FZ)
+	uint64_t fpcr;
+	__asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+	__asm__ volatile("msr fpcr, %0" : : "r"(fpcr | AZA_FPCR_FZ));
+	return (uint32_t)fpcr;
+#elif defined(AZA_FPSCR_FZ)
+	uint32_t fpscr;
+	__asm__ volatile("vmrs %0, fpscr" : "=r"(fpscr));
+	__asm__ volatile("vmsr fpscr, %0" : : "r"(fpscr | AZA_FPSCR_FZ));
+	return fpscr;
+#else
+	return 0;
+#endif
+}
+
+void azaFlushDenormalsEnd(uint32_t previous) {
+#if AZA_SIMD_X86
+	_mm_setcsr(previous);
+#elif defined(AZA_FPCR_FZ)
+	uint64_t fpcr = previous;
+	__asm__ volatile("msr fpcr, %0" : : "r"(fpcr));
+#elif defined(AZA_FPSCR_FZ)
+	__asm__ volatile("vmsr fpscr, %0" : : "r"(previous));
+#else
+	(void)previous;
+#endif
+}
+
+void azaSIMDInit() {
+	azaSetSIMDLevel(azaGetSIMDLevelSupported());
+}
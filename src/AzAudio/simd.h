@@ -0,0 +1,71 @@
+/*
+	File: simd.h
+	Author: Philip Haynes
+	Runtime-dispatched SIMD kernels for the hot loops in dsp.c. Not to be included in headers.
+*/
+
+#ifndef AZAUDIO_SIMD_H
+#define AZAUDIO_SIMD_H
+
+#include "dsp.h"
+#include "fastmath.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define AZA_SIMD_X86 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AZA_SIMD_NEON 1
+#endif
+
+// Every kernel has a scalar version, so the table is always fully populated.
+typedef struct azaKernelTable {
+	// dst[i] = dst[i] * volumeDst + src[i] * volumeSrc
+	void (*mix)(float *dst, float volumeDst, const float *src, float volumeSrc, size_t count);
+	// dst[i * dstStride] = src[i * srcStride]
+	void (*copyStrided)(float *dst, size_t dstStride, const float *src, size_t srcStride, size_t count);
+	// samples[i] = 1.5x - 0.5x^3 where x is samples[i] clamped to [-1, 1]
+	void (*cubicLimiter)(float *samples, size_t count);
+	// dst[i*2] = left[i], dst[i*2+1] = right[i]
+	void (*interleave2)(float *dst, const float *left, const float *right, size_t count);
+	// left[i] = src[i*2], right[i] = src[i*2+1]
+	void (*deinterleave2)(float *left, float *right, const float *src, size_t count);
+	// Transposed direct form II biquad over every channel of buffer, with state z1[c] and z2[c] for each channel c
+	// coefficients are b0, b1, b2, a1, a2
+	void (*biquad)(azaBuffer buffer, const float coefficients[5], float *z1, float *z2);
+	// dst[i] = 20 * log10(src[i]) using polynomial approximations, dst may be src
+	void (*ampToDb)(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k);
+	// dst[i] = 10 ^ (src[i] / 20) using polynomial approximations, dst may be src
+	void (*dbToAmp)(float *dst, const float *src, size_t count, const azaFastMathCoefficients *k);
+	// Runs the reverb tank for frames samples of mono input, writing the AZAUDIO_REVERB_LINES line outputs of each frame interleaved into taps.
+	// Each line's output is damped, scaled by its gain, mixed with the others by a Hadamard matrix and fed back with the input added.
+	void (*reverb)(azaReverbData *data, const float *input, float *taps, size_t frames);
+	// dst[i] += a[i] * b[i] for count complex values, interleaved real and imaginary
+	void (*complexMulAdd)(float *dst, const float *a, const float *b, size_t count);
+	// returns the sum of a[i] * b[i]
+	float (*dot)(const float *a, const float *b, size_t count);
+	// One radix-2 pass of an in-place FFT over count interleaved complex values, combining every two runs of half values using twiddles[0..half)
+	// half is at least 4
+	void (*fftPass)(float *x, size_t count, size_t half, const float *twiddles);
+	// returns the sum of src[i] * (rows[i] + fraction * (rows[taps+i] - rows[i])), blending two adjacent rows of a polyphase filter
+	// taps is a multiple of 4
+	float (*polyphase)(const float *src, const float *rows, size_t taps, float fraction);
+} azaKernelTable;
+
+// The kernels chosen by azaSIMDInit (or azaSetSIMDLevel)
+extern azaKernelTable azaKernel;
+
+// Detects the CPU features and picks the best kernels. Called by azaInit.
+void azaSIMDInit();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AZAUDIO_SIMD_H
@@ -0,0 +1,38 @@
+/*
+	File: bench.h
+	Author: Philip Haynes
+	Shared helpers for the benchmark program.
+*/
+
+#ifndef AZAUDIO_BENCH_H
+#define AZAUDIO_BENCH_H
+
+#include <stddef.h>
+
+// Seconds from an arbitrary point, monotonic
+double benchNow();
+
+// Calls fn(userData) repeatedly for at least minSeconds and returns the average seconds per call
+double benchTime(void (*fn)(void *userData), void *userData, double minSeconds);
+
+// Fills samples with noise from a fixed seed so every run sees the same input
+void benchNoise(float *samples, size_t count, unsigned seed);
+
+// Adds a result to the report written with --json. params are members to add to its JSON object, such as "\"channels\": 2".
+void benchRecord(const char *bench, const char *name, const char *params, double nsPerSample, double realtimePercent);
+
+// Marks a check as failed, which makes the program exit with 1 once everything has run
+void benchFail();
+
+void benchFFT();
+void benchVoices();
+void benchGraph();
+void benchDenormals();
+void benchDSP();
+
+void checkSIMD();
+void checkLimiter();
+void checkFFT();
+void checkCommands();
+
+#endif // AZAUDIO_BENCH_H
@@ -0,0 +1,116 @@
+/*
+	File: bench_denormals.c
+	Author: Philip Haynes
+	What the feedback effects cost while their tails fade out after an impulse, compared to while they're fed noise.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/dsp.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_DENORMALS_SAMPLERATE 48000
+#define BENCH_DENORMALS_BLOCK 256
+// Long enough for every tail to have sunk past the smallest normal float
+#define BENCH_DENORMALS_SECONDS 40
+
+typedef struct benchDenormalsData {
+	azaBuffer buffer;
+	// Copied into buffer before every block, since processing in place would feed the output back in
+	float input[BENCH_DENORMALS_BLOCK * 2];
+	azaDelayData delay[2];
+	azaReverbData reverb;
+	azaFilterData filter[2];
+	azaBiquadData biquad;
+} benchDenormalsData;
+
+static void benchDenormalsInit(benchDenormalsData *data) {
+	for (int c = 0; c < 2; c++) {
+		azaDelayData *delay = &data->delay[c];
+		memset(delay, 0, sizeof(*delay));
+		delay->gain = -6.0f;
+		delay->gainDry = 0.0f;
+		// Like the demo in main.cpp, but short so it fades out within the run
+		delay->delay = 5.0f + (float)c;
+		delay->feedback = 0.98f;
+		azaDelayDataInit(delay);
+		azaFilterDataInit(&data->filter[c]);
+		data->filter[c].kind = AZA_FILTER_LOW_PASS;
+		data->filter[c].frequency = 2000.0f;
+		data->filter[c].dryMix = 0.0f;
+	}
+	memset(&data->reverb, 0, sizeof(data->reverb));
+	data->reverb.gain = -12.0f;
+	data->reverb.gainDry = 0.0f;
+	data->reverb.roomsize = 1.0f;
+	data->reverb.color = 1.0f;
+	data->reverb.delay = 10.0f;
+	azaReverbDataInit(&data->reverb);
+	azaBiquadDataInit(&data->biquad);
+	data->biquad.kind = AZA_BIQUAD_LOW_PASS;
+	data->biquad.frequency = 4000.0f;
+	data->biquad.q = 0.7071f;
+	data->delay[0].header.pNext = &data->reverb.header;
+	data->reverb.header.pNext = &data->filter[0].header;
+	data->filter[0].header.pNext = &data->biquad.header;
+}
+
+static void benchDenormalsDeinit(benchDenormalsData *data) {
+	for (int c = 0; c < 2; c++) {
+		azaDelayDataDeinit(&data->delay[c]);
+	}
+	azaReverbDataDeinit(&data->reverb);
+}
+
+static void benchDenormalsBlock(void *userData) {
+	benchDenormalsData *data = userData;
+	memcpy(data->buffer.samples, data->input, sizeof(data->input));
+	azaDSP(data->buffer, &data->delay[0].header);
+}
+
+// Runs the chain on noise, then on an impulse followed by silence, printing the seconds per block of noise and the worst second of the tail
+static void benchDenormalsRun(benchDenormalsData *data, const char *name) {
+	benchDenormalsInit(data);
+	benchNoise(data->input, BENCH_DENORMALS_BLOCK * 2, 1);
+	double noise = benchTime(benchDenormalsBlock, data, 0.2);
+	memset(data->input, 0, sizeof(data->input));
+	data->input[0] = data->input[1] = 1.0f;
+	size_t blocksPerSecond = BENCH_DENORMALS_SAMPLERATE / BENCH_DENORMALS_BLOCK;
+	double worst = 0.0;
+	size_t worstSecond = 0;
+	for (size_t second = 0; second < BENCH_DENORMALS_SECONDS; second++) {
+		double start = benchNow();
+		for (size_t i = 0; i < blocksPerSecond; i++) {
+			benchDenormalsBlock(data);
+			// Nothing but what the tails feed back from here on
+			data->input[0] = data->input[1] = 0.0f;
+		}
+		double seconds = (benchNow() - start) / (double)blocksPerSecond;
+		if (seconds > worst) {
+			worst = seconds;
+			worstSecond = second;
+		}
+	}
+	printf("%14s %12.2f %12.2f %8zu %10.2f\n", name, noise * 1e6, worst * 1e6, worstSecond, worst / noise);
+	benchDenormalsDeinit(data);
+}
+
+void benchDenormals() {
+	static benchDenormalsData data;
+	data.buffer = (azaBuffer) {
+		.frames = BENCH_DENORMALS_BLOCK,
+		.channels = 2,
+		.samplerate = BENCH_DENORMALS_SAMPLERATE,
+	};
+	azaBufferInit(&data.buffer);
+	printf("delay (0.98 feedback) -> reverb -> filter -> biquad, %d frame stereo blocks, %ds of tail\n", BENCH_DENORMALS_BLOCK, BENCH_DENORMALS_SECONDS);
+	printf("%14s %12s %12s %8s %10s\n", "mode", "noise us", "tail us", "at (s)", "tail/noise");
+	// Only the DSP's own flushing and offsets, as on CPUs without a flush mode
+	benchDenormalsRun(&data, "software");
+	uint32_t previous = azaFlushDenormalsBegin();
+	benchDenormalsRun(&data, "ftz+daz");
+	azaFlushDenormalsEnd(previous);
+	azaBufferDeinit(&data.buffer);
+}
@@ -0,0 +1,590 @@
+/*
+	File: bench_dsp.c
+	Author: Philip Haynes
+	Throughput of every DSP processor and buffer operation across channel counts, block sizes and buffer layouts,
+	plus a check that the SIMD kernels match the scalar ones.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/dsp.h"
+#include "AzAudio/error.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_DSP_SAMPLERATE 48000
+#define BENCH_DSP_MAX_CHANNELS 8
+#define BENCH_DSP_MAX_FRAMES 4096
+// Per measurement, which adds up to around 15 seconds for the whole matrix
+#define BENCH_DSP_SECONDS 0.01
+// What the SIMD check runs, from freshly initialized state
+#define BENCH_DSP_CHECK_FRAMES 512
+#define BENCH_DSP_CHECK_BLOCKS 16
+// SIMD results further than this from scalar ones (relative to the peak) are reported as failures
+#define BENCH_DSP_CHECK_DB -80.0
+
+static const size_t benchDSPChannels[] = { 1, 2, 6, 8 };
+static const size_t benchDSPFrames[] = { 32, 128, 512, 4096 };
+#define BENCH_DSP_CHANNEL_COUNTS (sizeof(benchDSPChannels) / sizeof(benchDSPChannels[0]))
+#define BENCH_DSP_FRAME_COUNTS (sizeof(benchDSPFrames) / sizeof(benchDSPFrames[0]))
+
+typedef enum benchDSPLayout {
+	BENCH_DSP_INTERLEAVED=0,
+	BENCH_DSP_PLANAR,
+	// Interleaved with as many unused channels as used ones, like processing part of a bigger buffer
+	BENCH_DSP_STRIDED,
+	BENCH_DSP_LAYOUT_COUNT,
+} benchDSPLayout;
+
+static const char *benchDSPLayoutNames[BENCH_DSP_LAYOUT_COUNT] = {
+	"interleaved",
+	"planar",
+	"strided",
+};
+
+typedef enum benchDSPKind {
+	BENCH_DSP_BUFFER_MIX=0,
+	BENCH_DSP_BUFFER_COPY_CHANNEL,
+	BENCH_DSP_BUFFER_COPY,
+	BENCH_DSP_CUBIC_LIMITER,
+	BENCH_DSP_RMS,
+	BENCH_DSP_RMS_DECIMATED,
+	BENCH_DSP_FILTER_LOW_PASS,
+	BENCH_DSP_FILTER_BAND_PASS,
+	BENCH_DSP_BIQUAD_LOW_PASS,
+	BENCH_DSP_BIQUAD_PEAKING,
+	BENCH_DSP_LOOKAHEAD_LIMITER,
+	BENCH_DSP_LOOKAHEAD_LIMITER_LINKED,
+	BENCH_DSP_COMPRESSOR,
+	BENCH_DSP_COMPRESSOR_LINKED,
+	BENCH_DSP_GATE,
+	BENCH_DSP_GATE_LINKED,
+	BENCH_DSP_DELAY,
+	BENCH_DSP_DELAY_WET_FILTER,
+	BENCH_DSP_REVERB,
+	BENCH_DSP_REVERB_LARGE,
+	BENCH_DSP_SAMPLER,
+	BENCH_DSP_SAMPLER_PITCHED,
+	BENCH_DSP_CONVOLUTION,
+	BENCH_DSP_VOICE_POOL,
+	BENCH_DSP_KIND_COUNT,
+} benchDSPKind;
+
+typedef struct benchDSPCase {
+	const char *name;
+	// The parameters that set this case apart, for the report
+	const char *regime;
+} benchDSPCase;
+
+static const benchDSPCase benchDSPCases[BENCH_DSP_KIND_COUNT] = {
+	{ "azaBufferMix", "0.5 + 0.5" },
+	{ "azaBufferCopyChannel", "every channel from the next one" },
+	{ "azaBufferCopy", "from interleaved" },
+	{ "azaCubicLimiter", "" },
+	{ "azaRms", "default window" },
+	{ "azaRms", "decimation 16" },
+	{ "azaFilter", "low pass 2kHz" },
+	{ "azaFilter", "band pass 1kHz" },
+	{ "azaBiquad", "low pass 4kHz" },
+	{ "azaBiquad", "peaking 1kHz +6dB" },
+	{ "azaLookaheadLimiter", "unlinked" },
+	{ "azaLookaheadLimiter", "linked" },
+	{ "azaCompressor", "4:1 at -12dB" },
+	{ "azaCompressor", "linked 4:1 at -12dB" },
+	{ "azaGate", "-20dB" },
+	{ "azaGate", "linked -20dB" },
+	{ "azaDelay", "250ms 0.5 feedback" },
+	{ "azaDelay", "250ms with a wet filter" },
+	{ "azaReverb", "roomsize 5" },
+	{ "azaReverb", "roomsize 50" },
+	{ "azaSampler", "speed 1" },
+	{ "azaSampler", "speed 0.77, 16 taps" },
+	{ "azaConvolution", "1s impulse response" },
+	{ "azaVoicePool", "32 mono voices" },
+};
+
+typedef struct benchDSPBuffer {
+	// What got allocated, which the strided layout only uses part of
+	azaBuffer alloc;
+	azaBuffer view;
+} benchDSPBuffer;
+
+typedef struct benchDSPState {
+	benchDSPKind kind;
+	size_t channels;
+	// Holds the same noise as the input in the same layout, for the buffer operations to read from
+	benchDSPBuffer other;
+	// Interleaved noise for BENCH_DSP_BUFFER_COPY to convert from
+	azaBuffer interleaved;
+	azaRmsData rms[BENCH_DSP_MAX_CHANNELS];
+	azaFilterData filter[BENCH_DSP_MAX_CHANNELS];
+	azaBiquadData biquad;
+	azaLookaheadLimiterData limiter[BENCH_DSP_MAX_CHANNELS];
+	azaCompressorData compressor[BENCH_DSP_MAX_CHANNELS];
+	azaGateData gate[BENCH_DSP_MAX_CHANNELS];
+	azaDelayData delay[BENCH_DSP_MAX_CHANNELS];
+	azaReverbData reverb;
+	azaSamplerData sampler[BENCH_DSP_MAX_CHANNELS];
+	azaConvolutionData convolution[BENCH_DSP_MAX_CHANNELS];
+	azaVoicePoolData voices;
+} benchDSPState;
+
+// Shared by every case: a mono second of noise for the sampler and voices, and an impulse response
+static azaBuffer benchDSPSource;
+static azaConvolutionIR benchDSPIR;
+// Every layout's input copies its noise from here
+static float benchDSPNoise[BENCH_DSP_MAX_FRAMES * BENCH_DSP_MAX_CHANNELS];
+
+static int benchDSPBufferInit(benchDSPBuffer *buffer, benchDSPLayout layout, size_t channels) {
+	buffer->alloc = (azaBuffer) {
+		.frames = BENCH_DSP_MAX_FRAMES,
+		.channels = layout == BENCH_DSP_STRIDED ? channels * 2 : channels,
+		.samplerate = BENCH_DSP_SAMPLERATE,
+	};
+	int err = layout == BENCH_DSP_PLANAR ? azaBufferInitPlanar(&buffer->alloc) : azaBufferInit(&buffer->alloc);
+	if (err) return err;
+	memset(buffer->alloc.samples, 0, sizeof(float) * buffer->alloc.frames * buffer->alloc.channels);
+	buffer->view = buffer->alloc;
+	buffer->view.channels = channels;
+	azaBuffer noise = {
+		.samples = benchDSPNoise,
+		.frames = BENCH_DSP_MAX_FRAMES,
+		.stride = channels,
+		.channels = channels,
+		.samplerate = BENCH_DSP_SAMPLERATE,
+	};
+	azaBufferCopy(buffer->view, noise);
+	return AZA_SUCCESS;
+}
+
+static int benchDSPInit(benchDSPState *state, benchDSPKind kind, size_t channels) {
+	state->kind = kind;
+	state->channels = channels;
+	int err = AZA_SUCCESS;
+	for (size_t c = 0; c < channels; c++) {
+		switch (kind) {
+			case BENCH_DSP_RMS:
+			case BENCH_DSP_RMS_DECIMATED:
+				memset(&state->rms[c], 0, sizeof(state->rms[c]));
+				state->rms[c].decimation = kind == BENCH_DSP_RMS_DECIMATED ? 16 : 0;
+				azaRmsDataInit(&state->rms[c]);
+				break;
+			case BENCH_DSP_FILTER_LOW_PASS:
+			case BENCH_DSP_FILTER_BAND_PASS:
+				azaFilterDataInit(&state->filter[c]);
+				state->filter[c].kind = kind == BENCH_DSP_FILTER_LOW_PASS ? AZA_FILTER_LOW_PASS : AZA_FILTER_BAND_PASS;
+				state->filter[c].frequency = kind == BENCH_DSP_FILTER_LOW_PASS ? 2000.0f : 1000.0f;
+				state->filter[c].dryMix = 0.0f;
+				break;
+			case BENCH_DSP_LOOKAHEAD_LIMITER:
+			case BENCH_DSP_LOOKAHEAD_LIMITER_LINKED:
+				azaLookaheadLimiterDataInit(&state->limiter[c]);
+				state->limiter[c].gainInput = 6.0f;
+				state->limiter[c].linked = kind == BENCH_DSP_LOOKAHEAD_LIMITER_LINKED;
+				break;
+			case BENCH_DSP_COMPRESSOR:
+			case BENCH_DSP_COMPRESSOR_LINKED:
+				azaCompressorDataInit(&state->compressor[c]);
+				state->compressor[c].threshold = -12.0f;
+				state->compressor[c].ratio = 4.0f;
+				state->compressor[c].attack = 5.0f;
+				state->compressor[c].decay = 100.0f;
+				state->compressor[c].linked = kind == BENCH_DSP_COMPRESSOR_LINKED;
+				break;
+			case BENCH_DSP_GATE:
+			case BENCH_DSP_GATE_LINKED:
+				azaGateDataInit(&state->gate[c]);
+				state->gate[c].threshold = -20.0f;
+				state->gate[c].attack = 1.0f;
+				state->gate[c].decay = 50.0f;
+				state->gate[c].linked = kind == BENCH_DSP_GATE_LINKED;
+				break;
+			case BENCH_DSP_DELAY:
+			case BENCH_DSP_DELAY_WET_FILTER:
+				memset(&state->delay[c], 0, sizeof(state->delay[c]));
+				state->delay[c].gain = -6.0f;
+				state->delay[c].gainDry = 0.0f;
+				state->delay[c].delay = 250.0f;
+				state->delay[c].feedback = 0.5f;
+				azaDelayDataInit(&state->delay[c]);
+				if (kind == BENCH_DSP_DELAY_WET_FILTER) {
+					azaFilterDataInit(&state->filter[c]);
+					state->filter[c].kind = AZA_FILTER_LOW_PASS;
+					state->filter[c].frequency = 2000.0f;
+					state->filter[c].dryMix = 0.0f;
+					state->delay[c].wetEffects = &state->filter[c].header;
+				}
+				break;
+			case BENCH_DSP_SAMPLER:
+			case BENCH_DSP_SAMPLER_PITCHED:
+				memset(&state->sampler[c], 0, sizeof(state->sampler[c]));
+				state->sampler[c].buffer = &benchDSPSource;
+				state->sampler[c].speed = kind == BENCH_DSP_SAMPLER ? 1.0f : 0.77f;
+				state->sampler[c].gain = -6.0f;
+				state->sampler[c].quality = kind == BENCH_DSP_SAMPLER ? AZA_RESAMPLE_QUALITY_DEFAULT : AZA_RESAMPLE_QUALITY_16;
+				err = azaSamplerDataInit(&state->sampler[c]);
+				break;
+			case BENCH_DSP_CONVOLUTION:
+				memset(&state->convolution[c], 0, sizeof(state->convolution[c]));
+				state->convolution[c].ir = &benchDSPIR;
+				state->convolution[c].gain = -6.0f;
+				state->convolution[c].gainDry = -INFINITY;
+				err = azaConvolutionDataInit(&state->convolution[c]);
+				break;
+			default:
+				break;
+		}
+		if (err) return err;
+	}
+	switch (kind) {
+		case BENCH_DSP_BUFFER_COPY:
+			state->interleaved = (azaBuffer) {
+				.samples = benchDSPNoise,
+				.frames = BENCH_DSP_MAX_FRAMES,
+				.stride = channels,
+				.channels = channels,
+				.samplerate = BENCH_DSP_SAMPLERATE,
+			};
+			break;
+		case BENCH_DSP_BIQUAD_LOW_PASS:
+		case BENCH_DSP_BIQUAD_PEAKING:
+			azaBiquadDataInit(&state->biquad);
+			state->biquad.kind = kind == BENCH_DSP_BIQUAD_LOW_PASS ? AZA_BIQUAD_LOW_PASS : AZA_BIQUAD_PEAKING;
+			state->biquad.frequency = kind == BENCH_DSP_BIQUAD_LOW_PASS ? 4000.0f : 1000.0f;
+			state->biquad.q = 0.7071f;
+			state->biquad.gain = 6.0f;
+			break;
+		case BENCH_DSP_REVERB:
+		case BENCH_DSP_REVERB_LARGE:
+			memset(&state->reverb, 0, sizeof(state->reverb));
+			state->reverb.gain = -12.0f;
+			state->reverb.gainDry = 0.0f;
+			state->reverb.roomsize = kind == BENCH_DSP_REVERB ? 5.0f : 50.0f;
+			state->reverb.color = 1.0f;
+			state->reverb.delay = 10.0f;
+			azaReverbDataInit(&state->reverb);
+			break;
+		case BENCH_DSP_VOICE_POOL:
+			memset(&state->voices, 0, sizeof(state->voices));
+			state->voices.capacity = 32;
+			state->voices.gain = -30.0f;
+			err = azaVoicePoolDataInit(&state->voices);
+			if (err) return err;
+			for (uint32_t i = 0; i < 32; i++) {
+				float pitch = 0.75f + (float)(i % 7) * 0.1f;
+				float pan = (float)(i % 17) / 8.0f - 1.0f;
+				azaVoicePlay(&state->voices, &benchDSPSource, 0.0f, pitch, pan, 0, 1);
+			}
+			break;
+		default:
+			break;
+	}
+	return AZA_SUCCESS;
+}
+
+static void benchDSPDeinit(benchDSPState *state) {
+	for (size_t c = 0; c < state->channels; c++) {
+		switch (state->kind) {
+			case BENCH_DSP_RMS:
+			case BENCH_DSP_RMS_DECIMATED:
+				azaRmsDataDeinit(&state->rms[c]);
+				break;
+			case BENCH_DSP_LOOKAHEAD_LIMITER:
+			case BENCH_DSP_LOOKAHEAD_LIMITER_LINKED:
+				azaLookaheadLimiterDataDeinit(&state->limiter[c]);
+				break;
+			case BENCH_DSP_COMPRESSOR:
+			case BENCH_DSP_COMPRESSOR_LINKED:
+				azaCompressorDataDeinit(&state->compressor[c]);
+				break;
+			case BENCH_DSP_GATE:
+			case BENCH_DSP_GATE_LINKED:
+				azaGateDataDeinit(&state->gate[c]);
+				break;
+			case BENCH_DSP_DELAY:
+			case BENCH_DSP_DELAY_WET_FILTER:
+				azaDelayDataDeinit(&state->delay[c]);
+				break;
+			case BENCH_DSP_CONVOLUTION:
+				azaConvolutionDataDeinit(&state->convolution[c]);
+				break;
+			default:
+				break;
+		}
+	}
+	switch (state->kind) {
+		case BENCH_DSP_REVERB:
+		case BENCH_DSP_REVERB_LARGE:
+			azaReverbDataDeinit(&state->reverb);
+			break;
+		case BENCH_DSP_VOICE_POOL:
+			azaVoicePoolDataDeinit(&state->voices);
+			break;
+		default:
+			break;
+	}
+}
+
+static int benchDSPProcess(benchDSPState *state, azaBuffer buffer) {
+	azaBuffer other = state->other.view;
+	other.frames = buffer.frames;
+	switch (state->kind) {
+		case BENCH_DSP_BUFFER_MIX:
+			azaBufferMix(buffer, 0.5f, other, 0.5f);
+			return AZA_SUCCESS;
+		case BENCH_DSP_BUFFER_COPY_CHANNEL:
+			for (size_t c = 0; c < buffer.channels; c++) {
+				azaBufferCopyChannel(buffer, c, other, (c + 1) % buffer.channels);
+			}
+			return AZA_SUCCESS;
+		case BENCH_DSP_BUFFER_COPY: {
+			azaBuffer interleaved = state->interleaved;
+			interleaved.frames = buffer.frames;
+			azaBufferCopy(buffer, interleaved);
+			return AZA_SUCCESS;
+		}
+		case BENCH_DSP_CUBIC_LIMITER:
+			return azaCubicLimiter(buffer);
+		case BENCH_DSP_RMS:
+		case BENCH_DSP_RMS_DECIMATED:
+			return azaRms(buffer, state->rms);
+		case BENCH_DSP_FILTER_LOW_PASS:
+		case BENCH_DSP_FILTER_BAND_PASS:
+			return azaFilter(buffer, state->filter);
+		case BENCH_DSP_BIQUAD_LOW_PASS:
+		case BENCH_DSP_BIQUAD_PEAKING:
+			return azaBiquad(buffer, &state->biquad);
+		case BENCH_DSP_LOOKAHEAD_LIMITER:
+		case BENCH_DSP_LOOKAHEAD_LIMITER_LINKED:
+			return azaLookaheadLimiter(buffer, state->limiter);
+		case BENCH_DSP_COMPRESSOR:
+		case BENCH_DSP_COMPRESSOR_LINKED:
+			return azaCompressor(buffer, state->compressor);
+		case BENCH_DSP_GATE:
+		case BENCH_DSP_GATE_LINKED:
+			return azaGate(buffer, state->gate);
+		case BENCH_DSP_DELAY:
+		case BENCH_DSP_DELAY_WET_FILTER:
+			return azaDelay(buffer, state->delay);
+		case BENCH_DSP_REVERB:
+		case BENCH_DSP_REVERB_LARGE:
+			return azaReverb(buffer, &state->reverb);
+		case BENCH_DSP_SAMPLER:
+		case BENCH_DSP_SAMPLER_PITCHED:
+			return azaSampler(buffer, state->sampler);
+		case BENCH_DSP_CONVOLUTION:
+			return azaConvolution(buffer, state->convolution);
+		case BENCH_DSP_VOICE_POOL:
+			return azaVoicePool(buffer, &state->voices);
+		default:
+			return AZA_ERROR_INVALID_CONFIGURATION;
+	}
+}
+
+typedef struct benchDSPRun {
+	benchDSPState *state;
+	azaBuffer buffer;
+	azaBuffer input;
+	// Only copy the input in, to measure what that costs on its own
+	int copyOnly;
+	int error;
+} benchDSPRun;
+
+// Every block starts from the same input, since processing the output again would pile up the gain of the feedback effects
+static void benchDSPBlock(void *userData) {
+	benchDSPRun *run = userData;
+	azaBufferCopy(run->buffer, run->input);
+	if (run->copyOnly) return;
+	int err = benchDSPProcess(run->state, run->buffer);
+	if (err) run->error = err;
+}
+
+static benchDSPState benchDSPStateData;
+
+// Times every kind for channels channels in layout at each block size, printing a row per kind
+static void benchDSPMatrix(benchDSPLayout layout, size_t channels) {
+	benchDSPBuffer buffer, input;
+	if (benchDSPBufferInit(&buffer, layout, channels) || benchDSPBufferInit(&input, layout, channels) || benchDSPBufferInit(&benchDSPStateData.other, layout, channels)) {
+		printf("failed to allocate buffers\n");
+		return;
+	}
+	benchDSPRun run = {
+		.state = &benchDSPStateData,
+		.input = input.view,
+		.copyOnly = 1,
+	};
+	double copySeconds[BENCH_DSP_FRAME_COUNTS];
+	for (size_t f = 0; f < BENCH_DSP_FRAME_COUNTS; f++) {
+		run.buffer = buffer.view;
+		run.buffer.frames = run.input.frames = benchDSPFrames[f];
+		copySeconds[f] = benchTime(benchDSPBlock, &run, BENCH_DSP_SECONDS);
+	}
+	run.copyOnly = 0;
+	for (int kind = 0; kind < BENCH_DSP_KIND_COUNT; kind++) {
+		const benchDSPCase *info = &benchDSPCases[kind];
+		if (kind == BENCH_DSP_BIQUAD_LOW_PASS || kind == BENCH_DSP_BIQUAD_PEAKING) {
+			if (channels > AZAUDIO_BIQUAD_MAX_CHANNELS) continue;
+		}
+		run.error = benchDSPInit(&benchDSPStateData, (benchDSPKind)kind, channels);
+		printf("%-20s %-32s %2zu %-11s", info->name, info->regime, channels, benchDSPLayoutNames[layout]);
+		double nsPerSample[BENCH_DSP_FRAME_COUNTS];
+		double realtime[BENCH_DSP_FRAME_COUNTS];
+		for (size_t f = 0; f < BENCH_DSP_FRAME_COUNTS && !run.error; f++) {
+			size_t frames = benchDSPFrames[f];
+			run.buffer = buffer.view;
+			run.buffer.frames = run.input.frames = frames;
+			double seconds = benchTime(benchDSPBlock, &run, BENCH_DSP_SECONDS) - copySeconds[f];
+			if (seconds < 0.0) seconds = 0.0;
+			nsPerSample[f] = seconds * 1e9 / (double)(frames * channels);
+			realtime[f] = seconds / ((double)frames / (double)BENCH_DSP_SAMPLERATE) * 100.0;
+			char params[256];
+			snprintf(params, sizeof(params), "\"regime\": \"%s\", \"channels\": %zu, \"frames\": %zu, \"layout\": \"%s\"", info->regime, channels, frames, benchDSPLayoutNames[layout]);
+			benchRecord("dsp", info->name, params, nsPerSample[f], realtime[f]);
+		}
+		if (run.error) {
+			printf(" failed with error %d\n", run.error);
+			run.error = 0;
+		} else {
+			for (size_t f = 0; f < BENCH_DSP_FRAME_COUNTS; f++) {
+				printf(" %8.2f", nsPerSample[f]);
+			}
+			printf(" %8.3f\n", realtime[2]);
+		}
+		benchDSPDeinit(&benchDSPStateData);
+	}
+	azaBufferDeinit(&buffer.alloc);
+	azaBufferDeinit(&input.alloc);
+	azaBufferDeinit(&benchDSPStateData.other.alloc);
+}
+
+// Runs BENCH_DSP_CHECK_BLOCKS blocks of kind from fresh state into output (interleaved), returning seconds per block
+static double benchDSPCheckRun(benchDSPKind kind, benchDSPLayout layout, size_t channels, float *output, int *error) {
+	benchDSPBuffer buffer, input;
+	*error = benchDSPBufferInit(&buffer, layout, channels);
+	if (!*error) *error = benchDSPBufferInit(&input, layout, channels);
+	if (!*error) *error = benchDSPBufferInit(&benchDSPStateData.other, layout, channels);
+	if (!*error) *error = benchDSPInit(&benchDSPStateData, kind, channels);
+	if (*error) return 0.0;
+	benchDSPRun run = {
+		.state = &benchDSPStateData,
+		.buffer = buffer.view,
+		.input = input.view,
+	};
+	run.buffer.frames = run.input.frames = BENCH_DSP_CHECK_FRAMES;
+	azaBuffer out = {
+		.frames = BENCH_DSP_CHECK_FRAMES,
+		.channels = channels,
+		.stride = channels,
+		.samplerate = BENCH_DSP_SAMPLERATE,
+	};
+	double start = benchNow();
+	for (size_t b = 0; b < BENCH_DSP_CHECK_BLOCKS; b++) {
+		benchDSPBlock(&run);
+		out.samples = output + b * BENCH_DSP_CHECK_FRAMES * channels;
+		azaBufferCopy(out, run.buffer);
+	}
+	double seconds = (benchNow() - start) / (double)BENCH_DSP_CHECK_BLOCKS;
+	*error = run.error;
+	benchDSPDeinit(&benchDSPStateData);
+	azaBufferDeinit(&buffer.alloc);
+	azaBufferDeinit(&input.alloc);
+	azaBufferDeinit(&benchDSPStateData.other.alloc);
+	return seconds;
+}
+
+static float benchDSPCheckScalar[BENCH_DSP_CHECK_FRAMES * BENCH_DSP_CHECK_BLOCKS * BENCH_DSP_MAX_CHANNELS];
+static float benchDSPCheckSIMD[BENCH_DSP_CHECK_FRAMES * BENCH_DSP_CHECK_BLOCKS * BENCH_DSP_MAX_CHANNELS];
+
+static const char *benchDSPLevelNames[] = { "scalar", "SSE2", "AVX2", "AVX512", "NEON" };
+
+// Runs every kind with the scalar kernels and those of level, printing how far apart and how much faster they are.
+// Returns how many kinds were further apart than BENCH_DSP_CHECK_DB.
+static int benchDSPCheckSIMDLevel(azaSIMDLevel level) {
+	int failures = 0;
+	printf("\n%-20s %-32s %2s %-11s %10s %10s %8s\n", "SIMD vs scalar", benchDSPLevelNames[level], "ch", "layout", "error dB", "speedup", "");
+	for (int kind = 0; kind < BENCH_DSP_KIND_COUNT; kind++) {
+		const benchDSPCase *info = &benchDSPCases[kind];
+		for (int layout = 0; layout < BENCH_DSP_LAYOUT_COUNT; layout++) {
+			size_t channels = 2;
+			size_t count = BENCH_DSP_CHECK_FRAMES * BENCH_DSP_CHECK_BLOCKS * channels;
+			int errScalar, errSIMD;
+			// The first run of each warms up the allocator and caches, so only the second is timed
+			azaSetSIMDLevel(AZA_SIMD_LEVEL_SCALAR);
+			benchDSPCheckRun((benchDSPKind)kind, (benchDSPLayout)layout, channels, benchDSPCheckScalar, &errScalar);
+			double secondsScalar = benchDSPCheckRun((benchDSPKind)kind, (benchDSPLayout)layout, channels, benchDSPCheckScalar, &errScalar);
+			azaSetSIMDLevel(level);
+			benchDSPCheckRun((benchDSPKind)kind, (benchDSPLayout)layout, channels, benchDSPCheckSIMD, &errSIMD);
+			double secondsSIMD = benchDSPCheckRun((benchDSPKind)kind, (benchDSPLayout)layout, channels, benchDSPCheckSIMD, &errSIMD);
+			printf("%-20s %-32s %2zu %-11s", info->name, info->regime, channels, benchDSPLayoutNames[layout]);
+			if (errScalar || errSIMD) {
+				printf(" failed with error %d\n", errScalar ? errScalar : errSIMD);
+				failures++;
+				continue;
+			}
+			float peak = 0.0f, maxError = 0.0f;
+			for (size_t i = 0; i < count; i++) {
+				peak = fmaxf(peak, fabsf(benchDSPCheckScalar[i]));
+				maxError = fmaxf(maxError, fabsf(benchDSPCheckSIMD[i] - benchDSPCheckScalar[i]));
+			}
+			double errorDb = maxError > 0.0f ? 20.0 * log10((double)maxError / (double)fmaxf(peak, 1e-30f)) : -INFINITY;
+			int failed = errorDb > BENCH_DSP_CHECK_DB || isnan(errorDb);
+			failures += failed;
+			double speedup = secondsSIMD > 0.0 ? secondsScalar / secondsSIMD : 0.0;
+			printf(" %10.1f %10.2f %8s\n", errorDb, speedup, failed ? "FAILED" : "ok");
+			char params[256];
+			// JSON has no infinity, so exact matches get -1000
+			snprintf(params, sizeof(params), "\"regime\": \"%s\", \"channels\": %zu, \"frames\": %d, \"layout\": \"%s\", \"simdLevel\": \"%s\", \"simdErrorDb\": %.1f, \"simdSpeedup\": %.3f, \"simdOk\": %s",
+				info->regime, channels, BENCH_DSP_CHECK_FRAMES, benchDSPLayoutNames[layout], benchDSPLevelNames[level], isinf(errorDb) ? -1000.0 : errorDb, speedup, failed ? "false" : "true");
+			benchRecord("dsp-simd", info->name, params, 0.0, 0.0);
+		}
+	}
+	return failures;
+}
+
+void benchDSP() {
+	benchNoise(benchDSPNoise, BENCH_DSP_MAX_FRAMES * BENCH_DSP_MAX_CHANNELS, 7);
+	benchDSPSource = (azaBuffer) {
+		.frames = BENCH_DSP_SAMPLERATE,
+		.channels = 1,
+		.samplerate = BENCH_DSP_SAMPLERATE,
+	};
+	if (azaBufferInit(&benchDSPSource)) return;
+	benchNoise(benchDSPSource.samples, benchDSPSource.frames, 8);
+	{
+		// Decaying noise, like a small hall
+		static float ir[BENCH_DSP_SAMPLERATE];
+		benchNoise(ir, BENCH_DSP_SAMPLERATE, 9);
+		for (size_t i = 0; i < BENCH_DSP_SAMPLERATE; i++) {
+			ir[i] *= 0.1f * expf(-6.9f * (float)i / (float)BENCH_DSP_SAMPLERATE);
+		}
+		if (azaConvolutionIRInit(&benchDSPIR, ir, BENCH_DSP_SAMPLERATE, 0)) {
+			azaBufferDeinit(&benchDSPSource);
+			return;
+		}
+	}
+	uint32_t denormals = azaFlushDenormalsBegin();
+	printf("ns per sample (channels x frames) at each block size, and %% of one core's realtime budget at %zu frames, %dHz\n", benchDSPFrames[2], BENCH_DSP_SAMPLERATE);
+	printf("%-20s %-32s %2s %-11s", "function", "regime", "ch", "layout");
+	for (size_t f = 0; f < BENCH_DSP_FRAME_COUNTS; f++) {
+		printf(" %8zu", benchDSPFrames[f]);
+	}
+	printf(" %8s\n", "% budget");
+	for (int layout = 0; layout < BENCH_DSP_LAYOUT_COUNT; layout++) {
+		for (size_t ch = 0; ch < BENCH_DSP_CHANNEL_COUNTS; ch++) {
+			benchDSPMatrix((benchDSPLayout)layout, benchDSPChannels[ch]);
+		}
+	}
+	azaSIMDLevel previous = azaGetSIMDLevel();
+	for (int level = AZA_SIMD_LEVEL_SSE2; level <= AZA_SIMD_LEVEL_NEON; level++) {
+		if (azaSetSIMDLevel((azaSIMDLevel)level)) continue;
+		int failures = benchDSPCheckSIMDLevel((azaSIMDLevel)level);
+		printf("%d SIMD mismatches at %s\n", failures, benchDSPLevelNames[level]);
+		if (failures) benchFail();
+	}
+	azaSetSIMDLevel(previous);
+	azaFlushDenormalsEnd(denormals);
+	azaConvolutionIRDeinit(&benchDSPIR);
+	azaBufferDeinit(&benchDSPSource);
+}
@@ -0,0 +1,83 @@
+/*
+	File: bench_fft.c
+	Author: Philip Haynes
+	Real FFT throughput per size against a naive DFT.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/fft.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The DFT is O(n^2) so only the smaller sizes are worth waiting for
+#define BENCH_DFT_MAX_SIZE 4096
+// For the report's % of realtime, as if one transform ran for every size samples
+#define BENCH_FFT_SAMPLERATE 48000
+
+typedef struct benchFFTData {
+	azaFFT fft;
+	float *samples;
+	float *spectrum;
+	float *cosTable;
+	float *sinTable;
+} benchFFTData;
+
+static void benchFFTForward(void *userData) {
+	benchFFTData *data = userData;
+	azaFFTForward(&data->fft, data->spectrum, data->samples);
+}
+
+// The same output as azaFFTForward with sines and cosines looked up from a table
+static void benchDFT(void *userData) {
+	benchFFTData *data = userData;
+	uint32_t size = data->fft.size;
+	for (uint32_t k = 0; k <= size / 2; k++) {
+		float re = 0.0f, im = 0.0f;
+		uint32_t index = 0;
+		for (uint32_t i = 0; i < size; i++) {
+			re += data->samples[i] * data->cosTable[index];
+			im -= data->samples[i] * data->sinTable[index];
+			index = (index + k) & (size - 1);
+		}
+		data->spectrum[k*2+0] = re;
+		data->spectrum[k*2+1] = im;
+	}
+}
+
+void benchFFT() {
+	printf("%8s %14s %14s %14s %10s\n", "size", "forward ns", "MSamples/s", "DFT ns", "speedup");
+	for (uint32_t size = AZAUDIO_FFT_MIN_SIZE; size <= AZAUDIO_FFT_MAX_SIZE; size *= 2) {
+		benchFFTData data;
+		if (azaFFTInit(&data.fft, size)) continue;
+		data.samples = malloc(sizeof(float) * size);
+		data.spectrum = malloc(sizeof(float) * (size + 2));
+		data.cosTable = malloc(sizeof(float) * size);
+		data.sinTable = malloc(sizeof(float) * size);
+		benchNoise(data.samples, size, size);
+		for (uint32_t i = 0; i < size; i++) {
+			data.cosTable[i] = cosf(6.283185307f * (float)i / (float)size);
+			data.sinTable[i] = sinf(6.283185307f * (float)i / (float)size);
+		}
+		double forward = benchTime(benchFFTForward, &data, 0.1);
+		double blockSeconds = (double)size / (double)BENCH_FFT_SAMPLERATE;
+		char params[64];
+		snprintf(params, sizeof(params), "\"size\": %u", size);
+		printf("%8u %14.1f %14.1f", size, forward * 1e9, (double)size / forward * 1e-6);
+		benchRecord("fft", "forward", params, forward * 1e9 / (double)size, forward / blockSeconds * 100.0);
+		if (size <= BENCH_DFT_MAX_SIZE) {
+			double dft = benchTime(benchDFT, &data, 0.1);
+			printf(" %14.1f %9.1fx\n", dft * 1e9, dft / forward);
+			benchRecord("fft", "dft", params, dft * 1e9 / (double)size, dft / blockSeconds * 100.0);
+		} else {
+			printf(" %14s %10s\n", "-", "-");
+		}
+		azaFFTDeinit(&data.fft);
+		free(data.samples);
+		free(data.spectrum);
+		free(data.cosTable);
+		free(data.sinTable);
+	}
+}
@@ -0,0 +1,125 @@
+/*
+	File: bench_graph.c
+	Author: Philip Haynes
+	How azaGraph scales with worker threads on 64 buses, each with a reverb, grouped 8 at a time into a master.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/graph.h"
+#include "AzAudio/error.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_GRAPH_SAMPLERATE 48000
+#define BENCH_GRAPH_BLOCK 256
+#define BENCH_GRAPH_BUSES 64
+#define BENCH_GRAPH_GROUPS 8
+
+typedef struct benchGraphData {
+	azaGraph graph;
+	azaBuffer output;
+	float noise[BENCH_GRAPH_BLOCK * 2];
+	azaReverbData reverbs[BENCH_GRAPH_BUSES];
+	azaCompressorData compressors[BENCH_GRAPH_GROUPS][2];
+	azaLookaheadLimiterData limiter[2];
+} benchGraphData;
+
+static int benchGraphSource(azaBuffer buffer, void *userData) {
+	benchGraphData *data = userData;
+	memcpy(buffer.samples, data->noise, sizeof(float) * buffer.frames * buffer.channels);
+	return AZA_SUCCESS;
+}
+
+static void benchGraphBlock(void *userData) {
+	benchGraphData *data = userData;
+	azaGraphProcess(&data->graph, data->output);
+}
+
+// Seconds per block with workers threads helping, or a negative number if something failed
+static double benchGraphRun(benchGraphData *data, uint32_t workers) {
+	azaGraph *graph = &data->graph;
+	if (azaGraphInit(graph, 2, BENCH_GRAPH_BLOCK, workers)) return -1.0;
+	uint32_t master, groups[BENCH_GRAPH_GROUPS];
+	azaGraphAddNode(graph, NULL, NULL, &data->limiter[0].header, &master);
+	for (uint32_t g = 0; g < BENCH_GRAPH_GROUPS; g++) {
+		azaGraphAddNode(graph, NULL, NULL, &data->compressors[g][0].header, &groups[g]);
+		azaGraphAddSend(graph, groups[g], master, -6.0f);
+	}
+	for (uint32_t b = 0; b < BENCH_GRAPH_BUSES; b++) {
+		uint32_t bus;
+		azaGraphAddNode(graph, benchGraphSource, data, &data->reverbs[b].header, &bus);
+		azaGraphAddSend(graph, bus, groups[b % BENCH_GRAPH_GROUPS], -18.0f);
+	}
+	double seconds = -1.0;
+	if (azaGraphCompile(graph) == AZA_SUCCESS) {
+		seconds = benchTime(benchGraphBlock, data, 0.3);
+	}
+	azaGraphDeinit(graph);
+	return seconds;
+}
+
+void benchGraph() {
+	static benchGraphData data;
+	data.output = (azaBuffer) {
+		.frames = BENCH_GRAPH_BLOCK,
+		.channels = 2,
+		.samplerate = BENCH_GRAPH_SAMPLERATE,
+	};
+	azaBufferInit(&data.output);
+	benchNoise(data.noise, BENCH_GRAPH_BLOCK * 2, 1);
+	for (uint32_t b = 0; b < BENCH_GRAPH_BUSES; b++) {
+		azaReverbData *reverb = &data.reverbs[b];
+		reverb->gain = -12.0f;
+		reverb->gainDry = 0.0f;
+		reverb->roomsize = 5.0f + (float)(b % 10);
+		reverb->color = 1.0f;
+		reverb->delay = 10.0f;
+		azaReverbDataInit(reverb);
+	}
+	for (uint32_t g = 0; g < BENCH_GRAPH_GROUPS; g++) {
+		for (int c = 0; c < 2; c++) {
+			azaCompressorData *compressor = &data.compressors[g][c];
+			azaCompressorDataInit(compressor);
+			compressor->threshold = -12.0f;
+			compressor->ratio = 4.0f;
+			compressor->attack = 5.0f;
+			compressor->decay = 100.0f;
+			compressor->linked = 1;
+		}
+	}
+	for (int c = 0; c < 2; c++) {
+		azaLookaheadLimiterDataInit(&data.limiter[c]);
+		data.limiter[c].linked = 1;
+	}
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	double blockSeconds = (double)BENCH_GRAPH_BLOCK / (double)BENCH_GRAPH_SAMPLERATE;
+	printf("%d buses with a reverb each into %d groups into a master, %d frame stereo blocks, %ld cores\n", BENCH_GRAPH_BUSES, BENCH_GRAPH_GROUPS, BENCH_GRAPH_BLOCK, cores);
+	printf("%8s %12s %10s %12s\n", "workers", "us/block", "speedup", "realtime x");
+	double serial = 0.0;
+	for (uint32_t workers = 0; workers < 16; workers = workers ? workers * 2 : 1) {
+		// With as many workers as cores, the calling thread makes one more than there are cores, which shows what oversubscribing costs
+		if ((long)workers > cores) break;
+		double seconds = benchGraphRun(&data, workers);
+		if (seconds < 0.0) {
+			printf("%8u failed\n", workers);
+			continue;
+		}
+		if (workers == 0) serial = seconds;
+		printf("%8u %12.1f %10.2f %12.1f\n", workers, seconds * 1e6, serial / seconds, blockSeconds / seconds);
+	}
+	for (uint32_t b = 0; b < BENCH_GRAPH_BUSES; b++) {
+		azaReverbDataDeinit(&data.reverbs[b]);
+	}
+	for (uint32_t g = 0; g < BENCH_GRAPH_GROUPS; g++) {
+		for (int c = 0; c < 2; c++) {
+			azaCompressorDataDeinit(&data.compressors[g][c]);
+		}
+	}
+	for (int c = 0; c < 2; c++) {
+		azaLookaheadLimiterDataDeinit(&data.limiter[c]);
+	}
+	azaBufferDeinit(&data.output);
+}
@@ -0,0 +1,96 @@
+/*
+	File: bench_voices.c
+	Author: Philip Haynes
+	How many azaVoicePool voices one core can mix in realtime.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/dsp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_VOICES_SAMPLERATE 48000
+#define BENCH_VOICES_BLOCK 256
+#define BENCH_VOICES_SOURCES 8
+
+typedef struct benchVoicesData {
+	azaVoicePoolData pool;
+	azaBuffer bus;
+	azaBuffer sources[BENCH_VOICES_SOURCES];
+} benchVoicesData;
+
+static void benchVoicesBlock(void *userData) {
+	benchVoicesData *data = userData;
+	azaVoicePool(data->bus, &data->pool);
+}
+
+// Seconds per block with voices voices looping, all at pitch 1 if unity is set, otherwise spread around it
+static double benchVoicesRun(benchVoicesData *data, uint32_t voices, azaResampleQuality quality, int unity) {
+	data->pool = (azaVoicePoolData) {
+		.capacity = voices,
+		.quality = quality,
+		.gain = -30.0f,
+	};
+	if (azaVoicePoolDataInit(&data->pool)) return 0.0;
+	for (int i = 1; i < BENCH_VOICES_SOURCES; i += 2) {
+		// Half the sources are at 44.1kHz so they get resampled even at pitch 1
+		data->sources[i].samplerate = unity ? BENCH_VOICES_SAMPLERATE : 44100;
+	}
+	unsigned state = voices;
+	for (uint32_t i = 0; i < voices; i++) {
+		state = state * 1664525u + 1013904223u;
+		float pitch = unity ? 1.0f : 0.75f + (float)(state >> 8) / (float)(1u << 24) * 0.75f;
+		float pan = (float)(i % 17) / 8.0f - 1.0f;
+		azaVoicePlay(&data->pool, &data->sources[i % BENCH_VOICES_SOURCES], 0.0f, pitch, pan, 0, 1);
+	}
+	double seconds = benchTime(benchVoicesBlock, data, 0.2);
+	azaVoicePoolDataDeinit(&data->pool);
+	return seconds;
+}
+
+void benchVoices() {
+	benchVoicesData data;
+	data.bus = (azaBuffer) {
+		.frames = BENCH_VOICES_BLOCK,
+		.channels = 2,
+		.samplerate = BENCH_VOICES_SAMPLERATE,
+	};
+	azaBufferInit(&data.bus);
+	for (int i = 0; i < BENCH_VOICES_SOURCES; i++) {
+		data.sources[i] = (azaBuffer) {
+			.frames = 24000 + i * 1000,
+			.channels = 1,
+			.samplerate = BENCH_VOICES_SAMPLERATE,
+		};
+		azaBufferInit(&data.sources[i]);
+		benchNoise(data.sources[i].samples, data.sources[i].frames, i + 1);
+	}
+	double blockSeconds = (double)BENCH_VOICES_BLOCK / (double)BENCH_VOICES_SAMPLERATE;
+	printf("%d frame stereo blocks at %dHz, mono sources, %.1fus of audio per block\n", BENCH_VOICES_BLOCK, BENCH_VOICES_SAMPLERATE, blockSeconds * 1e6);
+	printf("%6s %8s %14s %14s\n", "taps", "voices", "us/block", "voices/core");
+	static const struct {
+		const char *name;
+		azaResampleQuality quality;
+		int unity;
+	} configs[] = {
+		{ "4", AZA_RESAMPLE_QUALITY_4, 0 },
+		{ "8", AZA_RESAMPLE_QUALITY_8, 0 },
+		{ "16", AZA_RESAMPLE_QUALITY_16, 0 },
+		{ "32", AZA_RESAMPLE_QUALITY_32, 0 },
+		// Everything at pitch 1 and the bus samplerate, which skips interpolation
+		{ "1x", AZA_RESAMPLE_QUALITY_DEFAULT, 1 },
+	};
+	for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+		for (uint32_t voices = 256; voices <= 4096; voices *= 4) {
+			double seconds = benchVoicesRun(&data, voices, configs[i].quality, configs[i].unity);
+			if (seconds <= 0.0) continue;
+			printf("%6s %8u %14.1f %14.0f\n", configs[i].name, voices, seconds * 1e6, (double)voices * blockSeconds / seconds);
+		}
+	}
+	azaBufferDeinit(&data.bus);
+	for (int i = 0; i < BENCH_VOICES_SOURCES; i++) {
+		azaBufferDeinit(&data.sources[i]);
+	}
+}
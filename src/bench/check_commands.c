@@ -0,0 +1,130 @@
+/*
+	File: check_commands.c
+	Author: Philip Haynes
+	Hammers azaCommandQueue from several producer threads at once while this thread applies them like the audio thread would,
+	checking that every command arrives exactly once and that each producer's commands arrive in the order it posted them.
+	Build it with -fsanitize=thread (make check-tsan) to have the races looked for too.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/commands.h"
+#include "AzAudio/error.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHECK_COMMANDS_PRODUCERS 8
+#define CHECK_COMMANDS_PER_PRODUCER 100000
+// Small enough that the ring fills up and producers have to retry
+#define CHECK_COMMANDS_CAPACITY 64
+#define CHECK_COMMANDS_BLOCK 64
+// Gives up if the audio side hasn't heard everything after this long
+#define CHECK_COMMANDS_TIMEOUT 60.0
+
+typedef struct checkCommandsData {
+	azaCommandQueue queue;
+	// Only touched by the consumer
+	uint32_t next[CHECK_COMMANDS_PRODUCERS];
+	uint64_t received;
+	uint64_t duplicated;
+	uint64_t outOfOrder;
+	// Set by the producers
+	uint64_t full;
+} checkCommandsData;
+
+typedef struct checkCommandsProducer {
+	checkCommandsData *data;
+	uint32_t index;
+} checkCommandsProducer;
+
+// userData carries which producer posted it in the top 32 bits and which of its commands it was in the bottom 32
+static void checkCommandsReceive(void *target, void *userData) {
+	checkCommandsData *data = target;
+	uint64_t id = (uint64_t)(uintptr_t)userData;
+	uint32_t producer = (uint32_t)(id >> 32);
+	uint32_t sequence = (uint32_t)id;
+	data->received++;
+	if (sequence < data->next[producer]) {
+		data->duplicated++;
+	} else if (sequence > data->next[producer]) {
+		// Anything skipped over shows up as missing at the end too
+		data->outOfOrder++;
+		data->next[producer] = sequence + 1;
+	} else {
+		data->next[producer]++;
+	}
+}
+
+static void* checkCommandsProduce(void *userData) {
+	checkCommandsProducer *producer = userData;
+	checkCommandsData *data = producer->data;
+	for (uint32_t i = 0; i < CHECK_COMMANDS_PER_PRODUCER; i++) {
+		azaCommand command;
+		memset(&command, 0, sizeof(command));
+		command.kind = AZA_COMMAND_CALL;
+		command.target = data;
+		command.value.callback = checkCommandsReceive;
+		command.userData = (void*)(uintptr_t)(((uint64_t)producer->index << 32) | i);
+		// Odd producers schedule ahead, so their commands wait in pending while the rest run straight off the ring
+		command.frame = producer->index & 1 ? azaCommandQueueNow(&data->queue) + CHECK_COMMANDS_BLOCK : 0;
+		while (azaCommandPost(&data->queue, &command) == AZA_ERROR_QUEUE_FULL) {
+			__atomic_add_fetch(&data->full, 1, __ATOMIC_RELAXED);
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+void checkCommands() {
+	static checkCommandsData data;
+	memset(&data, 0, sizeof(data));
+	if (azaCommandQueueInit(&data.queue, CHECK_COMMANDS_CAPACITY)) {
+		printf("azaCommandQueueInit failed\n");
+		benchFail();
+		return;
+	}
+	checkCommandsProducer producers[CHECK_COMMANDS_PRODUCERS];
+	pthread_t threads[CHECK_COMMANDS_PRODUCERS];
+	uint32_t started = 0;
+	for (uint32_t i = 0; i < CHECK_COMMANDS_PRODUCERS; i++) {
+		producers[i] = (checkCommandsProducer) { .data = &data, .index = i };
+		if (pthread_create(&threads[i], NULL, checkCommandsProduce, &producers[i]) != 0) {
+			printf("Failed to start producer %u\n", i);
+			benchFail();
+			break;
+		}
+		started++;
+	}
+	uint64_t expected = (uint64_t)started * CHECK_COMMANDS_PER_PRODUCER;
+	double start = benchNow();
+	while (data.received < expected && benchNow() - start < CHECK_COMMANDS_TIMEOUT) {
+		azaCommandQueueApply(&data.queue);
+		azaCommandQueueAdvance(&data.queue, CHECK_COMMANDS_BLOCK);
+		// Like an audio thread waiting on the next period, which gives the producers a go on machines with few cores
+		sched_yield();
+	}
+	for (uint32_t i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	double seconds = benchNow() - start;
+	// Everything posted has been heard, so anything more coming through would be a duplicate
+	for (int i = 0; i < 4; i++) {
+		azaCommandQueueApply(&data.queue);
+		azaCommandQueueAdvance(&data.queue, CHECK_COMMANDS_BLOCK);
+	}
+	uint64_t missing = 0;
+	for (uint32_t i = 0; i < started; i++) {
+		if (data.next[i] < CHECK_COMMANDS_PER_PRODUCER) missing += CHECK_COMMANDS_PER_PRODUCER - data.next[i];
+	}
+	azaCommandQueueStats stats = azaCommandQueueGetStats(&data.queue);
+	int passed = data.received == expected && missing == 0 && data.duplicated == 0 && data.outOfOrder == 0
+		&& stats.posted == expected && stats.dropped == data.full;
+	printf("%u producers posted %llu commands through a ring of %u in %.3fs, retrying %llu times when it was full\n", started, (unsigned long long)expected, stats.capacity, seconds, (unsigned long long)data.full);
+	printf("received %llu, missing %llu, duplicated %llu, out of order %llu, posted %llu, dropped %llu %s\n", (unsigned long long)data.received, (unsigned long long)missing, (unsigned long long)data.duplicated, (unsigned long long)data.outOfOrder, (unsigned long long)stats.posted, (unsigned long long)stats.dropped, passed ? "ok" : "FAILED");
+	if (!passed) benchFail();
+	azaCommandQueueDeinit(&data.queue);
+}
@@ -0,0 +1,131 @@
+/*
+	File: check_fft.c
+	Author: Philip Haynes
+	Checks the real FFT against a double precision DFT at every size and SIMD level, and that round trips and the in-place variants agree.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/dsp.h"
+#include "AzAudio/fft.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Past this size the DFT only checks a spread of bins, which still includes DC, nyquist and their neighbours
+#define CHECK_FFT_DFT_BINS 1024
+// Errors relative to the RMS bin magnitude, which for these sizes leaves plenty of room above float rounding
+#define CHECK_FFT_TOLERANCE 1e-5
+// Round trips are compared with the input directly, which is within [-1, 1]
+#define CHECK_FFT_ROUND_TRIP_TOLERANCE 1e-5
+
+static const char *checkFFTLevelNames[] = { "scalar", "SSE2", "AVX2", "AVX512", "NEON" };
+
+typedef struct checkFFTData {
+	azaFFT fft;
+	float *samples;
+	float *spectrum;
+	float *inPlace;
+	float *roundTrip;
+	// cos and sin of 2*pi*i/size
+	double *cosTable;
+	double *sinTable;
+} checkFFTData;
+
+// Returns the biggest difference between the spectrum and a DFT of samples, relative to the RMS bin magnitude
+static double checkFFTAgainstDFT(checkFFTData *data) {
+	uint32_t size = data->fft.size;
+	uint32_t bins = size / 2 + 1;
+	uint32_t step = bins > CHECK_FFT_DFT_BINS ? bins / CHECK_FFT_DFT_BINS : 1;
+	double energy = 0.0;
+	for (uint32_t i = 0; i < size; i++) {
+		energy += (double)data->samples[i] * (double)data->samples[i];
+	}
+	// By Parseval, the bins have an RMS magnitude of sqrt(energy)
+	double scale = 1.0 / fmax(sqrt(energy), 1e-30);
+	double error = 0.0;
+	for (uint32_t k = 0; k < bins; k++) {
+		// Every step-th bin, plus the last few so nyquist is always covered
+		if (k % step != 0 && k + 4 < bins) continue;
+		double re = 0.0, im = 0.0;
+		uint32_t index = 0;
+		for (uint32_t i = 0; i < size; i++) {
+			re += (double)data->samples[i] * data->cosTable[index];
+			im -= (double)data->samples[i] * data->sinTable[index];
+			index = (index + k) & (size - 1);
+		}
+		double difference = hypot((double)data->spectrum[k*2+0] - re, (double)data->spectrum[k*2+1] - im) * scale;
+		// NaN has to count as a failure too
+		if (!(difference <= error)) error = isnan(difference) ? INFINITY : difference;
+	}
+	return error;
+}
+
+static double checkFFTRoundTrip(checkFFTData *data) {
+	double error = 0.0;
+	for (uint32_t i = 0; i < data->fft.size; i++) {
+		double difference = fabs((double)data->roundTrip[i] - (double)data->samples[i]);
+		if (!(difference <= error)) error = isnan(difference) ? INFINITY : difference;
+	}
+	return error;
+}
+
+static void checkFFTSize(checkFFTData *data, azaSIMDLevel level) {
+	uint32_t size = data->fft.size;
+	benchNoise(data->samples, size, size);
+	azaFFTForward(&data->fft, data->spectrum, data->samples);
+	double dftError = checkFFTAgainstDFT(data);
+	azaFFTInverse(&data->fft, data->roundTrip, data->spectrum);
+	double roundTripError = checkFFTRoundTrip(data);
+	// The in-place variants do the same arithmetic in the same order, so they have to match exactly
+	memcpy(data->inPlace, data->samples, sizeof(float) * size);
+	azaFFTForwardInPlace(&data->fft, data->inPlace);
+	int forwardInPlace = memcmp(data->inPlace, data->spectrum, sizeof(float) * (size + 2)) == 0;
+	azaFFTInverseInPlace(&data->fft, data->inPlace);
+	int inverseInPlace = memcmp(data->inPlace, data->roundTrip, sizeof(float) * size) == 0;
+	int passed = dftError <= CHECK_FFT_TOLERANCE && roundTripError <= CHECK_FFT_ROUND_TRIP_TOLERANCE && forwardInPlace && inverseInPlace;
+	printf("%-8s %8u %14g %14g %12s %12s %s\n", checkFFTLevelNames[level], size, dftError, roundTripError, forwardInPlace ? "same" : "DIFFERENT", inverseInPlace ? "same" : "DIFFERENT", passed ? "ok" : "FAILED");
+	if (!passed) benchFail();
+}
+
+void checkFFT() {
+	azaSIMDLevel previous = azaGetSIMDLevel();
+	printf("%-8s %8s %14s %14s %12s %12s\n", "level", "size", "DFT error", "round trip", "fwd in-place", "inv in-place");
+	for (uint32_t size = AZAUDIO_FFT_MIN_SIZE; size <= AZAUDIO_FFT_MAX_SIZE; size *= 2) {
+		checkFFTData data;
+		if (azaFFTInit(&data.fft, size)) {
+			printf("azaFFTInit failed for size %u\n", size);
+			benchFail();
+			continue;
+		}
+		data.samples = malloc(sizeof(float) * size);
+		data.spectrum = malloc(sizeof(float) * (size + 2));
+		data.inPlace = malloc(sizeof(float) * (size + 2));
+		data.roundTrip = malloc(sizeof(float) * size);
+		data.cosTable = malloc(sizeof(double) * size);
+		data.sinTable = malloc(sizeof(double) * size);
+		if (data.samples && data.spectrum && data.inPlace && data.roundTrip && data.cosTable && data.sinTable) {
+			for (uint32_t i = 0; i < size; i++) {
+				data.cosTable[i] = cos(6.283185307179586 * (double)i / (double)size);
+				data.sinTable[i] = sin(6.283185307179586 * (double)i / (double)size);
+			}
+			for (int level = AZA_SIMD_LEVEL_SCALAR; level <= AZA_SIMD_LEVEL_NEON; level++) {
+				if (azaSetSIMDLevel((azaSIMDLevel)level)) continue;
+				checkFFTSize(&data, (azaSIMDLevel)level);
+			}
+		} else {
+			printf("Out of memory for size %u\n", size);
+			benchFail();
+		}
+		azaFFTDeinit(&data.fft);
+		free(data.samples);
+		free(data.spectrum);
+		free(data.inPlace);
+		free(data.roundTrip);
+		free(data.cosTable);
+		free(data.sinTable);
+	}
+	azaSetSIMDLevel(previous);
+}
@@ -0,0 +1,65 @@
+/*
+	File: check_limiter.c
+	Author: Philip Haynes
+	Checks that azaLookaheadLimiter keeps a falling envelope under the ceiling at every kind of lookahead, powers of 2 especially,
+	since those fill the detector's rings exactly.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/dsp.h"
+#include "AzAudio/helpers.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CHECK_LIMITER_SAMPLERATE 48000
+#define CHECK_LIMITER_BLOCK 256
+// The limiter only reaches the ceiling on the peaks, so anything more than this many frames there means it let some through
+#define CHECK_LIMITER_MAX_CLIPPED (CHECK_LIMITER_SAMPLERATE / 100)
+
+// 0 stands for the default AZAUDIO_LOOKAHEAD_SAMPLES
+static const uint32_t checkLimiterLookaheads[] = { 0, 63, 64, 65, 127, 129, 255, 256, 257, 1024 };
+
+static float checkLimiterSamples[CHECK_LIMITER_SAMPLERATE];
+
+// A 40Hz tone 20dB over the ceiling that decays, so every peak is smaller than the one before
+static int checkLimiterClipped(uint32_t lookaheadSamples) {
+	azaLookaheadLimiterData data;
+	memset(&data, 0, sizeof(data));
+	azaLookaheadLimiterDataInit(&data);
+	data.gainInput = 20.0f;
+	data.lookahead = (float)lookaheadSamples * 1000.0f / (float)CHECK_LIMITER_SAMPLERATE;
+	for (size_t i = 0; i < CHECK_LIMITER_SAMPLERATE; i++) {
+		float t = (float)i / (float)CHECK_LIMITER_SAMPLERATE;
+		checkLimiterSamples[i] = sinf(2.0f * 3.14159265f * 40.0f * t) * expf(-3.0f * t);
+	}
+	for (size_t i = 0; i < CHECK_LIMITER_SAMPLERATE; i += CHECK_LIMITER_BLOCK) {
+		azaBuffer buffer = {
+			.samples = checkLimiterSamples + i,
+			.frames = AZA_MIN(CHECK_LIMITER_BLOCK, CHECK_LIMITER_SAMPLERATE - i),
+			.stride = 1,
+			.channels = 1,
+			.samplerate = CHECK_LIMITER_SAMPLERATE,
+		};
+		azaLookaheadLimiter(buffer, &data);
+	}
+	azaLookaheadLimiterDataDeinit(&data);
+	// The output is clamped to the ceiling, so whatever the gain missed ends up sitting on it
+	int clipped = 0;
+	for (size_t i = 0; i < CHECK_LIMITER_SAMPLERATE; i++) {
+		if (fabsf(checkLimiterSamples[i]) >= 1.0f) clipped++;
+	}
+	return clipped;
+}
+
+void checkLimiter() {
+	for (size_t i = 0; i < sizeof(checkLimiterLookaheads) / sizeof(checkLimiterLookaheads[0]); i++) {
+		uint32_t lookaheadSamples = checkLimiterLookaheads[i];
+		int clipped = checkLimiterClipped(lookaheadSamples);
+		int passed = clipped <= CHECK_LIMITER_MAX_CLIPPED;
+		printf("lookahead %4u samples: %5d of %d frames at the ceiling %s\n", lookaheadSamples ? lookaheadSamples : AZAUDIO_LOOKAHEAD_SAMPLES, clipped, CHECK_LIMITER_SAMPLERATE, passed ? "ok" : "FAILED");
+		if (!passed) benchFail();
+	}
+}
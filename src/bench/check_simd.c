@@ -0,0 +1,247 @@
+/*
+	File: check_simd.c
+	Author: Philip Haynes
+	Checks every kernel in azaKernelTable at every SIMD level the CPU supports against the scalar ones.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/dsp.h"
+#include "AzAudio/simd.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Every count a vector width could get wrong, from all tail to all body
+static const size_t checkSIMDCounts[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 1000, 1023 };
+#define CHECK_SIMD_COUNT_COUNT (sizeof(checkSIMDCounts) / sizeof(checkSIMDCounts[0]))
+#define CHECK_SIMD_MAX_COUNT 1023
+// Enough for the reverb, whose lines and taps both go in dst
+#define CHECK_SIMD_REVERB_CAPACITY 1024
+#define CHECK_SIMD_LENGTH (CHECK_SIMD_REVERB_CAPACITY * AZAUDIO_REVERB_LINES + CHECK_SIMD_MAX_COUNT * AZAUDIO_REVERB_LINES + AZAUDIO_REVERB_LINES)
+// Anything that can fuse a multiply and add, or sums in a different order, rounds differently
+#define CHECK_SIMD_TOLERANCE 1e-6f
+#define CHECK_SIMD_TOLERANCE_FASTMATH 1e-5f
+#define CHECK_SIMD_TOLERANCE_SUM 1e-5f
+
+static const char *checkSIMDLevelNames[] = { "scalar", "SSE2", "AVX2", "AVX512", "NEON" };
+
+// Plus one so pointers can start off alignment, and one past the end to catch overruns
+#define CHECK_SIMD_SIZE (CHECK_SIMD_LENGTH + 2)
+static float checkSIMDSrc[CHECK_SIMD_SIZE];
+static float checkSIMDSrc2[CHECK_SIMD_SIZE];
+static float checkSIMDDst[CHECK_SIMD_SIZE];
+static float checkSIMDExpected[CHECK_SIMD_SIZE];
+static float checkSIMDActual[CHECK_SIMD_SIZE];
+
+typedef struct checkSIMDCase {
+	const char *name;
+	// Runs the kernel over count values of src and src2 into dst, with a and b picking the variant. Returns how many floats of dst it was allowed to change.
+	size_t (*run)(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b);
+	size_t a, b;
+	// Biggest difference allowed, relative to the expected value where that's bigger than 1. 0 means bit-exact.
+	float tolerance;
+} checkSIMDCase;
+
+static size_t checkSIMDRunMix(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	azaKernel.mix(dst, 0.7f, src, -1.3f, count);
+	return count;
+}
+
+static size_t checkSIMDRunCopy(float *dst, const float *src, const float *src2, size_t count, size_t dstStride, size_t srcStride) {
+	azaKernel.copyStrided(dst, dstStride, src, srcStride, count);
+	return count * dstStride;
+}
+
+static size_t checkSIMDRunCubicLimiter(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	// Past [-1, 1] so the clamp gets checked too
+	for (size_t i = 0; i < count; i++) dst[i] *= 2.0f;
+	azaKernel.cubicLimiter(dst, count);
+	return count;
+}
+
+static size_t checkSIMDRunInterleave2(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	azaKernel.interleave2(dst, src, src2, count);
+	return count * 2;
+}
+
+static size_t checkSIMDRunDeinterleave2(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	azaKernel.deinterleave2(dst, dst + count, src, count);
+	return count * 2;
+}
+
+// count frames of channels channels, with the state after them in dst
+static size_t checkSIMDRunBiquad(float *dst, const float *src, const float *src2, size_t count, size_t channels, size_t planar) {
+	// A resonant lowpass, so the state matters for a while
+	static const float coefficients[5] = { 0.0675f, 0.135f, 0.0675f, -1.143f, 0.4128f };
+	float *z1 = dst + count * channels;
+	float *z2 = z1 + channels;
+	float *planes[8];
+	azaBuffer buffer = {
+		.samples = dst,
+		.frames = count,
+		.stride = planar ? 1 : channels,
+		.channels = channels,
+		.samplerate = 48000,
+	};
+	if (planar) {
+		for (size_t c = 0; c < channels; c++) planes[c] = dst + c * count;
+		buffer.planes = planes;
+	}
+	azaKernel.biquad(buffer, coefficients, z1, z2);
+	return count * channels + channels * 2;
+}
+
+static size_t checkSIMDRunAmpToDb(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	// From 0 up to +20dB, through the denormals on the way
+	for (size_t i = 0; i < count; i++) dst[i] = fabsf(src[i]) * powf(10.0f, src2[i] * 40.0f - 39.0f);
+	azaKernel.ampToDb(dst, dst, count, azaFastMath);
+	return count;
+}
+
+static size_t checkSIMDRunDbToAmp(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	for (size_t i = 0; i < count; i++) dst[i] = src[i] * 120.0f;
+	azaKernel.dbToAmp(dst, dst, count, azaFastMath);
+	return count;
+}
+
+// count frames of the tank, with its lines, taps and lowpass state in dst
+static size_t checkSIMDRunReverb(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	// Some shorter than the longer counts, so lines read what the same call wrote
+	static const int32_t delays[AZAUDIO_REVERB_LINES] = { 3, 17, 29, 41, 101, 211, 307, 1021 };
+	azaReverbData data;
+	memset(&data, 0, sizeof(data));
+	data.lines = dst;
+	data.capacity = CHECK_SIMD_REVERB_CAPACITY;
+	// Starting near the end so the index wraps
+	data.index = CHECK_SIMD_REVERB_CAPACITY - 7;
+	for (int j = 0; j < AZAUDIO_REVERB_LINES; j++) {
+		data.lineDelays[j] = delays[j];
+		data.lineGains[j] = 0.3f + src2[j] * 0.04f;
+		data.lineDamping[j] = 0.5f + src2[j + AZAUDIO_REVERB_LINES] * 0.4f;
+		data.lineLowpass[j] = src2[j + AZAUDIO_REVERB_LINES * 2];
+	}
+	float *taps = dst + CHECK_SIMD_REVERB_CAPACITY * AZAUDIO_REVERB_LINES;
+	azaKernel.reverb(&data, src, taps, count);
+	float *lowpass = taps + count * AZAUDIO_REVERB_LINES;
+	memcpy(lowpass, data.lineLowpass, sizeof(data.lineLowpass));
+	return (size_t)(lowpass + AZAUDIO_REVERB_LINES - dst);
+}
+
+static size_t checkSIMDRunComplexMulAdd(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	azaKernel.complexMulAdd(dst, src, src2, count);
+	return count * 2;
+}
+
+static size_t checkSIMDRunDot(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	dst[0] = azaKernel.dot(src, src2, count);
+	return 1;
+}
+
+// Every pass of an FFT over the biggest power of 2 that fits in count, with noise for twiddles
+static size_t checkSIMDRunFFTPass(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	size_t n = 1;
+	while (n * 2 <= count) n *= 2;
+	if (n < 8) return 0;
+	for (size_t half = 4; half < n; half *= 2) {
+		azaKernel.fftPass(dst, n, half, src + half * 2);
+	}
+	return n * 2;
+}
+
+static size_t checkSIMDRunPolyphase(float *dst, const float *src, const float *src2, size_t count, size_t a, size_t b) {
+	size_t taps = count & ~(size_t)3;
+	if (!taps) return 0;
+	dst[0] = azaKernel.polyphase(src, src2, taps, 0.37f);
+	return 1;
+}
+
+static const checkSIMDCase checkSIMDCases[] = {
+	{ "mix", checkSIMDRunMix, 0, 0, CHECK_SIMD_TOLERANCE },
+	{ "copy", checkSIMDRunCopy, 1, 1, 0.0f },
+	{ "copy interleave", checkSIMDRunCopy, 2, 1, 0.0f },
+	{ "copy deinterleave 2", checkSIMDRunCopy, 1, 2, 0.0f },
+	{ "copy deinterleave 3", checkSIMDRunCopy, 1, 3, 0.0f },
+	{ "copy deinterleave 4", checkSIMDRunCopy, 1, 4, 0.0f },
+	{ "copy strided", checkSIMDRunCopy, 3, 2, 0.0f },
+	{ "cubic limiter", checkSIMDRunCubicLimiter, 0, 0, CHECK_SIMD_TOLERANCE },
+	{ "interleave2", checkSIMDRunInterleave2, 0, 0, 0.0f },
+	{ "deinterleave2", checkSIMDRunDeinterleave2, 0, 0, 0.0f },
+	{ "biquad 1", checkSIMDRunBiquad, 1, 0, 0.0f },
+	{ "biquad 2", checkSIMDRunBiquad, 2, 0, 0.0f },
+	{ "biquad 3", checkSIMDRunBiquad, 3, 0, 0.0f },
+	{ "biquad 4", checkSIMDRunBiquad, 4, 0, 0.0f },
+	{ "biquad 6", checkSIMDRunBiquad, 6, 0, 0.0f },
+	{ "biquad 8", checkSIMDRunBiquad, 8, 0, 0.0f },
+	{ "biquad planar 4", checkSIMDRunBiquad, 4, 1, 0.0f },
+	{ "biquad planar 5", checkSIMDRunBiquad, 5, 1, 0.0f },
+	{ "biquad planar 8", checkSIMDRunBiquad, 8, 1, 0.0f },
+	{ "ampToDb", checkSIMDRunAmpToDb, 0, 0, CHECK_SIMD_TOLERANCE_FASTMATH },
+	{ "dbToAmp", checkSIMDRunDbToAmp, 0, 0, CHECK_SIMD_TOLERANCE_FASTMATH },
+	{ "reverb", checkSIMDRunReverb, 0, 0, 0.0f },
+	{ "complexMulAdd", checkSIMDRunComplexMulAdd, 0, 0, CHECK_SIMD_TOLERANCE },
+	{ "dot", checkSIMDRunDot, 0, 0, CHECK_SIMD_TOLERANCE_SUM },
+	{ "fftPass", checkSIMDRunFFTPass, 0, 0, 0.0f },
+	{ "polyphase", checkSIMDRunPolyphase, 0, 0, CHECK_SIMD_TOLERANCE_SUM },
+};
+#define CHECK_SIMD_CASE_COUNT (sizeof(checkSIMDCases) / sizeof(checkSIMDCases[0]))
+
+static float checkSIMDError(const float *expected, const float *actual, size_t count) {
+	float error = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		float difference = fabsf(expected[i] - actual[i]) / fmaxf(1.0f, fabsf(expected[i]));
+		// NaN and infinities have to match exactly, and a NaN difference counts as a failure
+		if (isinf(expected[i]) && expected[i] == actual[i]) continue;
+		if (!(difference <= error)) error = isnan(difference) ? INFINITY : difference;
+	}
+	return error;
+}
+
+// Returns the biggest difference between what scalar and level give for every count and offset
+static float checkSIMDKernel(azaSIMDLevel level, const checkSIMDCase *check) {
+	float error = 0.0f;
+	for (size_t n = 0; n < CHECK_SIMD_COUNT_COUNT; n++) {
+		size_t count = checkSIMDCounts[n];
+		for (size_t offset = 0; offset < 2; offset++) {
+			float *results[2] = { checkSIMDExpected, checkSIMDActual };
+			azaSIMDLevel levels[2] = { AZA_SIMD_LEVEL_SCALAR, level };
+			size_t length = 0;
+			for (int run = 0; run < 2; run++) {
+				azaSetSIMDLevel(levels[run]);
+				benchNoise(checkSIMDSrc, CHECK_SIMD_SIZE, (unsigned)(count * 2 + offset));
+				benchNoise(checkSIMDSrc2, CHECK_SIMD_SIZE, (unsigned)(count * 2 + offset + 1000));
+				benchNoise(checkSIMDDst, CHECK_SIMD_SIZE, (unsigned)(count * 2 + offset + 2000));
+				length = check->run(checkSIMDDst + offset, checkSIMDSrc + offset, checkSIMDSrc2 + offset, count, check->a, check->b);
+				memcpy(results[run], checkSIMDDst, sizeof(float) * CHECK_SIMD_SIZE);
+			}
+			// Everything past what the kernel was allowed to touch has to be left alone too
+			size_t end = offset + length;
+			error = fmaxf(error, checkSIMDError(checkSIMDExpected, checkSIMDActual, end));
+			if (memcmp(checkSIMDExpected + end, checkSIMDActual + end, sizeof(float) * (CHECK_SIMD_SIZE - end))) {
+				error = INFINITY;
+			}
+		}
+	}
+	return error;
+}
+
+void checkSIMD() {
+	azaSIMDLevel previous = azaGetSIMDLevel();
+	int checked = 0;
+	for (int level = AZA_SIMD_LEVEL_SSE2; level <= AZA_SIMD_LEVEL_NEON; level++) {
+		if (azaSetSIMDLevel((azaSIMDLevel)level)) continue;
+		checked++;
+		for (size_t i = 0; i < CHECK_SIMD_CASE_COUNT; i++) {
+			const checkSIMDCase *check = &checkSIMDCases[i];
+			float error = checkSIMDKernel((azaSIMDLevel)level, check);
+			int passed = error <= check->tolerance;
+			printf("%-8s %-20s max error %-12g %s\n", checkSIMDLevelNames[level], check->name, error, passed ? "ok" : "FAILED");
+			if (!passed) benchFail();
+		}
+	}
+	if (!checked) {
+		printf("No SIMD levels supported, so there's nothing to check\n");
+	}
+	azaSetSIMDLevel(previous);
+}
@@ -0,0 +1,150 @@
+/*
+	File: main.c
+	Author: Philip Haynes
+	Benchmarks for the DSP in AzAudio. Only links the DSP, so no audio devices are needed.
+*/
+
+#include "bench.h"
+
+#include "AzAudio/dsp.h"
+#include "AzAudio/simd.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+double benchNow() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+double benchTime(void (*fn)(void *userData), void *userData, double minSeconds) {
+	// Warm up caches and branch predictors
+	fn(userData);
+	size_t iterations = 0;
+	double start = benchNow();
+	double elapsed;
+	do {
+		fn(userData);
+		iterations++;
+		elapsed = benchNow() - start;
+	} while (elapsed < minSeconds);
+	return elapsed / (double)iterations;
+}
+
+void benchNoise(float *samples, size_t count, unsigned seed) {
+	unsigned state = seed * 747796405u + 2891336453u;
+	for (size_t i = 0; i < count; i++) {
+		state = state * 1664525u + 1013904223u;
+		samples[i] = (float)(state >> 8) / (float)(1u << 24) * 2.0f - 1.0f;
+	}
+}
+
+static int benchFailures = 0;
+
+void benchFail() {
+	benchFailures++;
+}
+
+typedef struct benchResult {
+	char bench[32];
+	char name[64];
+	char params[512];
+	double nsPerSample;
+	double realtimePercent;
+} benchResult;
+
+static benchResult *benchResults = NULL;
+static size_t benchResultCount = 0;
+static size_t benchResultCapacity = 0;
+
+void benchRecord(const char *bench, const char *name, const char *params, double nsPerSample, double realtimePercent) {
+	if (benchResultCount == benchResultCapacity) {
+		size_t capacity = benchResultCapacity ? benchResultCapacity * 2 : 256;
+		benchResult *results = realloc(benchResults, sizeof(benchResult) * capacity);
+		if (!results) return;
+		benchResults = results;
+		benchResultCapacity = capacity;
+	}
+	benchResult *result = &benchResults[benchResultCount++];
+	snprintf(result->bench, sizeof(result->bench), "%s", bench);
+	snprintf(result->name, sizeof(result->name), "%s", name);
+	snprintf(result->params, sizeof(result->params), "%s", params);
+	result->nsPerSample = nsPerSample;
+	result->realtimePercent = realtimePercent;
+}
+
+// One object per result, so runs from different commits can be compared by bench, name and params
+static int benchWriteJSON(const char *path) {
+	FILE *file = fopen(path, "w");
+	if (!file) {
+		fprintf(stderr, "Failed to open \"%s\" for writing\n", path);
+		return 1;
+	}
+	fprintf(file, "{\n\t\"simdLevel\": %d,\n\t\"results\": [", (int)azaGetSIMDLevel());
+	for (size_t i = 0; i < benchResultCount; i++) {
+		benchResult *result = &benchResults[i];
+		fprintf(file, "%s\n\t\t{ \"bench\": \"%s\", \"name\": \"%s\", ", i ? "," : "", result->bench, result->name);
+		if (result->params[0]) {
+			fprintf(file, "%s, ", result->params);
+		}
+		fprintf(file, "\"nsPerSample\": %.4f, \"realtimePercent\": %.5f }", result->nsPerSample, result->realtimePercent);
+	}
+	fprintf(file, "\n\t]\n}\n");
+	fclose(file);
+	printf("\nWrote %zu results to %s\n", benchResultCount, path);
+	return 0;
+}
+
+typedef struct benchEntry {
+	const char *name;
+	void (*fn)();
+} benchEntry;
+
+static const benchEntry benches[] = {
+	{ "fft", benchFFT },
+	{ "voices", benchVoices },
+	{ "graph", benchGraph },
+	{ "denormals", benchDenormals },
+	{ "dsp", benchDSP },
+	// Checks, which pass or fail rather than measure
+	{ "simd", checkSIMD },
+	{ "limiter", checkLimiter },
+	{ "fftcheck", checkFFT },
+	{ "commands", checkCommands },
+};
+
+// Usage: Bench [--json path] [names...]
+int main(int argc, char **argv) {
+	azaSIMDInit();
+	printf("SIMD level: %d\n", (int)azaGetSIMDLevel());
+	const char *jsonPath = NULL;
+	int names = 0;
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "--json") == 0 && a+1 < argc) {
+			jsonPath = argv[++a];
+			argv[a-1] = argv[a] = NULL;
+		} else {
+			names++;
+		}
+	}
+	for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		// Any names pick which benchmarks to run
+		int selected = names == 0;
+		for (int a = 1; a < argc; a++) {
+			if (argv[a] && strcmp(argv[a], benches[i].name) == 0) selected = 1;
+		}
+		if (!selected) continue;
+		printf("\n== %s ==\n", benches[i].name);
+		benches[i].fn();
+	}
+	int result = jsonPath ? benchWriteJSON(jsonPath) : 0;
+	free(benchResults);
+	if (benchFailures) {
+		printf("\n%d checks failed\n", benchFailures);
+		result = 1;
+	}
+	return result;
+}
@@ -41,7 +41,7 @@ azaCompressorData compressorData[AZA_CHANNELS_DEFAULT] = {{}};
 azaDelayData delayData[AZA_CHANNELS_DEFAULT] = {{}};
 azaDelayData delay2Data[AZA_CHANNELS_DEFAULT] = {{}};
 azaDelayData delay3Data[AZA_CHANNELS_DEFAULT] = {{}};
-azaReverbData reverbData[AZA_CHANNELS_DEFAULT] = {{}};
+azaReverbData reverbData = {};
 azaFilterData highPassData[AZA_CHANNELS_DEFAULT] = {{}};
 azaGateData gateData[AZA_CHANNELS_DEFAULT] = {{}};
 azaFilterData gateBandPass[AZA_CHANNELS_DEFAULT] = {{}};
@@ -112,7 +112,7 @@ int mixCallbackOutput(azaBuffer buffer, void *userData) {
 	if ((err = azaDelay(buffer, delay3Data))) {
 		return err;
 	}
-	// if ((err = azaReverb(buffer, reverbData))) {
+	// if ((err = azaReverb(buffer, &reverbData))) {
 	// 	return err;
 	// }
 	if ((err = azaFilter(buffer, highPassData))) {
@@ -198,13 +198,6 @@ int main(int argumentCount, char** argumentValues) {
 			highPassData[c].frequency = 50.0f;
 			azaFilterDataInit(&highPassData[c]);
 			
-			reverbData[c].gain = -15.0f;
-			reverbData[c].gainDry = 0.0f;
-			reverbData[c].roomsize = 10.0f;
-			reverbData[c].color = 0.5f;
-			reverbData[c].delay = c * 377.0f / 48000.0f;
-			azaReverbDataInit(&reverbData[c]);
-			
 			compressorData[c].threshold = -24.0f;
 			compressorData[c].ratio = 10.0f;
 			compressorData[c].attack = 100.0f;
@@ -215,15 +208,24 @@ int main(int argumentCount, char** argumentValues) {
 			limiterData[c].gainOutput = -6.0f;
 			azaLookaheadLimiterDataInit(&limiterData[c]);
 		}
+		reverbData.gain = -15.0f;
+		reverbData.gainDry = 0.0f;
+		reverbData.roomsize = 10.0f;
+		reverbData.color = 0.5f;
+		reverbData.delay = 0.0f;
+		azaReverbDataInit(&reverbData);
 		azaSetLogCallback(logCallback);
 		azaStream streamInput = {0};
 		streamInput.mixCallback = mixCallbackInput;
 		streamInput.deviceInterface = AZA_INPUT;
+		// All the DSP runs at 48kHz whatever the devices want
+		streamInput.mixSamplerate = 48000;
 		if (azaStreamInit(&streamInput, "default") != AZA_SUCCESS) {
 			throw std::runtime_error("Failed to init input stream!");
 		}
 		azaStream streamOutput = {0};
 		streamOutput.mixCallback = mixCallbackOutput;
+		streamOutput.mixSamplerate = 48000;
 		if (azaStreamInit(&streamOutput, "default") != AZA_SUCCESS) {
 			throw std::runtime_error("Failed to init output stream!");
 		}
@@ -233,9 +235,13 @@ int main(int argumentCount, char** argumentValues) {
 		azaStreamDeinit(&streamOutput);
 		for (int c = 0; c < AZA_CHANNELS_DEFAULT; c++) {
 			azaDelayDataDeinit(&delayData[c]);
-			azaReverbDataDeinit(&reverbData[c]);
+			azaLookaheadLimiterDataDeinit(&limiterData[c]);
+			azaCompressorDataDeinit(&compressorData[c]);
+			azaGateDataDeinit(&gateData[c]);
 		}
 		
+		azaReverbDataDeinit(&reverbData);
+		
 		azaDeinit();
 	} catch (std::runtime_error& e) {
 		sys::cout << "Runtime Error: " << e.what() << std::endl;